@@ -16,6 +16,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
@@ -49,31 +50,44 @@ bool AESCryptor::SetIV(const std::vector<uint8_t>& iv) {
   return true;
 }
 
+EVP_CIPHER_CTX* AESCryptor::PrepareContext(UniqueSslPtr<EVP_CIPHER_CTX>* ctx,
+                                           bool encrypt) {
+  if (!*ctx) {
+    UniqueSslPtr<EVP_CIPHER_CTX> created(EVP_CIPHER_CTX_new());
+    if (!created || EVP_CipherInit_ex(created.get(), EVP_aes_256_cbc(),
+                                      nullptr, key_.data(), iv_.data(),
+                                      encrypt) != 1) {
+      return nullptr;
+    }
+    *ctx = std::move(created);
+    return ctx->get();
+  }
+  // Only the IV changes; the expanded key is kept.
+  if (EVP_CipherInit_ex(ctx->get(), nullptr, nullptr, nullptr, iv_.data(),
+                        encrypt) != 1) {
+    return nullptr;
+  }
+  return ctx->get();
+}
+
 std::vector<uint8_t> AESCryptor::CBCEncrypt(
     const std::vector<uint8_t>& message) {
-  UniqueSslPtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-
+  EVP_CIPHER_CTX* ctx = PrepareContext(&encrypt_ctx_, true);
   if (!ctx) {
     return std::vector<uint8_t>();
   }
 
-  if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_cbc(), nullptr, key_.data(),
-                         iv_.data()) != 1) {
-    return std::vector<uint8_t>();
-  }
-
   std::vector<uint8_t> result((message.size() / 16 + 1) * 16);
   int len;
   int result_length = 0;
 
-  if (EVP_EncryptUpdate(ctx.get(), result.data(), &len, message.data(),
+  if (EVP_EncryptUpdate(ctx, result.data(), &len, message.data(),
                         message.size()) != 1) {
     return std::vector<uint8_t>();
   }
   result_length += len;
 
-  if (EVP_EncryptFinal_ex(ctx.get(), result.data() + result_length, &len) !=
-      1) {
+  if (EVP_EncryptFinal_ex(ctx, result.data() + result_length, &len) != 1) {
     return std::vector<uint8_t>();
   }
   result_length += len;
@@ -83,28 +97,21 @@ std::vector<uint8_t> AESCryptor::CBCEncrypt(
 
 std::vector<uint8_t> AESCryptor::CBCDecrypt(
     const std::vector<uint8_t>& message) {
-  UniqueSslPtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-
+  EVP_CIPHER_CTX* ctx = PrepareContext(&decrypt_ctx_, false);
   if (!ctx) {
     return std::vector<uint8_t>();
   }
 
-  if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_cbc(), nullptr, key_.data(),
-                         iv_.data()) != 1) {
-    return std::vector<uint8_t>();
-  }
-
   std::vector<uint8_t> result(message.size());
   int len, result_length = 0;
 
-  if (EVP_DecryptUpdate(ctx.get(), result.data(), &len, message.data(),
+  if (EVP_DecryptUpdate(ctx, result.data(), &len, message.data(),
                         message.size()) != 1) {
     return std::vector<uint8_t>();
   }
   result_length += len;
 
-  if (EVP_DecryptFinal_ex(ctx.get(), result.data() + result_length, &len) !=
-      1) {
+  if (EVP_DecryptFinal_ex(ctx, result.data() + result_length, &len) != 1) {
     return std::vector<uint8_t>();
   }
   result_length += len;
@@ -21,7 +21,15 @@
 #include <string>
 #include <vector>
 
+#include "openssl/base.h"
+#include "unique_ssl_ptr.h"
+
 namespace cpix {
+
+// AES-256-CBC encryption with one key. Encrypt and decrypt reuse their cipher
+// context, so the key schedule is computed once per AESCryptor rather than
+// once per message. An AESCryptor must therefore only be used by one thread at
+// a time.
 class AESCryptor {
  public:
   ~AESCryptor();
@@ -37,8 +45,15 @@ class AESCryptor {
  private:
   AESCryptor() = default;
 
+  // Returns |*ctx| set up for |encrypt| with the current IV, creating it and
+  // expanding the key on first use. Returns nullptr on failure.
+  EVP_CIPHER_CTX* PrepareContext(UniqueSslPtr<EVP_CIPHER_CTX>* ctx,
+                                 bool encrypt);
+
   std::vector<uint8_t> key_;
   std::vector<uint8_t> iv_;
+  UniqueSslPtr<EVP_CIPHER_CTX> encrypt_ctx_;
+  UniqueSslPtr<EVP_CIPHER_CTX> decrypt_ctx_;
 };
 }  // namespace cpix
 #endif  // CPIX_CC_AES_CRYPTOR_H_
@@ -0,0 +1,376 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base64.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CPIX_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cpix {
+namespace {
+
+constexpr char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr int8_t kInvalid = -1;
+constexpr int8_t kWhitespace = -2;
+constexpr int8_t kPadding = -3;
+
+struct DecodeTable {
+  int8_t values[256];
+
+  DecodeTable() {
+    for (int i = 0; i < 256; i++) {
+      values[i] = kInvalid;
+    }
+    for (int i = 0; i < 64; i++) {
+      values[static_cast<uint8_t>(kAlphabet[i])] = i;
+    }
+    for (char c : {' ', '\t', '\n', '\r', '\f', '\v'}) {
+      values[static_cast<uint8_t>(c)] = kWhitespace;
+    }
+    values[static_cast<uint8_t>('=')] = kPadding;
+  }
+};
+
+const DecodeTable& GetDecodeTable() {
+  static const DecodeTable* table = new DecodeTable();
+  return *table;
+}
+
+// Encodes whole groups of three bytes starting at |data| into |out|. Returns
+// the number of bytes consumed.
+size_t EncodeScalar(const uint8_t* data, size_t size, char* out) {
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    uint32_t group = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    *out++ = kAlphabet[(group >> 18) & 0x3f];
+    *out++ = kAlphabet[(group >> 12) & 0x3f];
+    *out++ = kAlphabet[(group >> 6) & 0x3f];
+    *out++ = kAlphabet[group & 0x3f];
+  }
+  return i;
+}
+
+#if defined(CPIX_BASE64_X86)
+
+// The vector kernels follow Wojciech Muła's pshufb-based Base64 algorithms.
+// Encoding splits every three input bytes into four 6-bit indices with a
+// shuffle and two multiplies, then maps indices to characters by adding a
+// per-range offset looked up with pshufb. Decoding classifies characters by
+// range, rejects the whole block if any character is outside the alphabet,
+// and packs four 6-bit values back into three bytes with multiply-adds.
+
+// Encodes 12 bytes of |data| into 16 characters. Reads 16 bytes.
+__attribute__((target("sse4.1"))) inline __m128i EncodeBlockSSE41(
+    __m128i in) {
+  in = _mm_shuffle_epi8(
+      in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  const __m128i indices = _mm_or_si128(t1, t3);
+
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12.
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+  const __m128i offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("sse4.1"))) size_t EncodeSSE41(const uint8_t* data,
+                                                     size_t size, char* out) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 12, out += 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), EncodeBlockSSE41(in));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t EncodeAVX2(const uint8_t* data,
+                                                  size_t size, char* out) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t i = 0;
+  for (; i + 28 <= size; i += 24, out += 32) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12));
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    in = _mm256_shuffle_epi8(in, shuffle);
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range =
+        _mm256_or_si256(range, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(out),
+        _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices));
+  }
+  return i;
+}
+
+// Decodes 16 characters at |data| into 12 bytes at |out|. Returns false, and
+// writes nothing, if any character is outside the Base64 alphabet.
+__attribute__((target("sse4.1"))) bool DecodeBlockSSE41(const char* data,
+                                                        uint8_t* out) {
+  const __m128i in =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  const __m128i upper =
+      _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)),
+                    _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), in));
+  const __m128i lower =
+      _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)),
+                    _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), in));
+  const __m128i digit =
+      _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)),
+                    _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), in));
+  const __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+  const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  const __m128i valid = _mm_or_si128(
+      _mm_or_si128(upper, lower),
+      _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+  if (_mm_movemask_epi8(valid) != 0xffff) {
+    return false;
+  }
+
+  __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+  shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+  shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+  shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+  const __m128i values = _mm_add_epi8(in, shift);
+
+  const __m128i pairs =
+      _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  const __m128i packed = _mm_shuffle_epi8(
+      groups,
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  alignas(16) uint8_t block[16];
+  _mm_store_si128(reinterpret_cast<__m128i*>(block), packed);
+  memcpy(out, block, 12);
+  return true;
+}
+
+__attribute__((target("avx2"))) bool DecodeBlockAVX2(const char* data,
+                                                     uint8_t* out) {
+  const __m256i in =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  const __m256i upper =
+      _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), in));
+  const __m256i lower =
+      _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), in));
+  const __m256i digit =
+      _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+  const __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+  const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+  const __m256i valid = _mm256_or_si256(
+      _mm256_or_si256(upper, lower),
+      _mm256_or_si256(digit, _mm256_or_si256(plus, slash)));
+  if (_mm256_movemask_epi8(valid) != -1) {
+    return false;
+  }
+
+  __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+  shift = _mm256_or_si256(shift,
+                          _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+  shift = _mm256_or_si256(shift,
+                          _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+  shift = _mm256_or_si256(shift,
+                          _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+  shift = _mm256_or_si256(shift,
+                          _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+  const __m256i values = _mm256_add_epi8(in, shift);
+
+  const __m256i pairs =
+      _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+  const __m256i groups =
+      _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+  const __m256i packed = _mm256_shuffle_epi8(
+      groups,
+      _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                       2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  alignas(32) uint8_t block[32];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(block), packed);
+  memcpy(out, block, 12);
+  memcpy(out + 12, block + 16, 12);
+  return true;
+}
+
+#endif  // CPIX_BASE64_X86
+
+Base64Kernel DetectKernel() {
+#if defined(CPIX_BASE64_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Base64Kernel::kAVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return Base64Kernel::kSSE41;
+  }
+#endif
+  return Base64Kernel::kScalar;
+}
+
+// Decodes as many whole vector blocks as possible starting at |data|. Stops at
+// the first block containing whitespace, padding or an invalid character so
+// the scalar decoder can deal with it. Returns the number of characters
+// consumed and advances |out| past the bytes written.
+size_t DecodeBlocks(const char* data, size_t size, uint8_t** out,
+                    Base64Kernel kernel) {
+  size_t i = 0;
+#if defined(CPIX_BASE64_X86)
+  if (kernel == Base64Kernel::kAVX2) {
+    while (i + 32 <= size && DecodeBlockAVX2(data + i, *out)) {
+      i += 32;
+      *out += 24;
+    }
+  }
+  if (kernel != Base64Kernel::kScalar) {
+    while (i + 16 <= size && DecodeBlockSSE41(data + i, *out)) {
+      i += 16;
+      *out += 12;
+    }
+  }
+#endif
+  return i;
+}
+
+}  // namespace
+
+Base64Kernel GetBestBase64Kernel() {
+  static const Base64Kernel kernel = DetectKernel();
+  return kernel;
+}
+
+size_t Base64EncodedSize(size_t size) { return (size + 2) / 3 * 4; }
+
+size_t Base64DecodedMaxSize(size_t size) { return (size + 3) / 4 * 3; }
+
+size_t Base64Encode(const uint8_t* data, size_t size, char* out,
+                    Base64Kernel kernel) {
+  size_t i = 0;
+#if defined(CPIX_BASE64_X86)
+  if (kernel == Base64Kernel::kAVX2) {
+    i += EncodeAVX2(data, size, out);
+  }
+  if (kernel != Base64Kernel::kScalar) {
+    i += EncodeSSE41(data + i, size - i, out + i / 3 * 4);
+  }
+#endif
+  i += EncodeScalar(data + i, size - i, out + i / 3 * 4);
+  char* tail = out + i / 3 * 4;
+  if (i + 1 == size) {
+    *tail++ = kAlphabet[data[i] >> 2];
+    *tail++ = kAlphabet[(data[i] & 0x03) << 4];
+    *tail++ = '=';
+    *tail++ = '=';
+  } else if (i + 2 == size) {
+    *tail++ = kAlphabet[data[i] >> 2];
+    *tail++ = kAlphabet[((data[i] & 0x03) << 4) | (data[i + 1] >> 4)];
+    *tail++ = kAlphabet[(data[i + 1] & 0x0f) << 2];
+    *tail++ = '=';
+  }
+  return tail - out;
+}
+
+bool Base64Decode(const char* data, size_t size, uint8_t* out,
+                  size_t* out_size, Base64Kernel kernel) {
+  const int8_t* table = GetDecodeTable().values;
+  uint8_t* const begin = out;
+  uint32_t group = 0;
+  int group_size = 0;
+  size_t i = 0;
+  while (i < size) {
+    if (group_size == 0) {
+      i += DecodeBlocks(data + i, size - i, &out, kernel);
+      if (i == size) {
+        break;
+      }
+    }
+    int8_t value = table[static_cast<uint8_t>(data[i])];
+    if (value == kPadding) {
+      break;
+    }
+    i++;
+    if (value == kWhitespace) {
+      continue;
+    }
+    if (value == kInvalid) {
+      return false;
+    }
+    group = (group << 6) | value;
+    if (++group_size == 4) {
+      *out++ = group >> 16;
+      *out++ = group >> 8;
+      *out++ = group;
+      group = 0;
+      group_size = 0;
+    }
+  }
+
+  // Only padding and whitespace may follow the first '='.
+  int padding = 0;
+  for (; i < size; i++) {
+    int8_t value = table[static_cast<uint8_t>(data[i])];
+    if (value == kPadding) {
+      padding++;
+    } else if (value != kWhitespace) {
+      return false;
+    }
+  }
+  if (padding > 0 && group_size + padding != 4) {
+    return false;
+  }
+  if (group_size == 1) {
+    return false;
+  }
+  if (group_size == 2) {
+    *out++ = group >> 4;
+  } else if (group_size == 3) {
+    *out++ = group >> 10;
+    *out++ = group >> 2;
+  }
+  *out_size = out - begin;
+  return true;
+}
+
+}  // namespace cpix
@@ -0,0 +1,59 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Standard (RFC 4648) Base64 encoder and decoder that write directly into
+// caller-supplied buffers. On x86-64 the bulk of the work is done with SSE4.1
+// or AVX2 kernels chosen at runtime from the CPU's capabilities, with a scalar
+// fallback everywhere else.
+
+#ifndef CPIX_CC_BASE64_H_
+#define CPIX_CC_BASE64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace cpix {
+
+enum class Base64Kernel {
+  kScalar,
+  kSSE41,
+  kAVX2,
+};
+
+// Returns the fastest kernel supported by the running CPU.
+Base64Kernel GetBestBase64Kernel();
+
+// Returns the number of characters needed to encode |size| bytes, including
+// padding.
+size_t Base64EncodedSize(size_t size);
+
+// Returns an upper bound on the number of bytes decoded from |size| characters.
+size_t Base64DecodedMaxSize(size_t size);
+
+// Encodes |size| bytes from |data| into |out|, which must have room for
+// Base64EncodedSize(size) characters. Returns the number of characters written.
+// The output is padded and not NUL-terminated.
+size_t Base64Encode(const uint8_t* data, size_t size, char* out,
+                    Base64Kernel kernel = GetBestBase64Kernel());
+
+// Decodes |size| characters from |data| into |out|, which must have room for
+// Base64DecodedMaxSize(size) bytes, and stores the number of bytes written in
+// |out_size|. Whitespace anywhere in the input is skipped and padding is
+// optional. Returns false if the input is not valid Base64.
+bool Base64Decode(const char* data, size_t size, uint8_t* out,
+                  size_t* out_size,
+                  Base64Kernel kernel = GetBestBase64Kernel());
+
+}  // namespace cpix
+#endif  // CPIX_CC_BASE64_H_
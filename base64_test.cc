@@ -0,0 +1,132 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base64.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+constexpr char kGoodBase64[] = "3iv9lYwafpe0uEmxDc6PSw==";
+constexpr uint8_t kGoodBase64Bytes[] = {0xde, 0x2b, 0xfd, 0x95, 0x8c, 0x1a,
+                                        0x7e, 0x97, 0xb4, 0xb8, 0x49, 0xb1,
+                                        0x0d, 0xce, 0x8f, 0x4b};
+
+std::string Encode(const std::vector<uint8_t>& data, Base64Kernel kernel) {
+  std::string str(Base64EncodedSize(data.size()), '\0');
+  str.resize(Base64Encode(data.data(), data.size(), &str[0], kernel));
+  return str;
+}
+
+bool Decode(const std::string& str, Base64Kernel kernel,
+            std::vector<uint8_t>* data) {
+  data->resize(Base64DecodedMaxSize(str.size()));
+  size_t size = 0;
+  if (!Base64Decode(str.data(), str.size(), data->data(), &size, kernel)) {
+    return false;
+  }
+  data->resize(size);
+  return true;
+}
+
+std::vector<uint8_t> PatternBytes(size_t size) {
+  std::vector<uint8_t> data(size);
+  uint32_t state = 12345;
+  for (size_t i = 0; i < size; i++) {
+    state = state * 1103515245 + 12345;
+    data[i] = state >> 24;
+  }
+  return data;
+}
+
+std::vector<Base64Kernel> SupportedKernels() {
+  std::vector<Base64Kernel> kernels;
+  for (Base64Kernel kernel : {Base64Kernel::kScalar, Base64Kernel::kSSE41,
+                              Base64Kernel::kAVX2}) {
+    if (kernel <= GetBestBase64Kernel()) {
+      kernels.push_back(kernel);
+    }
+  }
+  return kernels;
+}
+
+class Base64Test : public ::testing::TestWithParam<Base64Kernel> {};
+
+TEST_P(Base64Test, EncodesKnownValue) {
+  EXPECT_EQ(Encode(std::vector<uint8_t>(std::begin(kGoodBase64Bytes),
+                                        std::end(kGoodBase64Bytes)),
+                   GetParam()),
+            kGoodBase64);
+}
+
+TEST_P(Base64Test, MatchesScalarForAllLengths) {
+  for (size_t size = 0; size < 200; size++) {
+    std::vector<uint8_t> data = PatternBytes(size);
+    std::string encoded = Encode(data, GetParam());
+    EXPECT_EQ(encoded, Encode(data, Base64Kernel::kScalar));
+    std::vector<uint8_t> decoded;
+    ASSERT_TRUE(Decode(encoded, GetParam(), &decoded));
+    EXPECT_EQ(decoded, data);
+  }
+}
+
+TEST_P(Base64Test, SkipsWhitespace) {
+  std::vector<uint8_t> data = PatternBytes(150);
+  std::string encoded = Encode(data, GetParam());
+  std::string wrapped;
+  for (size_t i = 0; i < encoded.size(); i++) {
+    if (i > 0 && i % 19 == 0) {
+      wrapped += (i % 2) ? "\r\n" : " \t";
+    }
+    wrapped += encoded[i];
+  }
+  wrapped += "\n";
+  std::vector<uint8_t> decoded;
+  ASSERT_TRUE(Decode(wrapped, GetParam(), &decoded));
+  EXPECT_EQ(decoded, data);
+}
+
+TEST_P(Base64Test, AcceptsMissingPadding) {
+  std::vector<uint8_t> decoded;
+  ASSERT_TRUE(Decode("3iv9lYwafpe0uEmxDc6PSw", GetParam(), &decoded));
+  EXPECT_EQ(decoded, std::vector<uint8_t>(std::begin(kGoodBase64Bytes),
+                                          std::end(kGoodBase64Bytes)));
+}
+
+TEST_P(Base64Test, RejectsInvalidInput) {
+  std::vector<uint8_t> decoded;
+  std::string encoded = Encode(PatternBytes(90), GetParam());
+  for (size_t i : {size_t{0}, size_t{17}, size_t{40}, encoded.size() - 1}) {
+    std::string bad = encoded;
+    bad[i] = '*';
+    EXPECT_FALSE(Decode(bad, GetParam(), &decoded)) << i;
+    bad[i] = '\x80';
+    EXPECT_FALSE(Decode(bad, GetParam(), &decoded)) << i;
+  }
+  EXPECT_FALSE(Decode("3iv9lYwafpe0uEmxDc6PSw=x", GetParam(), &decoded));
+  EXPECT_FALSE(Decode("3iv9lYwafpe0uEmxDc6PSw=", GetParam(), &decoded));
+  EXPECT_FALSE(Decode("3iv9l", GetParam(), &decoded));
+}
+
+INSTANTIATE_TEST_CASE_P(Kernels, Base64Test,
+                        ::testing::ValuesIn(SupportedKernels()));
+
+}  // namespace
+}  // namespace cpix
@@ -20,12 +20,13 @@
 
 #include "absl/memory/memory.h"
 #include "cpix_util.h"
+#include "glog/logging.h"
 #include "xml_node.h"
 
 namespace cpix {
 ContentKey::~ContentKey() = default;
 
-std::unique_ptr<XMLNode> ContentKey::GetNode() {
+std::unique_ptr<XMLNode> ContentKey::GetNode() const {
   if (key_value_.empty() || kid_.empty()) {
     return nullptr;
   }
@@ -93,7 +94,10 @@ bool ContentKey::Deserialize(std::unique_ptr<XMLNode> node) {
     set_id(attribute);
   }
 
-  kid_ = GUIDStringToBytes(node->GetAttribute("kid"));
+  if (!GUIDStringToBytes(node->GetAttribute("kid"), &kid_)) {
+    LOG(ERROR) << "Malformed kid attribute.";
+    return false;
+  }
 
   if (!(attribute = node->GetAttribute("explicitIV")).empty()) {
     explicit_iv_ = Base64StringToBytes(attribute);
@@ -51,7 +51,7 @@ class ContentKey : public CPIXElement {
  private:
   friend class ContentKeyList;
   friend class CPIXMessage;
-  std::unique_ptr<XMLNode> GetNode() override;
+  std::unique_ptr<XMLNode> GetNode() const override;
 
   std::vector<uint8_t> kid_;
   std::vector<uint8_t> key_value_;
@@ -14,18 +14,55 @@
 
 #include "content_key_list.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
-#include "absl/memory/memory.h"
 #include "aes_cryptor.h"
 #include "content_key.h"
 #include "cpix_element.h"
 #include "cpix_util.h"
+#include "executor.h"
+#include "glog/logging.h"
+#include "openssl/crypto.h"
+#include "openssl/sha.h"
 #include "xml_node.h"
 
 namespace cpix {
+namespace {
+
+// Keys whose random bytes are drawn with a single call.
+constexpr size_t kKeysPerBatch = 256;
+// Smallest share of a request worth handing to another thread, in batches.
+constexpr size_t kMinBatchesPerTask = 16;
+
+void SetUUIDVersion(uint8_t version, uint8_t* uuid) {
+  uuid[6] = (uuid[6] & 0x0f) | (version << 4);
+  uuid[8] = (uuid[8] & 0x3f) | 0x80;
+}
+
+// Derives the RFC 4122 name-based UUID of the decimal form of |index| in the
+// UUID namespace |kid_namespace|.
+void DeriveKid(const std::vector<uint8_t>& kid_namespace, uint64_t index,
+               uint8_t* kid) {
+  std::string name = std::to_string(index);
+  uint8_t input[kGUIDSize + 20];
+  memcpy(input, kid_namespace.data(), kGUIDSize);
+  memcpy(input + kGUIDSize, name.data(), name.size());
+  uint8_t digest[SHA_DIGEST_LENGTH];
+  SHA1(input, kGUIDSize + name.size(), digest);
+  memcpy(kid, digest, kGUIDSize);
+  SetUUIDVersion(5, kid);
+}
+
+}  // namespace
 
 ContentKeyList::~ContentKeyList() = default;
 
@@ -38,44 +75,159 @@ bool ContentKeyList::AddContentKey(std::unique_ptr<ContentKey> key) {
   return true;
 }
 
+bool ContentKeyList::AddContentKeys(
+    std::vector<std::unique_ptr<ContentKey>> keys) {
+  for (const auto& key : keys) {
+    if (key->kid().empty() || key->key_value().empty()) {
+      return false;
+    }
+  }
+
+  AddElements(std::move(keys));
+  return true;
+}
+
 ContentKey* ContentKeyList::FindContentKey(const std::vector<uint8_t>& kid) {
+  return const_cast<ContentKey*>(
+      static_cast<const ContentKeyList*>(this)->FindContentKey(kid));
+}
+
+const ContentKey* ContentKeyList::FindContentKey(
+    const std::vector<uint8_t>& kid) const {
   if (kid.empty()) {
     return nullptr;
   }
 
-  for (const auto& element : elements_) {
-    if (static_cast<ContentKey*>(element.get())->kid() == kid) {
-      return static_cast<ContentKey*>(element.get());
+  for (const ContentKey* key : elements_) {
+    if (key->kid() == kid) {
+      return key;
     }
   }
   return nullptr;
 }
 
-std::unique_ptr<CPIXElement> ContentKeyList::CreateElement() {
-  return absl::make_unique<ContentKey>();
+void ContentKeyList::GenerateRange(const ContentKeyGenerationOptions& options,
+                                   size_t offset, size_t count,
+                                   ContentKey** keys, const uint64_t* seed) {
+  const bool random_kid = options.kid_namespace.empty();
+  const size_t random_per_key = options.key_size +
+                                (random_kid ? kGUIDSize : 0) +
+                                (options.explicit_iv ? kGUIDSize : 0);
+  std::vector<uint8_t> random(random_per_key * std::min(count, kKeysPerBatch));
+
+  for (size_t batch = 0; batch < count; batch += kKeysPerBatch) {
+    size_t batch_size = std::min(count - batch, kKeysPerBatch);
+    if (seed) {
+      ScopedDeterministicRandom stream(*seed +
+                                       (offset + batch) / kKeysPerBatch);
+      GetRandomBytes(random.data(), batch_size * random_per_key);
+    } else {
+      GetRandomBytes(random.data(), batch_size * random_per_key);
+    }
+    const uint8_t* bytes = random.data();
+    for (size_t i = batch; i < batch + batch_size; i++) {
+      ContentKey* key = keys[i];
+      key->kid_.resize(kGUIDSize);
+      if (random_kid) {
+        memcpy(key->kid_.data(), bytes, kGUIDSize);
+        SetUUIDVersion(4, key->kid_.data());
+        bytes += kGUIDSize;
+      } else {
+        DeriveKid(options.kid_namespace, options.first_index + offset + i,
+                  key->kid_.data());
+      }
+      key->key_value_.assign(bytes, bytes + options.key_size);
+      bytes += options.key_size;
+      if (options.explicit_iv) {
+        key->explicit_iv_.assign(bytes, bytes + kGUIDSize);
+        bytes += kGUIDSize;
+      }
+    }
+  }
+  OPENSSL_cleanse(random.data(), random.size());
 }
 
-bool ContentKeyList::DecryptContentKeys(
-    const std::vector<uint8_t>& decrypt_key) {
-  if (decrypt_key.empty()) {
+bool ContentKeyList::GenerateContentKeys(
+    const ContentKeyGenerationOptions& options,
+    std::vector<ContentKey*>* generated) {
+  if (options.key_size != 16 && options.key_size != 32) {
+    LOG(ERROR) << "Content keys must be 16 or 32 bytes.";
+    return false;
+  }
+  if (!options.kid_namespace.empty() &&
+      options.kid_namespace.size() != kGUIDSize) {
+    LOG(ERROR) << "KID namespace must be a 16-byte UUID.";
     return false;
   }
 
-  for (const auto& key : elements_) {
-    ContentKey* key_ptr = static_cast<ContentKey*>(key.get());
-    std::unique_ptr<AESCryptor> aes = AESCryptor::Create(decrypt_key);
-    if (!key_ptr->explicit_iv().empty()) {
-      if (!aes->SetIV(key_ptr->explicit_iv())) {
-        return false;
-      }
-    }
-    std::vector<uint8_t> plaintext = aes->CBCDecrypt(key_ptr->key_value());
+  const size_t first = elements_.size();
+  Reserve(first + options.count);
+  for (size_t i = 0; i < options.count; i++) {
+    EmplaceElement();
+  }
+  ContentKey** keys = elements_.data() + first;
 
-    if (plaintext.empty()) {
-      return false;
-    }
-    key_ptr->SetKeyValue(plaintext);
+  // In deterministic mode each batch draws from its own stream, seeded from
+  // the caller's, so the keys do not depend on how batches are spread over the
+  // executor.
+  uint64_t seed = 0;
+  const bool deterministic = IsDeterministicRandom();
+  if (deterministic) {
+    uint8_t bytes[sizeof(seed)];
+    GetRandomBytes(bytes, sizeof(bytes));
+    memcpy(&seed, bytes, sizeof(seed));
+  }
+  const size_t batches = (options.count + kKeysPerBatch - 1) / kKeysPerBatch;
+  ParallelFor(executor_, batches, kMinBatchesPerTask,
+              [&options, keys, deterministic, &seed](size_t begin, size_t end) {
+                size_t offset = begin * kKeysPerBatch;
+                size_t count =
+                    std::min(end * kKeysPerBatch, options.count) - offset;
+                GenerateRange(options, offset, count, keys + offset,
+                              deterministic ? &seed : nullptr);
+              });
+
+  if (generated) {
+    generated->insert(generated->end(), elements_.begin() + first,
+                      elements_.end());
   }
   return true;
 }
+
+bool ContentKeyList::DecryptContentKeys(
+    const std::vector<uint8_t>& decrypt_key) {
+  if (decrypt_key.empty()) {
+    return false;
+  }
+
+  std::atomic<bool> ok(true);
+  ParallelFor(executor_, elements_.size(), kParallelGrain,
+              [this, &decrypt_key, &ok](size_t begin, size_t end) {
+                std::unique_ptr<AESCryptor> aes =
+                    AESCryptor::Create(decrypt_key);
+                if (!aes) {
+                  ok.store(false);
+                  return;
+                }
+                const std::vector<uint8_t> zero_iv(16, 0);
+                for (size_t i = begin; i < end && ok.load(); i++) {
+                  ContentKey* key_ptr = elements_[i];
+                  const std::vector<uint8_t>& iv =
+                      key_ptr->explicit_iv().empty() ? zero_iv
+                                                     : key_ptr->explicit_iv();
+                  if (!aes->SetIV(iv)) {
+                    ok.store(false);
+                    return;
+                  }
+                  std::vector<uint8_t> plaintext =
+                      aes->CBCDecrypt(key_ptr->key_value());
+                  if (plaintext.empty()) {
+                    ok.store(false);
+                    return;
+                  }
+                  key_ptr->SetKeyValue(plaintext);
+                }
+              });
+  return ok.load();
+}
 }  // namespace cpix
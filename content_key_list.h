@@ -15,6 +15,8 @@
 #ifndef CPIX_CC_CONTENT_KEY_LIST_H_
 #define CPIX_CC_CONTENT_KEY_LIST_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,16 +26,54 @@
 #include "cpix_element_list.h"
 
 namespace cpix {
-class ContentKeyList : public CPIXElementList {
+
+// Describes a batch of content keys for ContentKeyList::GenerateContentKeys.
+struct ContentKeyGenerationOptions {
+  // Number of keys to generate.
+  size_t count = 0;
+
+  // Size of each key value in bytes; either 16 or 32.
+  size_t key_size = 16;
+
+  // When set, every key gets a random 16-byte explicit IV.
+  bool explicit_iv = false;
+
+  // When empty, KIDs are random (version 4) UUIDs. Otherwise this must be a
+  // 16-byte UUID, and the KID of key i is the name-based (version 5) UUID of
+  // the decimal string first_index + i in that namespace, so the same catalog
+  // position always maps to the same KID.
+  std::vector<uint8_t> kid_namespace;
+  uint64_t first_index = 0;
+};
+
+class ContentKeyList : public CPIXElementList<ContentKey> {
  public:
-  ContentKeyList() : CPIXElementList("ContentKeyList") {}
+  ContentKeyList() : CPIXElementList<ContentKey>("ContentKeyList") {}
   ~ContentKeyList();
   bool AddContentKey(std::unique_ptr<ContentKey> key);
+
+  // Adds all of |keys|, or none of them if any key lacks a KID or value.
+  bool AddContentKeys(std::vector<std::unique_ptr<ContentKey>> keys);
   ContentKey* FindContentKey(const std::vector<uint8_t>& kid);
+  const ContentKey* FindContentKey(const std::vector<uint8_t>& kid) const;
+
+  // Appends options.count freshly generated keys to the list. Random bytes are
+  // drawn in batches, and large requests are spread over the executor. If
+  // |generated| is not null, pointers to the new keys are appended to it.
+  // Returns false, adding nothing, if the options are invalid.
+  bool GenerateContentKeys(const ContentKeyGenerationOptions& options,
+                           std::vector<ContentKey*>* generated = nullptr);
 
  private:
   friend class CPIXMessage;
-  std::unique_ptr<CPIXElement> CreateElement();
+
+  // Fills in the |count| empty keys starting at |keys|, treating the first of
+  // them as key number |offset| of the request, a multiple of the batch size.
+  // If |seed| is not null, each batch is drawn from the deterministic stream
+  // of *|seed| plus the batch number.
+  static void GenerateRange(const ContentKeyGenerationOptions& options,
+                            size_t offset, size_t count, ContentKey** keys,
+                            const uint64_t* seed);
   bool DecryptContentKeys(const std::vector<uint8_t>& decrypt_key);
 };
 }  // namespace cpix
@@ -15,11 +15,14 @@
 #include "content_key_list.h"
 
 #include <memory>
+#include <set>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "content_key.h"
 #include "cpix_util.h"
+#include "executor.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "testable_cpix_element.h"
@@ -34,7 +37,7 @@ using ::testing::Test;
 
 class MockContentKey : public ContentKey {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 constexpr char kGoodXML[] =
@@ -68,5 +71,95 @@ TEST(ContentKeyListTest, SerializeContentKeyList) {
   EXPECT_EQ(key_list.Serialize(), kGoodXML);
 }
 
+TEST(ContentKeyListTest, GenerateRandomContentKeys) {
+  ContentKeyList key_list;
+  ContentKeyGenerationOptions options;
+  options.count = 10000;
+  options.key_size = 32;
+  options.explicit_iv = true;
+  WorkStealingPool pool(4);
+  key_list.set_executor(&pool);
+  std::vector<ContentKey*> keys;
+  ASSERT_TRUE(key_list.GenerateContentKeys(options, &keys));
+  ASSERT_EQ(keys.size(), 10000);
+
+  std::set<std::vector<uint8_t>> kids;
+  for (ContentKey* key : keys) {
+    ASSERT_EQ(key->kid().size(), 16);
+    EXPECT_EQ(key->kid()[6] >> 4, 4);
+    EXPECT_EQ(key->key_value().size(), 32);
+    EXPECT_EQ(key->explicit_iv().size(), 16);
+    EXPECT_FALSE(key->is_encrypted());
+    kids.insert(key->kid());
+  }
+  EXPECT_EQ(kids.size(), keys.size());
+  EXPECT_EQ(key_list.FindContentKey(keys.back()->kid()), keys.back());
+}
+
+TEST(ContentKeyListTest, GenerateDeterministicContentKeys) {
+  ContentKeyGenerationOptions options;
+  options.count = 10000;
+  options.explicit_iv = true;
+
+  std::vector<ContentKey*> serial_keys;
+  ContentKeyList serial;
+  {
+    ScopedDeterministicRandom deterministic(7);
+    ASSERT_TRUE(serial.GenerateContentKeys(options, &serial_keys));
+  }
+
+  WorkStealingPool pool(4);
+  std::vector<ContentKey*> parallel_keys;
+  ContentKeyList parallel;
+  parallel.set_executor(&pool);
+  std::vector<uint8_t> next;
+  {
+    ScopedDeterministicRandom deterministic(7);
+    ASSERT_TRUE(parallel.GenerateContentKeys(options, &parallel_keys));
+    next = GetRandomBytes(16);
+  }
+
+  ASSERT_EQ(parallel_keys.size(), serial_keys.size());
+  for (size_t i = 0; i < serial_keys.size(); i++) {
+    ASSERT_EQ(parallel_keys[i]->kid(), serial_keys[i]->kid()) << i;
+    ASSERT_EQ(parallel_keys[i]->key_value(), serial_keys[i]->key_value());
+    ASSERT_EQ(parallel_keys[i]->explicit_iv(), serial_keys[i]->explicit_iv());
+  }
+
+  // The caller's stream carries on the same way after either.
+  ScopedDeterministicRandom deterministic(7);
+  ContentKeyList again;
+  ASSERT_TRUE(again.GenerateContentKeys(options));
+  EXPECT_EQ(GetRandomBytes(16), next);
+}
+
+TEST(ContentKeyListTest, GenerateDerivedContentKeys) {
+  ContentKeyList key_list;
+  ContentKeyGenerationOptions options;
+  options.count = 42;
+  options.kid_namespace =
+      GUIDStringToBytes("6ba7b810-9dad-11d1-80b4-00c04fd430c8");
+  std::vector<ContentKey*> keys;
+  ASSERT_TRUE(key_list.GenerateContentKeys(options, &keys));
+  ASSERT_EQ(keys.size(), 42);
+  EXPECT_EQ(BytesToGUID(keys[0]->kid()),
+            "6af613b6-569c-5c22-9c37-2ed93f31d3af");
+  EXPECT_EQ(BytesToGUID(keys[41]->kid()),
+            "c13d0b5d-1ca3-57b6-a23f-8586bca44928");
+  EXPECT_EQ(keys[0]->key_value().size(), 16);
+  EXPECT_TRUE(keys[0]->explicit_iv().empty());
+}
+
+TEST(ContentKeyListTest, GenerateContentKeysRejectsBadOptions) {
+  ContentKeyList key_list;
+  ContentKeyGenerationOptions options;
+  options.count = 1;
+  options.key_size = 24;
+  EXPECT_FALSE(key_list.GenerateContentKeys(options));
+  options.key_size = 16;
+  options.kid_namespace = std::vector<uint8_t>(8);
+  EXPECT_FALSE(key_list.GenerateContentKeys(options));
+}
+
 }  // namespace
 }  // namespace cpix
@@ -0,0 +1,103 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpix_batch.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpix_message.h"
+#include "cpix_message_cache.h"
+#include "executor.h"
+#include "glog/logging.h"
+#include "rsa_private_key.h"
+#include "xml_util.h"
+
+namespace cpix {
+namespace {
+
+// Runs |fn|(i) for every document index, one document per task.
+void ForEachDocument(Executor* executor, size_t count,
+                     const std::function<void(size_t)>& fn) {
+  ParallelFor(executor, count, 1, [&fn](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      fn(i);
+    }
+  });
+}
+
+// std::vector<bool> packs its elements into shared words, so results are
+// collected as bytes and converted at the end.
+std::vector<bool> ToBools(const std::vector<uint8_t>& results) {
+  return std::vector<bool>(results.begin(), results.end());
+}
+
+}  // namespace
+
+CPIXBatch::CPIXBatch(Executor* executor)
+    : executor_(executor ? executor : DefaultExecutor()) {}
+
+CPIXBatch::~CPIXBatch() = default;
+
+std::vector<std::string> CPIXBatch::Serialize(
+    const std::vector<CPIXMessage*>& messages) {
+  std::vector<std::string> results(messages.size());
+  ForEachDocument(executor_, messages.size(), [&messages, &results](size_t i) {
+    results[i] = messages[i]->ToString();
+  });
+  return results;
+}
+
+std::vector<std::shared_ptr<const CPIXMessage>> CPIXBatch::Parse(
+    const std::vector<std::string>& documents, CPIXMessageCache* cache) {
+  std::vector<std::shared_ptr<const CPIXMessage>> results(documents.size());
+  ForEachDocument(executor_, documents.size(),
+                  [&documents, &results, cache](size_t i) {
+                    results[i] = cache ? cache->Parse(documents[i])
+                                       : CPIXMessage::Parse(documents[i]);
+                  });
+  return results;
+}
+
+std::vector<bool> CPIXBatch::Validate(const std::vector<std::string>& documents,
+                                      const std::string& schema_uri) {
+  std::vector<uint8_t> results(documents.size());
+  ForEachDocument(executor_, documents.size(),
+                  [&documents, &schema_uri, &results](size_t i) {
+                    results[i] = ValidateXML(documents[i], schema_uri);
+                  });
+  return ToBools(results);
+}
+
+std::vector<bool> CPIXBatch::Decrypt(const std::vector<CPIXMessage*>& messages,
+                                     const std::vector<uint8_t>& private_key) {
+  std::unique_ptr<RSAPrivateKey> key =
+      RSAPrivateKey::CreateFromDER(private_key);
+  if (!key) {
+    LOG(ERROR) << "Invalid private key";
+    return std::vector<bool>(messages.size(), false);
+  }
+  std::vector<uint8_t> results(messages.size());
+  RSAPrivateKey* shared_key = key.get();
+  ForEachDocument(executor_, messages.size(),
+                  [&messages, &results, shared_key](size_t i) {
+                    results[i] = messages[i]->DecryptWith(shared_key);
+                  });
+  return ToBools(results);
+}
+
+}  // namespace cpix
@@ -0,0 +1,70 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_CPIX_BATCH_H_
+#define CPIX_CC_CPIX_BATCH_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpix_message.h"
+#include "cpix_message_cache.h"
+#include "executor.h"
+
+namespace cpix {
+
+// CPIXBatch processes many documents at once, one document per task on an
+// executor. Per-document setup is shared across the batch: schemas are
+// compiled once, the private key is parsed once, and recipient certificates
+// are parsed once per process. Results are always returned in input order.
+class CPIXBatch {
+ public:
+  // Runs on |executor|, or on DefaultExecutor() if |executor| is null. The
+  // executor is not owned.
+  explicit CPIXBatch(Executor* executor = nullptr);
+  ~CPIXBatch();
+
+  CPIXBatch(const CPIXBatch&) = delete;
+  CPIXBatch& operator=(const CPIXBatch&) = delete;
+
+  // Seals and serializes each message. A message that fails to serialize
+  // yields an empty string. The messages must be distinct.
+  std::vector<std::string> Serialize(const std::vector<CPIXMessage*>& messages);
+
+  // Parses each document. A document that fails to parse yields nullptr. If
+  // |cache| is not null, documents are parsed through it, so duplicates within
+  // and across batches share one message.
+  std::vector<std::shared_ptr<const CPIXMessage>> Parse(
+      const std::vector<std::string>& documents,
+      CPIXMessageCache* cache = nullptr);
+
+  // Validates each document against the schema at |schema_uri|.
+  std::vector<bool> Validate(const std::vector<std::string>& documents,
+                             const std::string& schema_uri);
+
+  // Decrypts the content keys of each message with the DER-encoded
+  // |private_key|. Returns all false if the key cannot be parsed. The
+  // messages must be distinct.
+  std::vector<bool> Decrypt(const std::vector<CPIXMessage*>& messages,
+                            const std::vector<uint8_t>& private_key);
+
+ private:
+  Executor* executor_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_CPIX_BATCH_H_
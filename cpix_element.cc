@@ -14,12 +14,14 @@
 
 #include "cpix_element.h"
 
+#include "xml_arena.h"
 #include "xml_node.h"
 
 namespace cpix {
 CPIXElement::~CPIXElement() = default;
 
-std::string CPIXElement::Serialize() {
+std::string CPIXElement::Serialize() const {
+  XMLArena arena;
   std::unique_ptr<XMLNode> root = GetNode();
   return root ? root->AsString() : "";
 }
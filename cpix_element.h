@@ -35,22 +35,23 @@ class CPIXElement {
   CPIXElement(const CPIXElement&) = delete;
   CPIXElement& operator=(const CPIXElement&) = delete;
 
-  const std::string& id() { return id_; }
+  const std::string& id() const { return id_; }
   void set_id(const std::string& id) { id_ = id; }
 
  protected:
   // Returns an XML-formatted string representation of the Element according to
   // the CPIX specification.
-  std::string Serialize();
+  std::string Serialize() const;
 
   // Takes in a stringified XML document and extracts information pertaining to
   // the given derivation of CPIXElement.
   virtual bool Deserialize(std::unique_ptr<XMLNode> node) = 0;
 
   // Creates a hierarchy of XMLNodes representing the current object.
-  virtual std::unique_ptr<XMLNode> GetNode() = 0;
+  virtual std::unique_ptr<XMLNode> GetNode() const = 0;
 
  private:
+  template <typename ElementType>
   friend class CPIXElementList;
   std::string id_;
 };
@@ -15,30 +15,420 @@
 #ifndef CPIX_CC_CPIX_ELEMENT_LIST_H_
 #define CPIX_CC_CPIX_ELEMENT_LIST_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "cpix_element.h"
+#include "executor.h"
+#include "xml_arena.h"
+#include "xml_node.h"
 
 namespace cpix {
-class XMLNode;
 
+// A list of CPIX elements of type ElementType, serialized as an XML element
+// named |element_list_name| with one child per element.
+//
+// Elements created by the list itself, on deserialization or through
+// EmplaceElement(), are constructed in place in large contiguous blocks, so
+// iterating over big lists stays cache-friendly. Elements handed in by callers
+// keep their own allocation, which also lets them be subclasses of
+// ElementType. Either way an element never moves once added, so pointers to
+// elements stay valid until the element is removed or the list destroyed.
+//
+// For documents that are re-sent with small changes, the list can keep the
+// serialized XML of each element and reuse it until the element is removed,
+// so that serializing again only renders the elements added since.
+template <typename ElementType>
 class CPIXElementList : public CPIXElement {
  public:
-  CPIXElementList(const std::string& element_list_name);
-  ~CPIXElementList();
+  explicit CPIXElementList(const std::string& element_list_name)
+      : element_list_name_(element_list_name) {}
+  ~CPIXElementList() override;
+
+  // Reserves storage for at least |count| elements in total.
+  void Reserve(size_t count);
+
+  // Returns the number of elements in the list.
+  size_t size() const { return elements_.size(); }
+
+  // Sets the executor that large lists are deserialized on, or null to do all
+  // work on the calling thread. The executor is not owned.
+  void set_executor(Executor* executor) { executor_ = executor; }
+
+  // Sets whether RenderFragments() keeps the serialized XML of each element
+  // for AppendXML() to reuse. Kept fragments are discarded when turned off.
+  // Elements must not be modified in place once rendered unless their
+  // fragment is invalidated.
+  void set_reuse_fragments(bool reuse);
 
  protected:
-  bool Deserialize(std::unique_ptr<XMLNode> node);
-  std::unique_ptr<XMLNode> GetNode() override;
-  void AddElement(std::unique_ptr<CPIXElement> element);
-  virtual std::unique_ptr<CPIXElement> CreateElement() = 0;
+  bool Deserialize(std::unique_ptr<XMLNode> node) override;
+  std::unique_ptr<XMLNode> GetNode() const override;
+
+  // Default-constructs a new element in the list's own storage, appends it and
+  // returns it.
+  ElementType* EmplaceElement();
+
+  void AddElement(std::unique_ptr<ElementType> element);
+
+  // Appends all of |elements|, growing the storage at most once.
+  void AddElements(std::vector<std::unique_ptr<ElementType>> elements);
+
+  // Removes and destroys every element for which |remove| returns true,
+  // keeping the rest in order. Emplaced storage is released once all elements
+  // of a block are gone. Returns the number of elements removed.
+  template <typename Predicate>
+  size_t RemoveElements(Predicate remove);
+
+  // Serializes, on the executor, every element without a kept fragment, if
+  // fragments are reused.
+  void RenderFragments();
+
+  // Discards kept fragments, of one element or of all of them.
+  void InvalidateFragment(const ElementType* element);
+  void InvalidateFragments() { fragments_.clear(); }
+
+  // Appends the XML of the list to |out|, the same as serializing GetNode()
+  // would give, reusing kept fragments. Must be called with an XMLArena
+  // active. Returns false, leaving |out| unchanged, if an element cannot be
+  // serialized.
+  bool AppendXML(std::string* out) const;
 
   std::string element_list_name_;
-  std::vector<std::unique_ptr<CPIXElement>> elements_;
+
+  // Every element of the list, in document order.
+  std::vector<ElementType*> elements_;
+
+  // Lists shorter than this are processed on the calling thread even if an
+  // executor is set.
+  static constexpr size_t kParallelGrain = 256;
+
+  Executor* executor_ = nullptr;
+
+ private:
+  // Raw storage for |capacity| elements, of which the first |used| have been
+  // constructed.
+  struct Block {
+    struct Deleter {
+      void operator()(ElementType* ptr) const { ::operator delete(ptr); }
+    };
+
+    explicit Block(size_t capacity)
+        : data(static_cast<ElementType*>(
+              ::operator new(capacity * sizeof(ElementType)))),
+          capacity(capacity) {}
+
+    std::unique_ptr<ElementType, Deleter> data;
+    size_t capacity;
+    size_t used = 0;
+    // Which of the constructed elements have been removed, sized on the first
+    // removal.
+    std::vector<bool> removed;
+    size_t removed_count = 0;
+  };
+
+  static constexpr size_t kMinBlockCapacity = 64;
+
+  // Destroys the most recently emplaced element, and its block if that leaves
+  // the block empty.
+  void RemoveLastEmplacedElement();
+
+  std::vector<Block> blocks_;
+  std::vector<std::unique_ptr<ElementType>> adopted_;
+
+  bool reuse_fragments_ = false;
+  absl::flat_hash_map<const ElementType*, std::string> fragments_;
 };
+
+template <typename ElementType>
+constexpr size_t CPIXElementList<ElementType>::kMinBlockCapacity;
+
+template <typename ElementType>
+constexpr size_t CPIXElementList<ElementType>::kParallelGrain;
+
+template <typename ElementType>
+CPIXElementList<ElementType>::~CPIXElementList() {
+  for (Block& block : blocks_) {
+    for (size_t i = 0; i < block.used; i++) {
+      if (block.removed.empty() || !block.removed[i]) {
+        block.data.get()[i].~ElementType();
+      }
+    }
+  }
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::set_reuse_fragments(bool reuse) {
+  reuse_fragments_ = reuse;
+  if (!reuse) {
+    fragments_.clear();
+  }
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::Reserve(size_t count) {
+  elements_.reserve(count);
+  size_t available =
+      blocks_.empty() ? 0 : blocks_.back().capacity - blocks_.back().used;
+  // Emplacing only fills the last block, so a new one must hold all of the
+  // elements still to come; the spare room of the old one goes unused.
+  if (count > elements_.size() + available) {
+    blocks_.emplace_back(count - elements_.size());
+  }
+}
+
+template <typename ElementType>
+ElementType* CPIXElementList<ElementType>::EmplaceElement() {
+  if (blocks_.empty() || blocks_.back().used == blocks_.back().capacity) {
+    blocks_.emplace_back(std::max(kMinBlockCapacity, elements_.size()));
+  }
+  Block& block = blocks_.back();
+  ElementType* element = new (block.data.get() + block.used) ElementType();
+  block.used++;
+  elements_.push_back(element);
+  return element;
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::RemoveLastEmplacedElement() {
+  Block& block = blocks_.back();
+  block.used--;
+  block.data.get()[block.used].~ElementType();
+  elements_.pop_back();
+  // Elements emplaced together may span blocks, so the one before is next.
+  if (block.used == 0) {
+    blocks_.pop_back();
+  }
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::AddElement(
+    std::unique_ptr<ElementType> element) {
+  elements_.push_back(element.get());
+  adopted_.push_back(std::move(element));
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::AddElements(
+    std::vector<std::unique_ptr<ElementType>> elements) {
+  size_t needed = elements_.size() + elements.size();
+  if (needed > elements_.capacity()) {
+    elements_.reserve(std::max(needed, 2 * elements_.capacity()));
+  }
+  adopted_.reserve(adopted_.size() + elements.size());
+  for (auto& element : elements) {
+    AddElement(std::move(element));
+  }
+}
+
+template <typename ElementType>
+template <typename Predicate>
+size_t CPIXElementList<ElementType>::RemoveElements(Predicate remove) {
+  std::vector<ElementType*> removed;
+  size_t kept = 0;
+  for (ElementType* element : elements_) {
+    if (remove(static_cast<const ElementType&>(*element))) {
+      removed.push_back(element);
+    } else {
+      elements_[kept++] = element;
+    }
+  }
+  elements_.resize(kept);
+  if (removed.empty()) {
+    return 0;
+  }
+
+  std::vector<const ElementType*> adopted;
+  for (ElementType* element : removed) {
+    fragments_.erase(element);
+    auto block = std::find_if(
+        blocks_.begin(), blocks_.end(), [element](const Block& block) {
+          return std::less_equal<const ElementType*>()(block.data.get(),
+                                                       element) &&
+                 std::less<const ElementType*>()(
+                     element, block.data.get() + block.used);
+        });
+    if (block == blocks_.end()) {
+      adopted.push_back(element);
+      continue;
+    }
+    if (block->removed.empty()) {
+      block->removed.resize(block->capacity);
+    }
+    block->removed[element - block->data.get()] = true;
+    block->removed_count++;
+    element->~ElementType();
+  }
+
+  blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end(),
+                               [](const Block& block) {
+                                 return block.used > 0 &&
+                                        block.removed_count == block.used;
+                               }),
+                blocks_.end());
+  if (!adopted.empty()) {
+    std::sort(adopted.begin(), adopted.end(),
+              std::less<const ElementType*>());
+    adopted_.erase(
+        std::remove_if(adopted_.begin(), adopted_.end(),
+                       [&adopted](const std::unique_ptr<ElementType>& element) {
+                         return std::binary_search(
+                             adopted.begin(), adopted.end(), element.get(),
+                             std::less<const ElementType*>());
+                       }),
+        adopted_.end());
+  }
+  return removed.size();
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::RenderFragments() {
+  if (!reuse_fragments_) {
+    return;
+  }
+  std::vector<ElementType*> missing;
+  for (ElementType* element : elements_) {
+    if (fragments_.find(element) == fragments_.end()) {
+      missing.push_back(element);
+    }
+  }
+  std::vector<std::string> rendered(missing.size());
+  ParallelFor(executor_, missing.size(), kParallelGrain,
+              [&missing, &rendered](size_t begin, size_t end) {
+                XMLArena arena;
+                for (size_t i = begin; i < end; i++) {
+                  const CPIXElement* element = missing[i];
+                  std::unique_ptr<XMLNode> node = element->GetNode();
+                  if (node) {
+                    rendered[i] = node->AsString();
+                  }
+                }
+              });
+  for (size_t i = 0; i < missing.size(); i++) {
+    if (!rendered[i].empty()) {
+      fragments_[missing[i]] = std::move(rendered[i]);
+    }
+  }
+}
+
+template <typename ElementType>
+void CPIXElementList<ElementType>::InvalidateFragment(
+    const ElementType* element) {
+  fragments_.erase(element);
+}
+
+template <typename ElementType>
+bool CPIXElementList<ElementType>::AppendXML(std::string* out) const {
+  if (elements_.empty()) {
+    return true;
+  }
+
+  // Serializing the empty list element takes care of escaping the id.
+  XMLNode root("", element_list_name_);
+  if (!id().empty()) {
+    root.AddAttribute("id", id());
+  }
+  const size_t mark = out->size();
+  std::string open_tag = root.AsString();
+  out->append(open_tag, 0, open_tag.size() - 2);
+  out->push_back('>');
+
+  for (const ElementType* element : elements_) {
+    auto fragment = fragments_.find(element);
+    if (fragment != fragments_.end()) {
+      out->append(fragment->second);
+      continue;
+    }
+    std::unique_ptr<XMLNode> node =
+        static_cast<const CPIXElement*>(element)->GetNode();
+    if (!node) {
+      out->resize(mark);
+      return false;
+    }
+    out->append(node->AsString());
+  }
+
+  out->append("</");
+  out->append(element_list_name_);
+  out->push_back('>');
+  return true;
+}
+
+template <typename ElementType>
+bool CPIXElementList<ElementType>::Deserialize(std::unique_ptr<XMLNode> node) {
+  if (!node) {
+    return true;
+  }
+
+  std::string attribute;
+  if (!(attribute = node->GetAttribute("id")).empty()) {
+    set_id(attribute);
+  }
+
+  std::vector<std::unique_ptr<XMLNode>> children;
+  std::unique_ptr<XMLNode> child_node;
+  // TODO(noahmdavis): check to make sure child_node is correct element type
+  while ((child_node = node->GetFirstChild())) {
+    children.push_back(std::move(child_node));
+  }
+
+  // Children are detached from the document above, so each one can be read
+  // on a different thread.
+  const size_t first = elements_.size();
+  Reserve(first + children.size());
+  for (size_t i = 0; i < children.size(); i++) {
+    EmplaceElement();
+  }
+  std::vector<uint8_t> parsed(children.size());
+  ParallelFor(executor_, children.size(), kParallelGrain,
+              [this, first, &children, &parsed](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                  CPIXElement* element = elements_[first + i];
+                  parsed[i] = element->Deserialize(std::move(children[i]));
+                }
+              });
+
+  // Like a sequential parse, keep the elements before the first failure.
+  size_t failed = std::find(parsed.begin(), parsed.end(), 0) - parsed.begin();
+  while (elements_.size() > first + failed) {
+    RemoveLastEmplacedElement();
+  }
+  return failed == children.size();
+}
+
+template <typename ElementType>
+std::unique_ptr<XMLNode> CPIXElementList<ElementType>::GetNode() const {
+  if (elements_.empty()) {
+    return nullptr;
+  }
+
+  std::unique_ptr<XMLNode> root =
+      absl::make_unique<XMLNode>("", element_list_name_);
+
+  if (!id().empty()) {
+    root->AddAttribute("id", id());
+  }
+
+  for (CPIXElement* element : elements_) {
+    std::unique_ptr<XMLNode> element_node = element->GetNode();
+    if (!element_node) {
+      return nullptr;
+    }
+    root->AddChild(std::move(element_node));
+  }
+
+  return root;
+}
+
 }  // namespace cpix
 
 #endif  // CPIX_CC_CPIX_ELEMENT_LIST_H_
@@ -15,13 +15,16 @@
 #include "cpix_element_list.h"
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "cpix_element.h"
 #include "gtest/gtest.h"
 #include "testable_cpix_element.h"
 #include "testable_cpix_element_list.h"
+#include "xml_arena.h"
 #include "xml_node.h"
 
 namespace cpix {
@@ -42,22 +45,88 @@ class DummyCPIXElement : public CPIXElement {
   bool Deserialize(std::unique_ptr<XMLNode> node) { return true; }
 
  private:
-  std::unique_ptr<XMLNode> GetNode() {
+  std::unique_ptr<XMLNode> GetNode() const override {
     return absl::make_unique<XMLNode>("", "CPIXElementTest");
   }
 };
 
-class DummyCPIXElementList : public CPIXElementList {
+class DummyCPIXElementList : public CPIXElementList<DummyCPIXElement> {
  public:
   DummyCPIXElementList() : CPIXElementList("CPIXElementList") {}
   ~DummyCPIXElementList() = default;
 
+  using CPIXElementList::AddElement;
+  using CPIXElementList::elements_;
+  using CPIXElementList::EmplaceElement;
+};
+
+// Counts renders and live instances, and serializes its id.
+class CountingElement : public CPIXElement {
+ public:
+  CountingElement() { live++; }
+  ~CountingElement() override { live--; }
+
+  static int live;
+  static int renders;
+
+ protected:
+  bool Deserialize(std::unique_ptr<XMLNode> node) override { return true; }
+
  private:
-  std::unique_ptr<CPIXElement> CreateElement() {
-    return absl::make_unique<DummyCPIXElement>();
+  std::unique_ptr<XMLNode> GetNode() const override {
+    renders++;
+    std::unique_ptr<XMLNode> node = absl::make_unique<XMLNode>("", "E");
+    node->AddAttribute("id", id());
+    return node;
   }
 };
 
+int CountingElement::live = 0;
+int CountingElement::renders = 0;
+
+class CountingElementList : public CPIXElementList<CountingElement> {
+ public:
+  CountingElementList() : CPIXElementList("L") {}
+
+  using CPIXElementList::AddElement;
+  using CPIXElementList::AppendXML;
+  using CPIXElementList::elements_;
+  using CPIXElementList::EmplaceElement;
+  using CPIXElementList::RemoveElements;
+  using CPIXElementList::RenderFragments;
+  using CPIXElementList::Serialize;
+};
+
+// Fails to deserialize from nodes with a "bad" attribute, and counts live
+// instances.
+class CheckedElement : public CPIXElement {
+ public:
+  CheckedElement() { live++; }
+  ~CheckedElement() override { live--; }
+
+  static int live;
+
+ protected:
+  bool Deserialize(std::unique_ptr<XMLNode> node) override {
+    return node->GetAttribute("bad").empty();
+  }
+
+ private:
+  std::unique_ptr<XMLNode> GetNode() const override {
+    return absl::make_unique<XMLNode>("", "E");
+  }
+};
+
+int CheckedElement::live = 0;
+
+class CheckedElementList : public CPIXElementList<CheckedElement> {
+ public:
+  CheckedElementList() : CPIXElementList("L") {}
+
+  using CPIXElementList::Deserialize;
+  using CPIXElementList::EmplaceElement;
+};
+
 TEST(CPIXElementListTest, SerializeList) {
   TestableCPIXElementList<DummyCPIXElementList> element_list;
   std::unique_ptr<TestableCPIXElement<DummyCPIXElement>> element1 =
@@ -77,5 +146,126 @@ TEST(CPIXElementListTest, DeserializeList) {
   EXPECT_TRUE(element_list.Deserialize(std::move(node)));
   EXPECT_EQ(element_list.Serialize(), kGoodXML);
 }
+
+TEST(CPIXElementListTest, ElementsDoNotMove) {
+  DummyCPIXElementList element_list;
+  element_list.Reserve(10);
+  std::vector<DummyCPIXElement*> elements;
+  for (int i = 0; i < 1000; i++) {
+    if (i % 10 == 0) {
+      std::unique_ptr<DummyCPIXElement> element =
+          absl::make_unique<DummyCPIXElement>();
+      elements.push_back(element.get());
+      element_list.AddElement(std::move(element));
+    } else {
+      elements.push_back(element_list.EmplaceElement());
+    }
+  }
+  EXPECT_EQ(element_list.size(), 1000);
+  EXPECT_EQ(element_list.elements_, elements);
+  // The first ten slots were reserved in one block.
+  EXPECT_EQ(elements[2] + 1, elements[3]);
+}
+TEST(CPIXElementListTest, ReserveAfterPartlyUsedBlock) {
+  DummyCPIXElementList element_list;
+  element_list.EmplaceElement();
+  element_list.Reserve(101);
+  std::vector<DummyCPIXElement*> elements;
+  for (int i = 0; i < 100; i++) {
+    elements.push_back(element_list.EmplaceElement());
+  }
+  // All of the reserved elements went into one block.
+  for (int i = 1; i < 100; i++) {
+    EXPECT_EQ(elements[i - 1] + 1, elements[i]);
+  }
+}
+
+TEST(CPIXElementListTest, RollsBackFailedParseAcrossBlocks) {
+  {
+    CheckedElementList element_list;
+    // Leaves spare room in the first block, so the parse below spans more
+    // than one block.
+    element_list.Reserve(10);
+    element_list.EmplaceElement();
+
+    std::string xml = "<L><E bad=\"1\"/>";
+    for (int i = 1; i < 100; i++) {
+      xml += "<E/>";
+    }
+    xml += "</L>";
+    EXPECT_FALSE(element_list.Deserialize(absl::make_unique<XMLNode>(xml)));
+    EXPECT_EQ(element_list.size(), 1);
+    EXPECT_EQ(CheckedElement::live, 1);
+
+    // The list is still usable.
+    for (int i = 0; i < 100; i++) {
+      element_list.EmplaceElement();
+    }
+    EXPECT_EQ(CheckedElement::live, 101);
+  }
+  EXPECT_EQ(CheckedElement::live, 0);
+}
+
+TEST(CPIXElementListTest, RemoveElements) {
+  {
+    CountingElementList element_list;
+    for (int i = 0; i < 200; i++) {
+      CountingElement* element;
+      if (i % 3 == 0) {
+        std::unique_ptr<CountingElement> adopted =
+            absl::make_unique<CountingElement>();
+        element = adopted.get();
+        element_list.AddElement(std::move(adopted));
+      } else {
+        element = element_list.EmplaceElement();
+      }
+      element->set_id(std::to_string(i));
+    }
+    EXPECT_EQ(CountingElement::live, 200);
+
+    // Remove the oldest half, as a rolling window would.
+    EXPECT_EQ(element_list.RemoveElements([](const CountingElement& element) {
+      return std::stoi(element.id()) < 100;
+    }),
+              100);
+    EXPECT_EQ(CountingElement::live, 100);
+    ASSERT_EQ(element_list.size(), 100);
+    EXPECT_EQ(element_list.elements_.front()->id(), "100");
+    EXPECT_EQ(element_list.elements_.back()->id(), "199");
+
+    element_list.EmplaceElement()->set_id("200");
+    EXPECT_EQ(element_list.elements_.back()->id(), "200");
+    EXPECT_EQ(CountingElement::live, 101);
+  }
+  EXPECT_EQ(CountingElement::live, 0);
+}
+
+TEST(CPIXElementListTest, ReusesFragments) {
+  CountingElementList element_list;
+  for (int i = 0; i < 4; i++) {
+    element_list.EmplaceElement()->set_id(std::to_string(i));
+  }
+  element_list.set_reuse_fragments(true);
+  element_list.RenderFragments();
+
+  CountingElement::renders = 0;
+  element_list.EmplaceElement()->set_id("4");
+  element_list.RemoveElements(
+      [](const CountingElement& element) { return element.id() == "0"; });
+  element_list.RenderFragments();
+  // Only the new element is rendered.
+  EXPECT_EQ(CountingElement::renders, 1);
+
+  std::string xml;
+  {
+    XMLArena arena;
+    ASSERT_TRUE(element_list.AppendXML(&xml));
+  }
+  EXPECT_EQ(CountingElement::renders, 1);
+  EXPECT_EQ(xml, element_list.Serialize());
+  EXPECT_EQ(xml,
+            "<L><E id=\"1\"/><E id=\"2\"/><E id=\"3\"/><E id=\"4\"/></L>");
+}
+
 }  // namespace
 }  // namespace cpix
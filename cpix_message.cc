@@ -14,21 +14,66 @@
 
 #include "cpix_message.h"
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "aes_cryptor.h"
 #include "cpix_util.h"
+#include "cpix_validator.h"
+#include "executor.h"
 #include "glog/logging.h"
 #include "rsa_private_key.h"
 #include "rsa_public_key.h"
+#include "xml_arena.h"
 #include "xml_node.h"
 #include "xml_util.h"
 
 namespace cpix {
+namespace {
+
+// Minimum numbers of recipients and content keys handed to one task when
+// sealing on an executor. Wrapping the document key for a recipient is an RSA
+// operation, so even a few of them are worth a task.
+constexpr size_t kRecipientGrain = 4;
+constexpr size_t kContentKeyGrain = 256;
+
+// Minimum number of periods handed to one task when generating a key rotation
+// schedule.
+constexpr size_t kKeyPeriodGrain = 64;
+
+struct Namespace {
+  const char* prefix;
+  const char* href;
+};
+
+// The namespaces declared on the root element, in order. The default one is
+// always declared.
+constexpr Namespace kNamespaces[] = {
+    {"xsi", "http://www.w3.org/2001/XMLSchema-instance"},
+    {"xsd", "http://www.w3.org/2001/XMLSchema"},
+    {"", "urn:dashif:org:cpix"},
+    {"ds", "http://www.w3.org/2000/09/xmldsig#"},
+    {"enc", "http://www.w3.org/2001/04/xmlenc#"},
+    {"pskc", "urn:ietf:params:xml:ns:keyprov:pskc"},
+};
+
+// Returns true if an element or attribute name in |xml| uses |prefix|.
+bool UsesPrefix(const std::string& xml, const std::string& prefix) {
+  return xml.find("<" + prefix + ":") != std::string::npos ||
+         xml.find(" " + prefix + ":") != std::string::npos;
+}
+
+}  // namespace
+
 CPIXMessage::CPIXMessage() {
   recipients_ = absl::make_unique<RecipientList>();
   content_keys_ = absl::make_unique<ContentKeyList>();
@@ -39,7 +84,91 @@ CPIXMessage::CPIXMessage() {
 
 CPIXMessage::~CPIXMessage() = default;
 
+void CPIXMessage::set_reuse_fragments(bool reuse) {
+  reuse_fragments_ = reuse;
+  recipients_->set_reuse_fragments(reuse);
+  content_keys_->set_reuse_fragments(reuse);
+  drm_systems_->set_reuse_fragments(reuse);
+  usage_rules_->set_reuse_fragments(reuse);
+  key_periods_->set_reuse_fragments(reuse);
+}
+
+size_t CPIXMessage::EvictKeyPeriodsBefore(int64_t cutoff) {
+  return EvictKeyPeriods([cutoff](const KeyPeriod& period) {
+    return period.has_time_interval() && period.end_time() <= cutoff;
+  });
+}
+
+size_t CPIXMessage::EvictKeyPeriodsBeforeIndex(int index) {
+  return EvictKeyPeriods([index](const KeyPeriod& period) {
+    return period.index() != -1 && period.index() < index;
+  });
+}
+
+size_t CPIXMessage::EvictKeyPeriods(
+    const std::function<bool(const KeyPeriod&)>& expired) {
+  absl::flat_hash_set<std::string> expired_ids;
+  size_t removed = key_periods_->RemoveKeyPeriods(
+      [&expired, &expired_ids](const KeyPeriod& period) {
+        if (!expired(period)) {
+          return false;
+        }
+        expired_ids.insert(period.id());
+        return true;
+      });
+  if (removed == 0) {
+    return 0;
+  }
+
+  // Rules without key period filters apply to every period and stay.
+  absl::flat_hash_set<std::vector<uint8_t>> expired_kids;
+  usage_rules_->RemoveUsageRules([&expired_ids,
+                                  &expired_kids](const UsageRule& rule) {
+    const std::vector<std::string>& periods = rule.key_period_filter_ids();
+    if (periods.empty()) {
+      return false;
+    }
+    for (const std::string& period : periods) {
+      if (expired_ids.count(period) == 0) {
+        return false;
+      }
+    }
+    expired_kids.insert(rule.kid());
+    return true;
+  });
+  // The rules left may still name expired periods alongside live ones.
+  usage_rules_->RemoveKeyPeriodFilters(expired_ids);
+  if (expired_kids.empty()) {
+    return removed;
+  }
+  for (auto kid = expired_kids.begin(); kid != expired_kids.end();) {
+    if (usage_rules_->FindRulesByKid(*kid).empty()) {
+      ++kid;
+    } else {
+      expired_kids.erase(kid++);
+    }
+  }
+
+  content_keys_->RemoveElements([&expired_kids](const ContentKey& key) {
+    return expired_kids.count(key.kid()) > 0;
+  });
+  drm_systems_->RemoveElements([&expired_kids](const DRMSystem& drm) {
+    return expired_kids.count(drm.kid()) > 0;
+  });
+  return removed;
+}
+
+void CPIXMessage::set_executor(Executor* executor) {
+  executor_ = executor;
+  recipients_->set_executor(executor);
+  content_keys_->set_executor(executor);
+  drm_systems_->set_executor(executor);
+  usage_rules_->set_executor(executor);
+  key_periods_->set_executor(executor);
+}
+
 bool CPIXMessage::FromString(const std::string& xml) {
+  XMLArena arena;
   std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>(xml);
   return Deserialize(std::move(root));
 }
@@ -51,12 +180,14 @@ bool CPIXMessage::DecryptWith(const std::vector<uint8_t>& private_key) {
     LOG(ERROR) << "Invalid private key";
     return false;
   }
+  return DecryptWith(private_key_ptr.get());
+}
 
+bool CPIXMessage::DecryptWith(RSAPrivateKey* private_key) {
   bool match = false;
-  for (const auto& recipient : recipients_->elements_) {
-    Recipient* recipient_ptr = static_cast<Recipient*>(recipient.get());
-    if (recipient_ptr->CreateRSAPublicKey()->MatchesKey(
-            private_key_ptr->rsa_key())) {
+  for (Recipient* recipient_ptr : recipients_->elements_) {
+    std::shared_ptr<RSAPublicKey> public_key = recipient_ptr->GetRSAPublicKey();
+    if (public_key && public_key->MatchesKey(private_key->rsa_key())) {
       std::vector<uint8_t> document_key =
           recipient_ptr->DecryptDocumentKeyWith(private_key);
       if (document_key.empty()) {
@@ -73,6 +204,7 @@ bool CPIXMessage::DecryptWith(const std::vector<uint8_t>& private_key) {
                   "the document";
     return false;
   }
+  content_keys_->InvalidateFragments();
   if (!content_keys_->DecryptContentKeys(document_key_)) {
     LOG(ERROR) << "Failure to decrypt content keys";
     return false;
@@ -80,46 +212,167 @@ bool CPIXMessage::DecryptWith(const std::vector<uint8_t>& private_key) {
   return true;
 }
 
-std::unique_ptr<XMLNode> CPIXMessage::GetNode() {
-  std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>("", "CPIX");
-  root->AddAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
-  root->AddAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema");
-  root->AddAttribute("xmlns", "urn:dashif:org:cpix");
-  root->AddAttribute("xmlns:ds", "http://www.w3.org/2000/09/xmldsig#");
-  root->AddAttribute("xmlns:enc", "http://www.w3.org/2001/04/xmlenc#");
-  root->AddAttribute("xmlns:pskc", "urn:ietf:params:xml:ns:keyprov:pskc");
-  if (!content_id_.empty()) {
-    root->AddAttribute("contentId", content_id_);
+bool CPIXMessage::Seal() {
+  if (!IsSealed() && !SealKeys()) {
+    return false;
+  }
+  if (reuse_fragments_) {
+    recipients_->RenderFragments();
+    content_keys_->RenderFragments();
+    drm_systems_->RenderFragments();
+    key_periods_->RenderFragments();
+    usage_rules_->RenderFragments();
   }
+  return true;
+}
 
+bool CPIXMessage::SealKeys() {
   if (!recipients_->elements_.empty() && document_key_.empty()) {
+    for (const Recipient* recipient : recipients_->elements_) {
+      if (!recipient->encrypted_document_key().empty()) {
+        LOG(ERROR) << "Document key is unknown; call DecryptWith() first";
+        return false;
+      }
+    }
     document_key_ = GetRandomBytes(32);
   }
 
-  for (auto& element : recipients_->elements_) {
-    Recipient* recipient = static_cast<Recipient*>(element.get());
-    if (recipient->encrypted_document_key().empty()) {
-      recipient->SetDocumentKey(document_key_);
+  // Drop the kept fragments of whatever is about to be encrypted.
+  if (reuse_fragments_) {
+    for (const Recipient* recipient : recipients_->elements_) {
+      if (recipient->encrypted_document_key().empty()) {
+        recipients_->InvalidateFragment(recipient);
+      }
+    }
+    if (!document_key_.empty()) {
+      for (const ContentKey* key : content_keys_->elements_) {
+        if (!key->is_encrypted()) {
+          content_keys_->InvalidateFragment(key);
+        }
+      }
     }
   }
 
+  std::atomic<bool> ok(true);
+  std::vector<Recipient*>& recipients = recipients_->elements_;
+  ParallelFor(executor_, recipients.size(), kRecipientGrain,
+              [this, &recipients, &ok](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                  if (recipients[i]->encrypted_document_key().empty() &&
+                      !recipients[i]->SetDocumentKey(document_key_)) {
+                    ok.store(false);
+                  }
+                }
+              });
+  if (!ok.load()) {
+    LOG(ERROR) << "Document key encryption failed";
+    return false;
+  }
+
   if (!document_key_.empty()) {
-    for (auto& element : content_keys_->elements_) {
-      ContentKey* key = static_cast<ContentKey*>(element.get());
+    std::vector<ContentKey*>& keys = content_keys_->elements_;
+    ParallelFor(
+        executor_, keys.size(), kContentKeyGrain,
+        [this, &keys, &ok](size_t begin, size_t end) {
+          // One cryptor per range, so the key schedule is computed once.
+          std::unique_ptr<AESCryptor> aes = AESCryptor::Create(document_key_);
+          if (!aes) {
+            ok.store(false);
+            return;
+          }
+          const std::vector<uint8_t> zero_iv(16, 0);
+          for (size_t i = begin; i < end; i++) {
+            ContentKey* key = keys[i];
+            if (key->is_encrypted()) {
+              continue;
+            }
+            aes->SetIV(key->explicit_iv().empty() ? zero_iv
+                                                  : key->explicit_iv());
+            std::vector<uint8_t> encrypted_key =
+                aes->CBCEncrypt(key->key_value());
+            if (encrypted_key.empty()) {
+              ok.store(false);
+              return;
+            }
+            key->SetEncryptedKeyValue(encrypted_key);
+          }
+        });
+    if (!ok.load()) {
+      LOG(ERROR) << "Key encryption failed";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CPIXMessage::IsSealed() const {
+  for (const Recipient* recipient : recipients_->elements_) {
+    if (recipient->encrypted_document_key().empty()) {
+      return false;
+    }
+  }
+  if (!recipients_->elements_.empty() || !document_key_.empty()) {
+    for (const ContentKey* key : content_keys_->elements_) {
       if (!key->is_encrypted()) {
-        std::unique_ptr<AESCryptor> aes = AESCryptor::Create(document_key_);
-        if (!key->explicit_iv().empty()) {
-          aes->SetIV(key->explicit_iv());
-        }
-        std::vector<uint8_t> encrypted_key = aes->CBCEncrypt(key->key_value());
-        if (encrypted_key.empty()) {
-          LOG(ERROR) << "Key encryption failed";
-          return nullptr;
-        }
-        key->SetEncryptedKeyValue(encrypted_key);
+        return false;
       }
     }
   }
+  return true;
+}
+
+std::string CPIXMessage::ToSealedString() const {
+  if (!IsSealed()) {
+    LOG(ERROR) << "Message must be sealed before serialization";
+    return "";
+  }
+  return reuse_fragments_ ? SerializeFragments() : Serialize();
+}
+
+std::string CPIXMessage::SerializeFragments() const {
+  XMLArena arena;
+  std::string body;
+  recipients_->AppendXML(&body);
+  content_keys_->AppendXML(&body);
+  drm_systems_->AppendXML(&body);
+  key_periods_->AppendXML(&body);
+  usage_rules_->AppendXML(&body);
+
+  XMLNode root("", "CPIX");
+  if (!content_id_.empty()) {
+    root.AddAttribute("contentId", content_id_);
+  }
+  for (const Namespace& ns : kNamespaces) {
+    if (!compact_output_ || ns.prefix[0] == '\0' ||
+        UsesPrefix(body, ns.prefix)) {
+      root.DeclareNamespace(ns.prefix, ns.href);
+    }
+  }
+  std::string xml = root.AsString();
+  if (body.empty()) {
+    return xml;
+  }
+  // Splice the lists into the empty root element.
+  xml.resize(xml.size() - 2);
+  xml.push_back('>');
+  xml.append(body);
+  xml.append("</CPIX>");
+  return xml;
+}
+
+std::shared_ptr<const CPIXMessage> CPIXMessage::Parse(const std::string& xml) {
+  std::shared_ptr<CPIXMessage> message = std::make_shared<CPIXMessage>();
+  if (!message->FromString(xml)) {
+    return nullptr;
+  }
+  return message;
+}
+
+std::unique_ptr<XMLNode> CPIXMessage::GetNode() const {
+  std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>("", "CPIX");
+  if (!content_id_.empty()) {
+    root->AddAttribute("contentId", content_id_);
+  }
 
   root->AddChild(recipients_->GetNode());
 
@@ -131,6 +384,13 @@ std::unique_ptr<XMLNode> CPIXMessage::GetNode() {
 
   root->AddChild(usage_rules_->GetNode());
 
+  // Declared once the tree is complete so that every prefixed element shares
+  // the root's declaration. Compact output omits namespaces nothing uses.
+  for (const Namespace& ns : kNamespaces) {
+    root->DeclareNamespace(ns.prefix, ns.href,
+                           compact_output_ && ns.prefix[0] != '\0');
+  }
+
   return root;
 }
 
@@ -151,24 +411,121 @@ bool CPIXMessage::Deserialize(std::unique_ptr<XMLNode> node) {
     set_name(attribute);
   }
 
-  recipients_->Deserialize(node->GetFirstChildByName("DeliveryDataList"));
+  // The lists are detached from the document first, so they can be read
+  // concurrently.
+  std::unique_ptr<XMLNode> recipients =
+      node->GetFirstChildByName("DeliveryDataList");
+  std::unique_ptr<XMLNode> content_keys =
+      node->GetFirstChildByName("ContentKeyList");
+  std::unique_ptr<XMLNode> drm_systems =
+      node->GetFirstChildByName("DRMSystemList");
+  std::unique_ptr<XMLNode> key_periods =
+      node->GetFirstChildByName("ContentKeyPeriodList");
+  std::unique_ptr<XMLNode> usage_rules =
+      node->GetFirstChildByName("ContentKeyUsageRuleList");
+
+  const std::function<bool()> lists[] = {
+      [&]() { return recipients_->Deserialize(std::move(recipients)); },
+      [&]() { return content_keys_->Deserialize(std::move(content_keys)); },
+      [&]() { return drm_systems_->Deserialize(std::move(drm_systems)); },
+      [&]() { return key_periods_->Deserialize(std::move(key_periods)); },
+      [&]() { return usage_rules_->Deserialize(std::move(usage_rules)); },
+  };
+  constexpr size_t kListCount = sizeof(lists) / sizeof(lists[0]);
+  bool ok[kListCount];
+  ParallelFor(executor_, kListCount, 1,
+              [&lists, &ok](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                  ok[i] = lists[i]();
+                }
+              });
+
+  for (size_t i = 0; i < kListCount; i++) {
+    if (!ok[i]) {
+      LOG(ERROR) << "Malformed element in CPIX document";
+      return false;
+    }
+  }
+  return true;
+}
 
-  content_keys_->Deserialize(node->GetFirstChildByName("ContentKeyList"));
+template <typename ElementType>
+bool CPIXMessage::AllKidsKnown(
+    const std::vector<std::unique_ptr<ElementType>>& elements) const {
+  if (elements.empty()) {
+    return true;
+  }
+  if (elements.size() == 1) {
+    return content_keys_->FindContentKey(elements[0]->kid()) != nullptr;
+  }
+  absl::flat_hash_set<std::vector<uint8_t>> kids;
+  kids.reserve(content_keys_->elements_.size());
+  for (const ContentKey* key : content_keys_->elements_) {
+    kids.insert(key->kid());
+  }
+  for (const auto& element : elements) {
+    if (!kids.contains(element->kid())) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  drm_systems_->Deserialize(node->GetFirstChildByName("DRMSystemList"));
+std::shared_ptr<const KeyTable> CPIXMessage::ExportKeyTable() const {
+  return KeyTable::Create(std::vector<const ContentKey*>(
+      content_keys_->elements_.begin(), content_keys_->elements_.end()));
+}
 
-  key_periods_->Deserialize(node->GetFirstChildByName("ContentKeyPeriodList"));
+std::shared_ptr<const UsageRuleMatcher> CPIXMessage::CompileUsageRules()
+    const {
+  return UsageRuleMatcher::Create(std::vector<const UsageRule*>(
+      usage_rules_->elements_.begin(), usage_rules_->elements_.end()));
+}
 
-  usage_rules_->Deserialize(
-      node->GetFirstChildByName("ContentKeyUsageRuleList"));
+bool CPIXMessage::Validate(std::vector<std::string>* errors) const {
+  std::vector<const UsageRule*> rules(usage_rules_->elements_.begin(),
+                                      usage_rules_->elements_.end());
+  std::vector<std::string> found;
+  bool valid =
+      CheckReferences(std::vector<const ContentKey*>(
+                          content_keys_->elements_.begin(),
+                          content_keys_->elements_.end()),
+                      std::vector<const DRMSystem*>(
+                          drm_systems_->elements_.begin(),
+                          drm_systems_->elements_.end()),
+                      rules,
+                      std::vector<const KeyPeriod*>(
+                          key_periods_->elements_.begin(),
+                          key_periods_->elements_.end()),
+                      &found);
+  valid = CheckUsageRulesUnambiguous(rules, &found) && valid;
+  if (!valid) {
+    LOG(ERROR) << "CPIX document has " << found.size()
+               << " semantic errors, the first being: " << found.front();
+  }
+  if (errors) {
+    errors->insert(errors->end(), found.begin(), found.end());
+  }
+  return valid;
+}
 
-  return true;
+void CPIXMessage::Reserve(size_t content_keys, size_t drm_systems,
+                          size_t usage_rules, size_t key_periods) {
+  content_keys_->Reserve(content_keys);
+  drm_systems_->Reserve(drm_systems);
+  usage_rules_->Reserve(usage_rules);
+  key_periods_->Reserve(key_periods);
 }
 
 bool CPIXMessage::AddContentKey(std::unique_ptr<ContentKey> key) {
   return content_keys_->AddContentKey(std::move(key));
 }
 
+bool CPIXMessage::AddContentKeys(
+    std::vector<std::unique_ptr<ContentKey>> keys) {
+  return content_keys_->AddContentKeys(std::move(keys));
+}
+
 bool CPIXMessage::AddContentKey(
     std::unique_ptr<ContentKey> key,
     std::vector<std::unique_ptr<DRMSystem>> drm_systems,
@@ -180,17 +537,95 @@ bool CPIXMessage::AddContentKey(
 
   for (auto& drm_system : drm_systems) {
     drm_system->set_key_id(kid);
-    if (!drm_systems_->AddDRMSystem(std::move(drm_system))) {
-      return false;
-    }
+  }
+  if (!drm_systems_->AddDRMSystems(std::move(drm_systems))) {
+    return false;
   }
 
   for (auto& rule : rules) {
     rule->set_key_id(kid);
-    if (!usage_rules_->AddUsageRule(std::move(rule))) {
-      return false;
-    }
   }
+  return usage_rules_->AddUsageRules(std::move(rules));
+}
+
+bool CPIXMessage::GenerateKeyRotation(const KeyRotationOptions& options) {
+  const size_t periods = options.period_count;
+  const size_t tracks = options.tracks.size();
+  if (tracks == 0 || options.first_period_index < 0 ||
+      periods > static_cast<size_t>(std::numeric_limits<int>::max() -
+                                    options.first_period_index)) {
+    LOG(ERROR) << "Invalid key rotation tracks or period numbers.";
+    return false;
+  }
+  // Checks the schedule against the latest writable time without computing
+  // its end, which could overflow.
+  const int64_t duration = options.period_duration;
+  if (duration > 0 &&
+      (options.start_time < kMinDateTime || options.start_time > kMaxDateTime ||
+       periods > static_cast<uint64_t>(kMaxDateTime - options.start_time) /
+                     static_cast<uint64_t>(duration))) {
+    LOG(ERROR) << "Key rotation schedule does not fit in years 0001 to 9999.";
+    return false;
+  }
+
+  ContentKeyGenerationOptions key_options = options.keys;
+  key_options.count = periods * tracks;
+  key_options.first_index = static_cast<uint64_t>(options.first_period_index) *
+                            tracks;
+  std::vector<ContentKey*> keys;
+  keys.reserve(key_options.count);
+  if (!content_keys_->GenerateContentKeys(key_options, &keys)) {
+    return false;
+  }
+
+  const size_t first_period = key_periods_->size();
+  key_periods_->Reserve(first_period + periods);
+  for (size_t i = 0; i < periods; i++) {
+    key_periods_->EmplaceElement();
+  }
+  const size_t first_rule = usage_rules_->size();
+  usage_rules_->Reserve(first_rule + keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    usage_rules_->EmplaceElement();
+  }
+
+  ParallelFor(
+      executor_, periods, kKeyPeriodGrain, [&](size_t begin, size_t end) {
+        char start[kMaxDateTimeStringSize];
+        char finish[kMaxDateTimeStringSize];
+        for (size_t p = begin; p < end; p++) {
+          int number = options.first_period_index + p;
+          std::string id = absl::StrCat(options.period_id_prefix, number);
+          KeyPeriod* period = key_periods_->elements_[first_period + p];
+          period->set_id(id);
+          if (duration > 0) {
+            int64_t start_time = options.start_time + p * duration;
+            size_t start_size = EncodeDateTime(start_time, true, start);
+            size_t finish_size =
+                EncodeDateTime(start_time + duration, true, finish);
+            period->SetInterval(std::string(start, start_size),
+                                std::string(finish, finish_size));
+          } else {
+            period->SetIndex(number);
+          }
+
+          for (size_t t = 0; t < tracks; t++) {
+            const RotatedTrack& track = options.tracks[t];
+            UsageRule* rule =
+                usage_rules_->elements_[first_rule + p * tracks + t];
+            rule->set_key_id(keys[p * tracks + t]->key_id());
+            if (!track.intended_track_type.empty()) {
+              rule->SetTrackType(track.intended_track_type);
+            }
+            for (const std::string& label : track.labels) {
+              rule->AddLabelFilter(label);
+            }
+            rule->AddKeyPeriodFilter(id);
+          }
+        }
+      });
+  key_periods_->IndexPeriods(first_period);
+  usage_rules_->IndexRules(first_rule);
   return true;
 }
 
@@ -201,6 +636,13 @@ bool CPIXMessage::AddDRMSystem(std::unique_ptr<DRMSystem> drm) {
   return drm_systems_->AddDRMSystem(std::move(drm));
 }
 
+bool CPIXMessage::AddDRMSystems(std::vector<std::unique_ptr<DRMSystem>> drms) {
+  if (!AllKidsKnown(drms)) {
+    return false;
+  }
+  return drm_systems_->AddDRMSystems(std::move(drms));
+}
+
 bool CPIXMessage::AddUsageRule(std::unique_ptr<UsageRule> rule) {
   if (!content_keys_->FindContentKey(rule->kid())) {
     return false;
@@ -208,6 +650,14 @@ bool CPIXMessage::AddUsageRule(std::unique_ptr<UsageRule> rule) {
   return usage_rules_->AddUsageRule(std::move(rule));
 }
 
+bool CPIXMessage::AddUsageRules(
+    std::vector<std::unique_ptr<UsageRule>> rules) {
+  if (!AllKidsKnown(rules)) {
+    return false;
+  }
+  return usage_rules_->AddUsageRules(std::move(rules));
+}
+
 bool CPIXMessage::AddKeyPeriod(std::unique_ptr<KeyPeriod> key_period) {
   return key_periods_->AddKeyPeriod(std::move(key_period));
 }
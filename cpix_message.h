@@ -15,8 +15,10 @@
 #ifndef CPIX_CC_CPIX_MESSAGE_H_
 #define CPIX_CC_CPIX_MESSAGE_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,12 +28,16 @@
 #include "cpix_element.h"
 #include "drm_system.h"
 #include "drm_system_list.h"
+#include "executor.h"
 #include "key_period.h"
 #include "key_period_list.h"
+#include "key_table.h"
+#include "pssh.h"
 #include "recipient.h"
 #include "recipient_list.h"
 #include "usage_rule.h"
 #include "usage_rule_list.h"
+#include "usage_rule_matcher.h"
 
 // CPIXMessage acts as a container for an entire CPIX document. It contains all
 // other CPIX elements, and has useful functions for the user to add and modify
@@ -39,34 +45,171 @@
 
 namespace cpix {
 
+class RSAPrivateKey;
 class XMLNode;
 
+// A track that gets its own content key in every period of a key rotation
+// schedule.
+struct RotatedTrack {
+  // Set as the intendedTrackType of the track's usage rules, if not empty.
+  std::string intended_track_type;
+
+  // Label filters of the track's usage rules.
+  std::vector<std::string> labels;
+};
+
+// Describes a key rotation schedule for CPIXMessage::GenerateKeyRotation.
+struct KeyRotationOptions {
+  // Number of key periods to generate.
+  size_t period_count = 0;
+
+  // Number of the first period. Period i gets the id
+  // period_id_prefix + (first_period_index + i).
+  int first_period_index = 0;
+  std::string period_id_prefix = "keyPeriod_";
+
+  // When positive, period i is the interval of this many microseconds
+  // starting at start_time + i * period_duration, with times in microseconds
+  // since the Unix epoch. Otherwise periods are identified by their index.
+  int64_t start_time = 0;
+  int64_t period_duration = 0;
+
+  std::vector<RotatedTrack> tracks;
+
+  // Options for the generated keys. The count is set by the schedule, and the
+  // key of track t in period number n is key number n * tracks.size() + t, so
+  // name-based KIDs stay the same when a schedule is extended.
+  ContentKeyGenerationOptions keys;
+};
+
 class CPIXMessage : public CPIXElement {
  public:
   CPIXMessage();
   ~CPIXMessage();
 
   // Generate a CPIX document as an XML-formatted string based on the contents
-  // of this message.
-  std::string ToString() { return Serialize(); }
+  // of this message. Seals the message first.
+  std::string ToString() { return Seal() ? ToSealedString() : ""; }
+
+  // Prepares the message for serialization: generates a document key if there
+  // are recipients, encrypts it for each recipient that does not have it yet
+  // and encrypts every clear content key with it. Does nothing if the message
+  // is already sealed. Adding recipients or keys later requires sealing again.
+  // In rolling-window mode, also renders the elements added since the last
+  // call; see set_reuse_fragments().
+  bool Seal();
+
+  // Like ToString(), but does not modify the message, so any number of threads
+  // may serialize the same sealed message at once. Returns an empty string if
+  // the message has changed since it was last sealed.
+  std::string ToSealedString() const;
 
   // Deserialize the contents of an existing CPIX document into the CPIXMessage
-  // OO structure, allowing for modification/insertion/deletion.
+  // OO structure, allowing for modification/insertion/deletion. Returns false
+  // if the document or any of its elements is malformed.
   bool FromString(const std::string& xml);
 
+  // Parses |xml| into a new message that can no longer be modified, so it may
+  // be shared between threads. Returns nullptr if parsing fails. See
+  // CPIXMessageCache to share one parse of the same document.
+  static std::shared_ptr<const CPIXMessage> Parse(const std::string& xml);
+
   // Uses the provided private key to decrypt ContentKeys.
   bool DecryptWith(const std::vector<uint8_t>& private_key);
 
+  // Like above, with a key that is already parsed, so one key can decrypt many
+  // messages. The key may be shared by messages decrypting on other threads.
+  bool DecryptWith(RSAPrivateKey* private_key);
+
+  // Sets the executor that Seal(), FromString() and DecryptWith() spread work
+  // over, or null, the default, to do all work on the calling thread. Small
+  // messages are processed on the calling thread either way. The executor is
+  // not owned and must outlive its use by this message.
+  void set_executor(Executor* executor);
+
+  // When set, ToString() declares only the namespaces the document uses. The
+  // output never contains formatting whitespace.
+  void set_compact_output(bool compact) { compact_output_ = compact; }
+
+  // Rolling-window mode for live documents that are re-sent with periods
+  // added and expired ones removed. When set, Seal() keeps the serialized XML
+  // of every element, and serializing reuses it, so each update only renders
+  // what was added since. Elements must not be modified in place once the
+  // message is sealed, other than through the message.
+  void set_reuse_fragments(bool reuse);
+
+  // Removes every interval key period that ends at or before |cutoff|, in
+  // microseconds since the Unix epoch, together with the usage rules that
+  // only apply to removed periods, the content keys no remaining rule refers
+  // to and the DRM systems of those keys. Remaining rules lose their
+  // KeyPeriodFilters for removed periods. Returns the number of periods
+  // removed.
+  size_t EvictKeyPeriodsBefore(int64_t cutoff);
+
+  // Like above, for indexed key periods with an index below |index|.
+  size_t EvictKeyPeriodsBeforeIndex(int index);
+
   void set_content_id(const std::string& id) { content_id_ = id; }
   void set_name(const std::string& name) { name_ = name; }
   const std::string& content_id() const { return content_id_; }
   const std::string& name() const { return name_; }
 
+  // Reserves storage for the given total numbers of elements, to avoid
+  // repeated reallocation while building large documents.
+  void Reserve(size_t content_keys, size_t drm_systems = 0,
+               size_t usage_rules = 0, size_t key_periods = 0);
+
   bool AddContentKey(std::unique_ptr<ContentKey> key);
 
+  // Adds all of |keys|, or none of them if any key is invalid.
+  bool AddContentKeys(std::vector<std::unique_ptr<ContentKey>> keys);
+
   ContentKey* FindContentKeyById(const std::vector<uint8_t>& kid) {
     return content_keys_->FindContentKey(kid);
   }
+  const ContentKey* FindContentKeyById(const std::vector<uint8_t>& kid) const {
+    return content_keys_->FindContentKey(kid);
+  }
+
+  // Returns the key period containing |time|, in microseconds since the Unix
+  // epoch, or nullptr. See KeyPeriodList::FindPeriodAt().
+  const KeyPeriod* FindKeyPeriodAt(int64_t time) const {
+    return key_periods_->FindPeriodAt(time);
+  }
+  const KeyPeriod* FindKeyPeriodByIndex(int index) const {
+    return key_periods_->FindPeriodByIndex(index);
+  }
+
+  // Return the usage rules with a LabelFilter for |label|, the given track
+  // type or the given KID, in document order. See UsageRuleList.
+  const std::vector<const UsageRule*>& FindUsageRulesByLabel(
+      const std::string& label) const {
+    return usage_rules_->FindRulesByLabel(label);
+  }
+  const std::vector<const UsageRule*>& FindUsageRulesByTrackType(
+      UsageRule::TrackType type) const {
+    return usage_rules_->FindRulesByTrackType(type);
+  }
+  const std::vector<const UsageRule*>& FindUsageRulesByKid(
+      const std::vector<uint8_t>& kid) const {
+    return usage_rules_->FindRulesByKid(kid);
+  }
+
+  // Returns an immutable lookup table of the message's content keys for use on
+  // hot paths, or nullptr if any key is still encrypted or malformed. Call
+  // DecryptWith() first on messages read from encrypted documents.
+  std::shared_ptr<const KeyTable> ExportKeyTable() const;
+
+  // Returns a matcher compiled from the message's usage rules, for resolving
+  // the key of many tracks without walking the rules each time.
+  std::shared_ptr<const UsageRuleMatcher> CompileUsageRules() const;
+
+  // Checks the rules of the CPIX specification that the schema does not:
+  // unique KIDs and key period ids, references to existing content keys and
+  // key periods, and usage rules that never give a track two different keys.
+  // Appends a description of each problem to |errors|, if not null. Scales to
+  // documents with millions of elements; see cpix_validator.h.
+  bool Validate(std::vector<std::string>* errors = nullptr) const;
 
   // Add a new ContentKey to the message, and any associated DRMSystems and
   // UsageRules.
@@ -74,10 +217,38 @@ class CPIXMessage : public CPIXElement {
                      std::vector<std::unique_ptr<DRMSystem>> drm_systems,
                      std::vector<std::unique_ptr<UsageRule>> rules);
 
+  // Generates options.count new ContentKeys in one call. See
+  // ContentKeyList::GenerateContentKeys.
+  bool GenerateContentKeys(const ContentKeyGenerationOptions& options,
+                           std::vector<ContentKey*>* generated = nullptr) {
+    return content_keys_->GenerateContentKeys(options, generated);
+  }
+
+  // Appends a whole key rotation schedule: one KeyPeriod per period, and one
+  // ContentKey and one UsageRule, filtered on that period, per track per
+  // period. Storage for all of them is reserved up front and keys are
+  // generated in bulk. Returns false, adding nothing, if the options are
+  // invalid.
+  bool GenerateKeyRotation(const KeyRotationOptions& options);
+
   bool AddDRMSystem(std::unique_ptr<DRMSystem> drm);
 
+  // Adds all of |drms|, or none of them if any is invalid or refers to a KID
+  // that is not in the message.
+  bool AddDRMSystems(std::vector<std::unique_ptr<DRMSystem>> drms);
+
+  // Sets the PSSH of every DRM system to the box |builder| gives for it, over
+  // the executor. See DRMSystemList::BuildPsshBoxes().
+  bool BuildPsshBoxes(PsshBuilder* builder) {
+    return drm_systems_->BuildPsshBoxes(builder);
+  }
+
   bool AddUsageRule(std::unique_ptr<UsageRule> rule);
 
+  // Adds all of |rules|, or none of them if any refers to a KID that is not in
+  // the message.
+  bool AddUsageRules(std::vector<std::unique_ptr<UsageRule>> rules);
+
   bool AddKeyPeriod(std::unique_ptr<KeyPeriod> key_period);
 
   bool AddRecipient(std::unique_ptr<Recipient> recipient);
@@ -91,10 +262,32 @@ class CPIXMessage : public CPIXElement {
   friend class CPIXMessageTest;
 
   bool Deserialize(std::unique_ptr<XMLNode> node) override;
-  std::unique_ptr<XMLNode> GetNode() override;
+  std::unique_ptr<XMLNode> GetNode() const override;
+
+  // Returns true if Seal() would have nothing to do.
+  bool IsSealed() const;
+
+  // Does the work of Seal() other than keeping fragments.
+  bool SealKeys();
+
+  // Removes the key periods for which |expired| returns true, and everything
+  // only they use. See EvictKeyPeriodsBefore().
+  size_t EvictKeyPeriods(const std::function<bool(const KeyPeriod&)>& expired);
+
+  // Serializes the message from the lists' kept fragments.
+  std::string SerializeFragments() const;
+
+  // Returns true if every element of |elements| refers to a KID of a
+  // ContentKey in this message.
+  template <typename ElementType>
+  bool AllKidsKnown(
+      const std::vector<std::unique_ptr<ElementType>>& elements) const;
 
   std::string content_id_;
   std::string name_;
+  bool compact_output_ = false;
+  bool reuse_fragments_ = false;
+  Executor* executor_ = nullptr;
   std::vector<uint8_t> document_key_;
   std::unique_ptr<RecipientList> recipients_;
   std::unique_ptr<ContentKeyList> content_keys_;
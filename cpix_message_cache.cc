@@ -0,0 +1,100 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpix_message_cache.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cpix_message.h"
+#include "openssl/sha.h"
+
+namespace cpix {
+namespace {
+
+std::string DigestOf(const std::string& xml) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(xml.data()), xml.size(), digest);
+  return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+}  // namespace
+
+CPIXMessageCache::CPIXMessageCache(size_t capacity) : capacity_(capacity) {}
+
+CPIXMessageCache::~CPIXMessageCache() = default;
+
+std::shared_ptr<const CPIXMessage> CPIXMessageCache::FindLocked(
+    const std::string& digest) {
+  auto found = index_.find(digest);
+  if (found == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return found->second->second;
+}
+
+std::shared_ptr<const CPIXMessage> CPIXMessageCache::Parse(
+    const std::string& xml) {
+  std::string digest = DigestOf(xml);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<const CPIXMessage> cached = FindLocked(digest);
+    if (cached) {
+      hits_++;
+      return cached;
+    }
+    misses_++;
+  }
+
+  std::shared_ptr<const CPIXMessage> message = CPIXMessage::Parse(xml);
+  if (!message || capacity_ == 0) {
+    return message;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another thread may have parsed the same document meanwhile. Hand out its
+  // copy so that every caller shares one message.
+  std::shared_ptr<const CPIXMessage> cached = FindLocked(digest);
+  if (cached) {
+    return cached;
+  }
+  if (entries_.size() == capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(digest, message);
+  index_[digest] = entries_.begin();
+  return message;
+}
+
+size_t CPIXMessageCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t CPIXMessageCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+size_t CPIXMessageCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+}  // namespace cpix
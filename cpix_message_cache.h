@@ -0,0 +1,70 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_CPIX_MESSAGE_CACHE_H_
+#define CPIX_CC_CPIX_MESSAGE_CACHE_H_
+
+#include <stddef.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "cpix_message.h"
+
+namespace cpix {
+
+// CPIXMessageCache shares parsed CPIX documents between threads. Documents are
+// keyed by the SHA-256 digest of their raw bytes, so fetching the same document
+// twice parses it once and hands out the same immutable message. The cache
+// holds at most |capacity| messages and evicts the least recently used one
+// when full. Messages stay alive while callers hold them, even once evicted.
+class CPIXMessageCache {
+ public:
+  explicit CPIXMessageCache(size_t capacity);
+  ~CPIXMessageCache();
+
+  CPIXMessageCache(const CPIXMessageCache&) = delete;
+  CPIXMessageCache& operator=(const CPIXMessageCache&) = delete;
+
+  // Returns the cached message for |xml|, parsing and caching it first if it is
+  // not cached yet. Returns nullptr if parsing fails; failures are not cached.
+  // Safe to call from any thread. Parsing happens outside the cache's lock.
+  std::shared_ptr<const CPIXMessage> Parse(const std::string& xml);
+
+  size_t size() const;
+  size_t hits() const;
+  size_t misses() const;
+
+ private:
+  using Entry = std::pair<std::string, std::shared_ptr<const CPIXMessage>>;
+
+  // Returns the cached message for |digest| and marks it most recently used,
+  // or nullptr. |mutex_| must be held.
+  std::shared_ptr<const CPIXMessage> FindLocked(const std::string& digest);
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  absl::flat_hash_map<std::string, std::list<Entry>::iterator> index_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_CPIX_MESSAGE_CACHE_H_
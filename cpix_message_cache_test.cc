@@ -0,0 +1,138 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpix_message_cache.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "content_key.h"
+#include "cpix_message.h"
+#include "drm_system.h"
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+// Returns a document with one clear key whose KID and value are filled with
+// |seed|.
+std::string MakeDocument(uint8_t seed) {
+  CPIXMessage message;
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->set_key_id(std::vector<uint8_t>(16, seed));
+  key->SetKeyValue(std::vector<uint8_t>(16, seed));
+  message.AddContentKey(std::move(key));
+  return message.ToString();
+}
+
+TEST(CPIXMessageCacheTest, DoesNotCacheFailures) {
+  CPIXMessage message;
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->set_key_id(std::vector<uint8_t>(16, 1));
+  key->SetKeyValue(std::vector<uint8_t>(16, 1));
+  message.AddContentKey(std::move(key));
+  std::unique_ptr<DRMSystem> drm = absl::make_unique<DRMSystem>();
+  drm->set_key_id(std::vector<uint8_t>(16, 1));
+  drm->set_system_id(std::vector<uint8_t>(16, 2));
+  ASSERT_TRUE(message.AddDRMSystem(std::move(drm)));
+  std::string xml = message.ToString();
+  // Corrupts the KID of the DRM system.
+  size_t kid = xml.find("kid=\"", xml.find("<DRMSystem "));
+  ASSERT_NE(kid, std::string::npos);
+  xml.replace(kid + 5, 4, "zzzz");
+
+  CPIXMessageCache cache(4);
+  EXPECT_EQ(cache.Parse(xml), nullptr);
+  EXPECT_EQ(cache.Parse(xml), nullptr);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.hits(), 0);
+}
+
+TEST(CPIXMessageCacheTest, ParsesIdenticalDocumentsOnce) {
+  CPIXMessageCache cache(4);
+  std::string xml = MakeDocument(1);
+  std::shared_ptr<const CPIXMessage> first = cache.Parse(xml);
+  ASSERT_TRUE(first);
+  std::shared_ptr<const CPIXMessage> second = cache.Parse(std::string(xml));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 1);
+
+  const ContentKey* key =
+      first->FindContentKeyById(std::vector<uint8_t>(16, 1));
+  ASSERT_NE(key, nullptr);
+  EXPECT_EQ(key->key_value(), std::vector<uint8_t>(16, 1));
+  EXPECT_EQ(first->ToSealedString(), xml);
+
+  std::shared_ptr<const CPIXMessage> other = cache.Parse(MakeDocument(2));
+  ASSERT_TRUE(other);
+  EXPECT_NE(other, first);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(CPIXMessageCacheTest, EvictsLeastRecentlyUsed) {
+  CPIXMessageCache cache(2);
+  std::string a = MakeDocument(1);
+  std::string b = MakeDocument(2);
+  std::string c = MakeDocument(3);
+  std::shared_ptr<const CPIXMessage> parsed_a = cache.Parse(a);
+  std::shared_ptr<const CPIXMessage> parsed_b = cache.Parse(b);
+  // Touching |a| makes |b| the eviction candidate.
+  EXPECT_EQ(cache.Parse(a), parsed_a);
+  cache.Parse(c);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.Parse(a), parsed_a);
+  // |b| was evicted but stays valid for its holder; parsing it again creates
+  // a new message.
+  EXPECT_NE(cache.Parse(b), parsed_b);
+  EXPECT_TRUE(parsed_b->FindContentKeyById(std::vector<uint8_t>(16, 2)));
+}
+
+TEST(CPIXMessageCacheTest, ZeroCapacityDisablesCaching) {
+  CPIXMessageCache cache(0);
+  std::string xml = MakeDocument(1);
+  std::shared_ptr<const CPIXMessage> first = cache.Parse(xml);
+  ASSERT_TRUE(first);
+  EXPECT_NE(cache.Parse(xml), first);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(CPIXMessageCacheTest, ThreadsShareOneMessage) {
+  CPIXMessageCache cache(4);
+  std::string xml = MakeDocument(7);
+  std::vector<std::shared_ptr<const CPIXMessage>> results(8);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&cache, &xml, &result]() {
+      result = cache.Parse(xml);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  // Threads that missed at the same time may each have parsed the document,
+  // but they all return the copy that was cached first.
+  std::shared_ptr<const CPIXMessage> cached = cache.Parse(xml);
+  ASSERT_TRUE(cached);
+  for (const auto& result : results) {
+    EXPECT_EQ(result, cached);
+  }
+  EXPECT_EQ(cache.size(), 1);
+}
+
+}  // namespace
+}  // namespace cpix
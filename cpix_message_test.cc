@@ -14,12 +14,18 @@
 
 #include "cpix_message.h"
 
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "content_key.h"
 #include "cpix_util.h"
+#include "executor.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "recipient.h"
@@ -29,31 +35,33 @@
 namespace cpix {
 namespace {
 
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
 using ::testing::Test;
 
 class MockRecipientList : public RecipientList {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 class MockContentKeyList : public ContentKeyList {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 class MockDRMSystemList : public DRMSystemList {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 class MockUsageRuleList : public UsageRuleList {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 class MockKeyPeriodList : public KeyPeriodList {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 constexpr char kCpixDocument[] =
@@ -217,6 +225,13 @@ constexpr char kGoodCertificate[] =
     "XG6H65F0AuJUd5SNIGJGu0s=\n"
     "-----END CERTIFICATE-----\n";
 
+constexpr char kCompactCpix[] =
+    "<CPIX xmlns=\"urn:dashif:org:cpix\" "
+    "xmlns:pskc=\"urn:ietf:params:xml:ns:keyprov:pskc\"><ContentKeyList>"
+    "<ContentKey kid=\"bd5adf51-cf04-410f-aac3-ec63a69e929e\"><Data>"
+    "<pskc:Secret><pskc:PlainValue>3iv9lYwafpe0uEmxDc6PSw==</pskc:PlainValue>"
+    "</pskc:Secret></Data></ContentKey></ContentKeyList></CPIX>";
+
 constexpr char kGoodDashedKID[] = "bd5adf51-cf04-410f-aac3-ec63a69e929e";
 
 constexpr char kGoodKeyValue[] = "3iv9lYwafpe0uEmxDc6PSw==";
@@ -276,6 +291,80 @@ TEST_F(CPIXMessageTest, FullDeserialize) {
   EXPECT_EQ(message.ToString(), kFullCpix);
 }
 
+TEST_F(CPIXMessageTest, SerializeCompact) {
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  message.AddContentKey(std::move(key));
+  message.set_compact_output(true);
+  std::string xml = message.ToString();
+  EXPECT_TRUE(CPIXMessage::ValidateXML(xml, GetCpixSchema()));
+  EXPECT_EQ(xml, kCompactCpix);
+}
+
+TEST_F(CPIXMessageTest, BulkAdd) {
+  constexpr char kSystemId[] = "edef8ba9-79d6-4ace-a3c8-27dcd51d21ed";
+  message.Reserve(2, 2, 2);
+  std::vector<std::unique_ptr<ContentKey>> keys;
+  for (const char* kid : {kGoodDashedKID, kSystemId}) {
+    keys.push_back(absl::make_unique<ContentKey>());
+    keys.back()->set_key_id(GUIDStringToBytes(kid));
+    keys.back()->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  }
+  ASSERT_TRUE(message.AddContentKeys(std::move(keys)));
+
+  std::vector<std::unique_ptr<DRMSystem>> drms;
+  for (const char* kid : {kGoodDashedKID, kSystemId}) {
+    drms.push_back(absl::make_unique<DRMSystem>());
+    drms.back()->set_key_id(GUIDStringToBytes(kid));
+    drms.back()->set_system_id(GUIDStringToBytes(kSystemId));
+  }
+  drms.back()->set_key_id(std::vector<uint8_t>(16));
+  EXPECT_FALSE(message.AddDRMSystems(std::move(drms)));
+
+  drms.clear();
+  for (const char* kid : {kGoodDashedKID, kSystemId}) {
+    drms.push_back(absl::make_unique<DRMSystem>());
+    drms.back()->set_key_id(GUIDStringToBytes(kid));
+    drms.back()->set_system_id(GUIDStringToBytes(kSystemId));
+  }
+  EXPECT_TRUE(message.AddDRMSystems(std::move(drms)));
+
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  rules.push_back(absl::make_unique<UsageRule>());
+  rules.back()->set_key_id(GUIDStringToBytes(kSystemId));
+  EXPECT_TRUE(message.AddUsageRules(std::move(rules)));
+
+  std::string xml = message.ToString();
+  EXPECT_TRUE(CPIXMessage::ValidateXML(xml, GetCpixSchema()));
+  size_t drm_count = 0;
+  for (size_t pos = xml.find("<DRMSystem "); pos != std::string::npos;
+       pos = xml.find("<DRMSystem ", pos + 1)) {
+    drm_count++;
+  }
+  EXPECT_EQ(drm_count, 2);
+}
+
+TEST_F(CPIXMessageTest, ParseRejectsMalformedElements) {
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  message.AddContentKey(std::move(key));
+  std::unique_ptr<DRMSystem> drm = absl::make_unique<DRMSystem>();
+  drm->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  drm->set_system_id(GUIDStringToBytes(kGoodDashedKID));
+  ASSERT_TRUE(message.AddDRMSystem(std::move(drm)));
+  std::string xml = message.ToString();
+  ASSERT_TRUE(CPIXMessage::Parse(xml));
+
+  size_t kid = xml.find("kid=\"", xml.find("<DRMSystem "));
+  ASSERT_NE(kid, std::string::npos);
+  xml.replace(kid + 5, 4, "zzzz");
+  EXPECT_EQ(CPIXMessage::Parse(xml), nullptr);
+  CPIXMessage parsed;
+  EXPECT_FALSE(parsed.FromString(xml));
+}
+
 TEST_F(CPIXMessageTest, Decrypt) {
   std::unique_ptr<Recipient> recipient = absl::make_unique<Recipient>();
   recipient->set_delivery_key(
@@ -299,4 +388,386 @@ TEST_F(CPIXMessageTest, Decrypt) {
             Base64StringToBytes(kGoodKeyValue));
 }
 
+TEST_F(CPIXMessageTest, ExportKeyTable) {
+  std::unique_ptr<Recipient> recipient = absl::make_unique<Recipient>();
+  recipient->set_delivery_key(
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodCertificate)));
+  message.AddRecipient(std::move(recipient));
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  message.AddContentKey(std::move(key));
+
+  CPIXMessage parsed;
+  ASSERT_TRUE(parsed.FromString(message.ToString()));
+  EXPECT_FALSE(parsed.ExportKeyTable());
+  ASSERT_TRUE(parsed.DecryptWith(
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodPrivateKey))));
+
+  std::shared_ptr<const KeyTable> table = parsed.ExportKeyTable();
+  ASSERT_TRUE(table);
+  size_t index = table->Find(GUIDStringToBytes(kGoodDashedKID));
+  ASSERT_NE(index, KeyTable::kNotFound);
+  EXPECT_EQ(std::vector<uint8_t>(table->key(index),
+                                 table->key(index) + table->key_size(index)),
+            Base64StringToBytes(kGoodKeyValue));
+}
+
+TEST_F(CPIXMessageTest, GenerateKeyRotation) {
+  KeyRotationOptions options;
+  options.period_count = 3;
+  options.first_period_index = 10;
+  // 2019-01-01T00:00:00Z, in 10 second periods.
+  options.start_time = int64_t{1546300800} * 1000000;
+  options.period_duration = 10 * 1000000;
+  options.tracks.resize(2);
+  options.tracks[0].labels = {"video"};
+  options.tracks[1].labels = {"audio"};
+  options.tracks[1].intended_track_type = "AUDIO";
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+
+  // Not checked against the schema, which declares KeyPeriodFilter@periodId
+  // as an xs:ID, so a period cannot be both defined and referenced.
+  CPIXMessage parsed;
+  ASSERT_TRUE(parsed.FromString(message.ToString()));
+
+  const KeyPeriod* period =
+      parsed.FindKeyPeriodAt(options.start_time + 15 * 1000000);
+  ASSERT_NE(period, nullptr);
+  EXPECT_EQ(period->id(), "keyPeriod_11");
+  EXPECT_EQ(period->start(), "2019-01-01T00:00:10Z");
+  EXPECT_EQ(period->end(), "2019-01-01T00:00:20Z");
+  EXPECT_EQ(parsed.FindKeyPeriodAt(options.start_time + 30 * 1000000),
+            nullptr);
+
+  EXPECT_EQ(message.FindUsageRulesByLabel("audio").size(), 3);
+  EXPECT_EQ(parsed.FindUsageRulesByLabel("audio").size(), 3);
+  EXPECT_EQ(
+      parsed.FindUsageRulesByTrackType(UsageRule::TrackType::kAudio).size(),
+      3);
+
+  std::shared_ptr<const UsageRuleMatcher> matcher = parsed.CompileUsageRules();
+  ASSERT_EQ(matcher->size(), 6);
+  TrackProperties track;
+  track.labels = {"audio"};
+  const std::vector<uint8_t>* kid = matcher->Resolve(track, "keyPeriod_11");
+  ASSERT_NE(kid, nullptr);
+  EXPECT_NE(parsed.FindContentKeyById(*kid), nullptr);
+  track.labels = {"video"};
+  const std::vector<uint8_t>* other_kid =
+      matcher->Resolve(track, "keyPeriod_11");
+  ASSERT_NE(other_kid, nullptr);
+  EXPECT_NE(*kid, *other_kid);
+}
+
+TEST_F(CPIXMessageTest, ExtendingKeyRotationKeepsKids) {
+  KeyRotationOptions options;
+  options.tracks.resize(2);
+  options.tracks[0].labels = {"t0"};
+  options.tracks[1].labels = {"t1"};
+  options.keys.kid_namespace = GUIDStringToBytes(kGoodDashedKID);
+
+  options.period_count = 4;
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+
+  CPIXMessage extended;
+  options.period_count = 2;
+  ASSERT_TRUE(extended.GenerateKeyRotation(options));
+  options.first_period_index = 2;
+  ASSERT_TRUE(extended.GenerateKeyRotation(options));
+  ASSERT_NE(extended.FindKeyPeriodByIndex(3), nullptr);
+
+  std::shared_ptr<const UsageRuleMatcher> matcher = message.CompileUsageRules();
+  std::shared_ptr<const UsageRuleMatcher> extended_matcher =
+      extended.CompileUsageRules();
+  for (int period = 0; period < 4; period++) {
+    for (const std::string label : {"t0", "t1"}) {
+      TrackProperties track;
+      track.labels = {label};
+      std::string id = "keyPeriod_" + std::to_string(period);
+      const std::vector<uint8_t>* kid = matcher->Resolve(track, id);
+      const std::vector<uint8_t>* extended_kid =
+          extended_matcher->Resolve(track, id);
+      ASSERT_NE(kid, nullptr);
+      ASSERT_NE(extended_kid, nullptr);
+      EXPECT_EQ(*kid, *extended_kid);
+    }
+  }
+}
+
+TEST_F(CPIXMessageTest, GenerateKeyRotationRejectsInvalidOptions) {
+  KeyRotationOptions options;
+  options.period_count = 2;
+  EXPECT_FALSE(message.GenerateKeyRotation(options));
+
+  options.tracks.resize(1);
+  options.period_duration = 1000000;
+  options.start_time = std::numeric_limits<int64_t>::max() - 1;
+  EXPECT_FALSE(message.GenerateKeyRotation(options));
+
+  // The end of the schedule would overflow.
+  options.start_time = int64_t{1546300800} * 1000000;
+  options.period_duration = std::numeric_limits<int64_t>::max() / 2;
+  EXPECT_FALSE(message.GenerateKeyRotation(options));
+  options.period_duration = kMaxDateTime - options.start_time;
+  options.period_count = 1;
+  options.period_id_prefix = "last";
+  EXPECT_TRUE(message.GenerateKeyRotation(options));
+  options.period_count = 2;
+  EXPECT_FALSE(message.GenerateKeyRotation(options));
+  EXPECT_EQ(message.FindKeyPeriodByIndex(0), nullptr);
+}
+
+TEST_F(CPIXMessageTest, RollingWindow) {
+  std::unique_ptr<Recipient> recipient = absl::make_unique<Recipient>();
+  recipient->set_delivery_key(
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodCertificate)));
+  message.AddRecipient(std::move(recipient));
+  // A key used in every period, which survives eviction.
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  rules.push_back(absl::make_unique<UsageRule>());
+  rules.back()->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  rules.back()->AddLabelFilter("static");
+  message.AddContentKey(std::move(key), {}, std::move(rules));
+
+  KeyRotationOptions options;
+  options.period_count = 4;
+  options.start_time = int64_t{1546300800} * 1000000;
+  options.period_duration = 10 * 1000000;
+  options.tracks.resize(1);
+  options.tracks[0].labels = {"video"};
+  message.set_reuse_fragments(true);
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+
+  // Serializing from fragments gives the same document as a full render.
+  auto expect_same_as_full_render = [this]() {
+    for (bool compact : {false, true}) {
+      message.set_compact_output(compact);
+      std::string reused = message.ToString();
+      ASSERT_FALSE(reused.empty());
+      message.set_reuse_fragments(false);
+      EXPECT_EQ(message.ToString(), reused);
+      message.set_reuse_fragments(true);
+    }
+  };
+  expect_same_as_full_render();
+
+  TrackProperties video;
+  video.labels = {"video"};
+  const std::vector<uint8_t> first_kid =
+      *message.CompileUsageRules()->Resolve(video, "keyPeriod_0");
+
+  // Drop the first two periods and add two more.
+  EXPECT_EQ(message.EvictKeyPeriodsBefore(options.start_time +
+                                          20 * 1000000),
+            2);
+  options.first_period_index = 4;
+  options.period_count = 2;
+  options.start_time += 40 * 1000000;
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+  expect_same_as_full_render();
+
+  EXPECT_EQ(message.FindKeyPeriodAt(options.start_time - 35 * 1000000),
+            nullptr);
+  ASSERT_NE(message.FindKeyPeriodAt(options.start_time + 15 * 1000000),
+            nullptr);
+  EXPECT_EQ(message.FindContentKeyById(first_kid), nullptr);
+  EXPECT_NE(message.FindContentKeyById(GUIDStringToBytes(kGoodDashedKID)),
+            nullptr);
+
+  std::shared_ptr<const UsageRuleMatcher> matcher = message.CompileUsageRules();
+  EXPECT_EQ(matcher->size(), 5);
+  EXPECT_EQ(matcher->Resolve(video, "keyPeriod_0"), nullptr);
+  EXPECT_NE(matcher->Resolve(video, "keyPeriod_5"), nullptr);
+
+  EXPECT_EQ(message.EvictKeyPeriodsBefore(options.start_time +
+                                          15 * 1000000),
+            3);
+  EXPECT_EQ(message.CompileUsageRules()->size(), 2);
+  expect_same_as_full_render();
+
+  CPIXMessage parsed;
+  ASSERT_TRUE(parsed.FromString(message.ToString()));
+  ASSERT_TRUE(parsed.DecryptWith(
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodPrivateKey))));
+  EXPECT_EQ(parsed.FindContentKeyById(GUIDStringToBytes(kGoodDashedKID))
+                ->key_value(),
+            Base64StringToBytes(kGoodKeyValue));
+}
+
+TEST_F(CPIXMessageTest, EvictIndexedKeyPeriods) {
+  KeyRotationOptions options;
+  options.period_count = 4;
+  options.tracks.resize(1);
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+  message.set_reuse_fragments(true);
+  ASSERT_TRUE(message.Seal());
+
+  EXPECT_EQ(message.EvictKeyPeriodsBeforeIndex(3), 3);
+  EXPECT_EQ(message.FindKeyPeriodByIndex(2), nullptr);
+  ASSERT_NE(message.FindKeyPeriodByIndex(3), nullptr);
+  EXPECT_EQ(message.CompileUsageRules()->size(), 1);
+  std::string reused = message.ToString();
+  message.set_reuse_fragments(false);
+  EXPECT_EQ(message.ToString(), reused);
+}
+
+TEST_F(CPIXMessageTest, EvictionStripsExpiredPeriodsFromRules) {
+  KeyRotationOptions options;
+  options.period_count = 3;
+  options.start_time = int64_t{1546300800} * 1000000;
+  options.period_duration = 10 * 1000000;
+  options.tracks.resize(1);
+  options.tracks[0].labels = {"rotated"};
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+
+  // A key shared by every period, through one rule naming all of them.
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  rules.push_back(absl::make_unique<UsageRule>());
+  rules.back()->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  rules.back()->AddLabelFilter("shared");
+  for (int i = 0; i < 3; i++) {
+    rules.back()->AddKeyPeriodFilter("keyPeriod_" + std::to_string(i));
+  }
+  message.AddContentKey(std::move(key), {}, std::move(rules));
+  message.set_reuse_fragments(true);
+  ASSERT_TRUE(message.Seal());
+  ASSERT_TRUE(message.Validate());
+
+  EXPECT_EQ(message.EvictKeyPeriodsBefore(options.start_time + 20 * 1000000),
+            2);
+  std::vector<std::string> errors;
+  EXPECT_TRUE(message.Validate(&errors));
+  EXPECT_TRUE(errors.empty());
+
+  TrackProperties shared;
+  shared.labels = {"shared"};
+  std::shared_ptr<const UsageRuleMatcher> matcher = message.CompileUsageRules();
+  EXPECT_EQ(matcher->size(), 2);
+  ASSERT_NE(matcher->Resolve(shared, "keyPeriod_2"), nullptr);
+  EXPECT_EQ(*matcher->Resolve(shared, "keyPeriod_2"),
+            GUIDStringToBytes(kGoodDashedKID));
+
+  // The rule's kept fragment no longer names the removed periods.
+  std::string reused = message.ToString();
+  EXPECT_EQ(reused.find("keyPeriod_0"), std::string::npos);
+  message.set_reuse_fragments(false);
+  EXPECT_EQ(message.ToString(), reused);
+}
+
+TEST_F(CPIXMessageTest, Validate) {
+  KeyRotationOptions options;
+  options.period_count = 3;
+  options.tracks.resize(2);
+  options.tracks[0].labels = {"video"};
+  options.tracks[1].labels = {"audio"};
+  ASSERT_TRUE(message.GenerateKeyRotation(options));
+  EXPECT_TRUE(message.Validate());
+
+  // Gives the audio of one period a second key.
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  rules.push_back(absl::make_unique<UsageRule>());
+  rules.back()->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  rules.back()->AddLabelFilter("audio");
+  rules.back()->AddKeyPeriodFilter("keyPeriod_1");
+  rules.back()->AddKeyPeriodFilter("keyPeriod_7");
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  ASSERT_TRUE(message.AddContentKey(std::move(key), {}, std::move(rules)));
+
+  std::vector<std::string> errors;
+  EXPECT_FALSE(message.Validate(&errors));
+  EXPECT_THAT(errors,
+              ElementsAre(HasSubstr("unknown key period keyPeriod_7"),
+                          HasSubstr("Usage rules 3 and 6")));
+
+  CPIXMessage parsed;
+  ASSERT_TRUE(parsed.FromString(message.ToString()));
+  errors.clear();
+  EXPECT_FALSE(parsed.Validate(&errors));
+  EXPECT_EQ(errors.size(), 2);
+}
+
+TEST_F(CPIXMessageTest, SealedMessageSerializesConcurrently) {
+  std::unique_ptr<Recipient> recipient = absl::make_unique<Recipient>();
+  recipient->set_delivery_key(
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodCertificate)));
+  message.AddRecipient(std::move(recipient));
+  std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+  key->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  key->set_key_id(GUIDStringToBytes(kGoodDashedKID));
+  message.AddContentKey(std::move(key));
+
+  EXPECT_EQ(message.ToSealedString(), "");
+  ASSERT_TRUE(message.Seal());
+  const CPIXMessage& sealed = message;
+  std::string expected = sealed.ToSealedString();
+  ASSERT_FALSE(expected.empty());
+  EXPECT_EQ(message.ToString(), expected);
+
+  std::vector<std::string> results(4);
+  std::vector<std::thread> threads;
+  for (std::string& result : results) {
+    threads.emplace_back(
+        [&sealed, &result]() { result = sealed.ToSealedString(); });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const std::string& result : results) {
+    EXPECT_EQ(result, expected);
+  }
+
+  // Adding a clear key unseals the message.
+  std::unique_ptr<ContentKey> second = absl::make_unique<ContentKey>();
+  second->SetKeyValue(Base64StringToBytes(kGoodKeyValue));
+  second->set_key_id(std::vector<uint8_t>(16, 0x42));
+  message.AddContentKey(std::move(second));
+  EXPECT_EQ(message.ToSealedString(), "");
+  ASSERT_TRUE(message.Seal());
+  EXPECT_NE(message.ToSealedString(), "");
+}
+
+TEST_F(CPIXMessageTest, ExecutorMatchesSerialProcessing) {
+  std::unique_ptr<Recipient> recipient = absl::make_unique<Recipient>();
+  recipient->set_delivery_key(
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodCertificate)));
+  message.AddRecipient(std::move(recipient));
+  ContentKeyGenerationOptions options;
+  options.count = 1000;
+  ASSERT_TRUE(message.GenerateContentKeys(options));
+
+  WorkStealingPool pool(4);
+  message.set_executor(&pool);
+  std::string xml = message.ToString();
+  ASSERT_FALSE(xml.empty());
+
+  CPIXMessage serial;
+  ASSERT_TRUE(serial.FromString(xml));
+  CPIXMessage parallel;
+  parallel.set_executor(&pool);
+  ASSERT_TRUE(parallel.FromString(xml));
+  EXPECT_EQ(parallel.ToString(), serial.ToString());
+
+  std::vector<uint8_t> private_key =
+      Base64StringToBytes(StripPEMHeadersAndNewlines(kGoodPrivateKey));
+  ASSERT_TRUE(serial.DecryptWith(private_key));
+  ASSERT_TRUE(parallel.DecryptWith(private_key));
+  std::shared_ptr<const KeyTable> serial_keys = serial.ExportKeyTable();
+  std::shared_ptr<const KeyTable> parallel_keys = parallel.ExportKeyTable();
+  ASSERT_TRUE(serial_keys);
+  ASSERT_TRUE(parallel_keys);
+  ASSERT_EQ(parallel_keys->size(), 1000);
+  for (size_t i = 0; i < parallel_keys->size(); i++) {
+    ASSERT_EQ(memcmp(parallel_keys->key(i), serial_keys->key(i), 16), 0);
+  }
+}
+
 }  // namespace cpix
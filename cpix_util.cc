@@ -14,63 +14,505 @@
 
 #include "cpix_util.h"
 
+#include <pthread.h>
 #include <stddef.h>
 
 #include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <vector>
 
-#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
-#include "absl/strings/string_view.h"
+#include "base64.h"
+#include "glog/logging.h"
 #include "openssl/rand.h"
+#include "openssl/sha.h"
 
 namespace cpix {
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+constexpr uint8_t kNotHex = 0xff;
+
+// Offsets of the first hex digit of each GUID byte in the dashed form.
+constexpr size_t kGUIDDigitOffsets[kGUIDSize] = {
+    0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34};
+constexpr size_t kGUIDDashOffsets[] = {8, 13, 18, 23};
+
+struct HexTable {
+  uint8_t values[256];
+
+  HexTable() {
+    for (int i = 0; i < 256; i++) {
+      values[i] = kNotHex;
+    }
+    for (int i = 0; i < 10; i++) {
+      values['0' + i] = i;
+    }
+    for (int i = 0; i < 6; i++) {
+      values['a' + i] = 10 + i;
+      values['A' + i] = 10 + i;
+    }
+  }
+};
+
+const uint8_t* GetHexTable() {
+  static const HexTable* table = new HexTable();
+  return table->values;
+}
+
+constexpr int64_t kMicrosPerSecond = 1000000;
+constexpr int64_t kSecondsPerDay = 86400;
+
+// Days between 0000-03-01 and 1970-01-01 in the proleptic Gregorian calendar.
+constexpr int64_t kEpochDayOffset = 719468;
+constexpr int64_t kDaysPerEra = 146097;
+
+bool IsLeapYear(int year) {
+  return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+int DaysInMonth(int year, int month) {
+  static constexpr int kDays[] = {31, 28, 31, 30, 31, 30,
+                                  31, 31, 30, 31, 30, 31};
+  return month == 2 && IsLeapYear(year) ? 29 : kDays[month - 1];
+}
+
+// Returns the number of days from 1970-01-01 to the given date. Years are
+// counted from March so that the leap day falls at the end of the year.
+int64_t DaysFromCivil(int year, int month, int day) {
+  int64_t y = month <= 2 ? year - 1 : year;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t year_of_era = y - era * 400;
+  int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                        day - 1;
+  int64_t day_of_era = year_of_era * 365 + year_of_era / 4 -
+                       year_of_era / 100 + day_of_year;
+  return era * kDaysPerEra + day_of_era - kEpochDayOffset;
+}
+
+// The inverse of DaysFromCivil().
+void CivilFromDays(int64_t days, int64_t* year, int* month, int* day) {
+  days += kEpochDayOffset;
+  int64_t era = (days >= 0 ? days : days - kDaysPerEra + 1) / kDaysPerEra;
+  int64_t day_of_era = days - era * kDaysPerEra;
+  int64_t year_of_era = (day_of_era - day_of_era / 1460 +
+                         day_of_era / 36524 - day_of_era / 146096) /
+                        365;
+  int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  int64_t month_from_march = (5 * day_of_year + 2) / 153;
+  *day = day_of_year - (153 * month_from_march + 2) / 5 + 1;
+  *month = month_from_march < 10 ? month_from_march + 3 : month_from_march - 9;
+  *year = year_of_era + era * 400 + (*month <= 2 ? 1 : 0);
+}
+
+// Reads a sequential xs:dateTime, tracking the position in the string.
+class DateTimeReader {
+ public:
+  DateTimeReader(const char* str, size_t size) : str_(str), size_(size) {}
+
+  // Reads exactly |count| decimal digits.
+  bool Digits(size_t count, int* value) {
+    if (size_ - position_ < count) {
+      return false;
+    }
+    int result = 0;
+    for (size_t i = 0; i < count; i++) {
+      char c = str_[position_ + i];
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      result = result * 10 + (c - '0');
+    }
+    position_ += count;
+    *value = result;
+    return true;
+  }
+
+  // Reads one or more digits of a fraction of a second as microseconds.
+  bool Fraction(int64_t* micros) {
+    size_t start = position_;
+    int64_t result = 0;
+    int64_t scale = kMicrosPerSecond / 10;
+    while (position_ < size_ && str_[position_] >= '0' &&
+           str_[position_] <= '9') {
+      result += (str_[position_] - '0') * scale;
+      scale /= 10;
+      position_++;
+    }
+    *micros = result;
+    return position_ > start;
+  }
+
+  // Consumes |c| if it comes next.
+  bool Accept(char c) {
+    if (position_ < size_ && str_[position_] == c) {
+      position_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool AtEnd() const { return position_ == size_; }
+
+ private:
+  const char* str_;
+  size_t size_;
+  size_t position_ = 0;
+};
+
+// Writes |value| as |count| decimal digits.
+char* WriteDigits(int64_t value, int count, char* out) {
+  for (int i = count - 1; i >= 0; i--) {
+    out[i] = '0' + value % 10;
+    value /= 10;
+  }
+  return out + count;
+}
+
+constexpr size_t kRandomBufferSize = 4096;
+
+void RegisterForkHandler();
+
+// Per-thread buffer of random bytes. In deterministic mode the buffer is filled
+// with SHA-256(seed || counter) blocks instead of output from RAND_bytes.
+struct RandomSource {
+  void Refill() {
+    if (deterministic) {
+      for (size_t i = 0; i < kRandomBufferSize; i += SHA256_DIGEST_LENGTH) {
+        uint8_t input[2 * sizeof(uint64_t)];
+        for (size_t j = 0; j < sizeof(uint64_t); j++) {
+          input[j] = seed >> (8 * j);
+          input[sizeof(uint64_t) + j] = counter >> (8 * j);
+        }
+        SHA256(input, sizeof(input), buffer + i);
+        counter++;
+      }
+    } else {
+      RegisterForkHandler();
+      CHECK_EQ(RAND_bytes(buffer, kRandomBufferSize), 1)
+          << "Failed to generate random bytes";
+    }
+    position = 0;
+  }
+
+  void Discard() {
+    memset(buffer, 0, kRandomBufferSize);
+    position = kRandomBufferSize;
+  }
+
+  bool deterministic = false;
+  uint64_t seed = 0;
+  uint64_t counter = 0;
+  uint8_t buffer[kRandomBufferSize];
+  size_t position = kRandomBufferSize;
+};
+
+static_assert(kRandomBufferSize % SHA256_DIGEST_LENGTH == 0,
+              "Random buffer must hold whole SHA-256 blocks.");
+
+thread_local RandomSource random_source;
+
+// A forked child starts with a copy of the forking thread's buffer, which the
+// parent keeps handing out too, so the child drops its copy. Deterministic
+// streams are meant to repeat and are left alone.
+void DiscardAfterFork() {
+  if (!random_source.deterministic) {
+    random_source.Discard();
+  }
+}
+
+void RegisterForkHandler() {
+  static std::once_flag once;
+  std::call_once(once, []() {
+    CHECK_EQ(pthread_atfork(nullptr, nullptr, &DiscardAfterFork), 0);
+  });
+}
+
+}  // namespace
+
+void EncodeHex(const uint8_t* data, size_t size, char* out) {
+  for (size_t i = 0; i < size; i++) {
+    out[2 * i] = kHexDigits[data[i] >> 4];
+    out[2 * i + 1] = kHexDigits[data[i] & 0x0f];
+  }
+}
+
+bool DecodeHex(const char* str, size_t size, uint8_t* out) {
+  if (size % 2 != 0) {
+    return false;
+  }
+  const uint8_t* table = GetHexTable();
+  // Invalid digits map to 0xff, so any of them leaves the high bit set.
+  uint8_t invalid = 0;
+  for (size_t i = 0; i < size / 2; i++) {
+    uint8_t high = table[static_cast<uint8_t>(str[2 * i])];
+    uint8_t low = table[static_cast<uint8_t>(str[2 * i + 1])];
+    invalid |= high | low;
+    out[i] = (high << 4) | (low & 0x0f);
+  }
+  return (invalid & 0x80) == 0;
+}
+
+void EncodeGUID(const uint8_t* data, char* out) {
+  for (size_t i = 0; i < kGUIDSize; i++) {
+    out[kGUIDDigitOffsets[i]] = kHexDigits[data[i] >> 4];
+    out[kGUIDDigitOffsets[i] + 1] = kHexDigits[data[i] & 0x0f];
+  }
+  for (size_t offset : kGUIDDashOffsets) {
+    out[offset] = '-';
+  }
+}
+
+bool DecodeGUID(const char* str, size_t size, uint8_t* out) {
+  if (size == 2 * kGUIDSize) {
+    return DecodeHex(str, size, out);
+  }
+  if (size != kGUIDStringSize) {
+    return false;
+  }
+  const uint8_t* table = GetHexTable();
+  uint8_t invalid = 0;
+  for (size_t offset : kGUIDDashOffsets) {
+    invalid |= str[offset] == '-' ? 0 : 0x80;
+  }
+  for (size_t i = 0; i < kGUIDSize; i++) {
+    uint8_t high = table[static_cast<uint8_t>(str[kGUIDDigitOffsets[i]])];
+    uint8_t low = table[static_cast<uint8_t>(str[kGUIDDigitOffsets[i] + 1])];
+    invalid |= high | low;
+    out[i] = (high << 4) | (low & 0x0f);
+  }
+  return (invalid & 0x80) == 0;
+}
+
+bool DecodeDateTime(const char* str, size_t size, int64_t* micros,
+                    bool* has_timezone) {
+  DateTimeReader reader(str, size);
+  int year, month, day, hour, minute, second;
+  if (!reader.Digits(4, &year) || !reader.Accept('-') ||
+      !reader.Digits(2, &month) || !reader.Accept('-') ||
+      !reader.Digits(2, &day) || !reader.Accept('T') ||
+      !reader.Digits(2, &hour) || !reader.Accept(':') ||
+      !reader.Digits(2, &minute) || !reader.Accept(':') ||
+      !reader.Digits(2, &second)) {
+    return false;
+  }
+  int64_t fraction = 0;
+  if (reader.Accept('.') && !reader.Fraction(&fraction)) {
+    return false;
+  }
+
+  bool timezone = false;
+  int offset_minutes = 0;
+  int sign = 0;
+  if (reader.Accept('Z')) {
+    timezone = true;
+  } else if (reader.Accept('+')) {
+    sign = 1;
+  } else if (reader.Accept('-')) {
+    sign = -1;
+  }
+  if (sign != 0) {
+    int offset_hours;
+    if (!reader.Digits(2, &offset_hours) || !reader.Accept(':') ||
+        !reader.Digits(2, &offset_minutes) || offset_minutes > 59 ||
+        offset_hours * 60 + offset_minutes > 14 * 60) {
+      return false;
+    }
+    offset_minutes = sign * (offset_hours * 60 + offset_minutes);
+    timezone = true;
+  }
+  if (!reader.AtEnd()) {
+    return false;
+  }
+
+  if (year == 0 || month < 1 || month > 12 || day < 1 ||
+      day > DaysInMonth(year, month) || minute > 59 || second > 59 ||
+      (hour > 23 &&
+       (hour != 24 || minute != 0 || second != 0 || fraction != 0))) {
+    return false;
+  }
+
+  int64_t seconds = DaysFromCivil(year, month, day) * kSecondsPerDay +
+                    hour * 3600 + minute * 60 + second -
+                    offset_minutes * 60;
+  *micros = seconds * kMicrosPerSecond + fraction;
+  if (has_timezone) {
+    *has_timezone = timezone;
+  }
+  return true;
+}
+
+size_t EncodeDateTime(int64_t micros, bool utc_designator, char* out) {
+  int64_t seconds = micros / kMicrosPerSecond;
+  int64_t fraction = micros % kMicrosPerSecond;
+  if (fraction < 0) {
+    seconds--;
+    fraction += kMicrosPerSecond;
+  }
+  int64_t days = seconds / kSecondsPerDay;
+  int64_t second_of_day = seconds % kSecondsPerDay;
+  if (second_of_day < 0) {
+    days--;
+    second_of_day += kSecondsPerDay;
+  }
+  int64_t year;
+  int month, day;
+  CivilFromDays(days, &year, &month, &day);
+  if (year < 1 || year > 9999) {
+    return 0;
+  }
+
+  char* end = WriteDigits(year, 4, out);
+  *end++ = '-';
+  end = WriteDigits(month, 2, end);
+  *end++ = '-';
+  end = WriteDigits(day, 2, end);
+  *end++ = 'T';
+  end = WriteDigits(second_of_day / 3600, 2, end);
+  *end++ = ':';
+  end = WriteDigits(second_of_day / 60 % 60, 2, end);
+  *end++ = ':';
+  end = WriteDigits(second_of_day % 60, 2, end);
+  if (fraction != 0) {
+    int digits = 6;
+    while (fraction % 10 == 0) {
+      fraction /= 10;
+      digits--;
+    }
+    *end++ = '.';
+    end = WriteDigits(fraction, digits, end);
+  }
+  if (utc_designator) {
+    *end++ = 'Z';
+  }
+  return end - out;
+}
 
 std::vector<uint8_t> HexStringToBytes(const std::string& str) {
-  std::string byte_string = absl::HexStringToBytes(str);
-  return std::vector<uint8_t>(byte_string.begin(), byte_string.end());
+  std::vector<uint8_t> data(str.size() / 2);
+  if (!DecodeHex(str.data(), str.size(), data.data())) {
+    return std::vector<uint8_t>();
+  }
+  return data;
 }
 
 std::vector<uint8_t> Base64StringToBytes(const std::string& str) {
-  std::string data_str;
-  absl::Base64Unescape(str, &data_str);
-  return std::vector<uint8_t>(data_str.begin(), data_str.end());
+  std::vector<uint8_t> data(Base64DecodedMaxSize(str.size()));
+  size_t size = 0;
+  if (!Base64Decode(str.data(), str.size(), data.data(), &size)) {
+    return std::vector<uint8_t>();
+  }
+  data.resize(size);
+  return data;
 }
 
 std::vector<uint8_t> GUIDStringToBytes(const std::string& str) {
-  std::string stripped = str;
-  stripped.erase(std::remove(stripped.begin(), stripped.end(), '-'),
-                 stripped.end());
-  return HexStringToBytes(stripped);
+  std::vector<uint8_t> data;
+  GUIDStringToBytes(str, &data);
+  return data;
+}
+
+bool GUIDStringToBytes(const std::string& str, std::vector<uint8_t>* bytes) {
+  if (str.empty()) {
+    bytes->clear();
+    return true;
+  }
+  bytes->resize(kGUIDSize);
+  if (!DecodeGUID(str.data(), str.size(), bytes->data())) {
+    bytes->clear();
+    return false;
+  }
+  return true;
 }
 
 std::string BytesToBase64String(const std::vector<uint8_t>& data) {
-  return absl::Base64Escape(absl::string_view(
-      reinterpret_cast<const char*>(data.data()), data.size()));
+  std::string str(Base64EncodedSize(data.size()), '\0');
+  Base64Encode(data.data(), data.size(), &str[0]);
+  return str;
 }
 
 std::string BytesToGUID(const std::vector<uint8_t>& data) {
+  if (data.size() == kGUIDSize) {
+    std::string str(kGUIDStringSize, '-');
+    EncodeGUID(data.data(), &str[0]);
+    return str;
+  }
   std::string str;
   for (size_t i = 0; i < data.size(); i++) {
-    absl::StrAppend(&str, absl::Hex(data[i], absl::kZeroPad2));
+    char digits[2];
+    EncodeHex(&data[i], 1, digits);
+    str.append(digits, 2);
     if (i == 3 || i == 5 || i == 7 || i == 9) {
-      absl::StrAppend(&str, "-");
+      str.push_back('-');
     }
   }
   return str;
 }
 
 std::string BytesToHexString(const std::vector<uint8_t>& data) {
-  std::string str(data.begin(), data.end());
-  return absl::BytesToHexString(str);
+  std::string str(2 * data.size(), '0');
+  EncodeHex(data.data(), data.size(), &str[0]);
+  return str;
 }
 
 std::vector<uint8_t> GetRandomBytes(int num_bytes) {
   std::vector<uint8_t> result(num_bytes);
-  RAND_bytes(result.data(), result.size());
+  GetRandomBytes(result.data(), result.size());
   return result;
 }
 
+void GetRandomBytes(uint8_t* out, size_t size) {
+  RandomSource& source = random_source;
+  if (size >= kRandomBufferSize && !source.deterministic) {
+    CHECK_EQ(RAND_bytes(out, size), 1) << "Failed to generate random bytes";
+    return;
+  }
+  while (size > 0) {
+    if (source.position == kRandomBufferSize) {
+      source.Refill();
+    }
+    size_t count = std::min(size, kRandomBufferSize - source.position);
+    memcpy(out, source.buffer + source.position, count);
+    // Served bytes must not linger in the buffer.
+    memset(source.buffer + source.position, 0, count);
+    source.position += count;
+    out += count;
+    size -= count;
+  }
+}
+
+bool IsDeterministicRandom() { return random_source.deterministic; }
+
+ScopedDeterministicRandom::ScopedDeterministicRandom(uint64_t seed)
+    : previous_deterministic_(random_source.deterministic),
+      previous_seed_(random_source.seed),
+      previous_counter_(random_source.counter),
+      previous_position_(random_source.position) {
+  // An enclosing deterministic stream resumes where it left off.
+  if (previous_deterministic_) {
+    previous_buffer_.assign(random_source.buffer + random_source.position,
+                            random_source.buffer + kRandomBufferSize);
+  }
+  random_source.deterministic = true;
+  random_source.seed = seed;
+  random_source.counter = 0;
+  random_source.Discard();
+}
+
+ScopedDeterministicRandom::~ScopedDeterministicRandom() {
+  random_source.deterministic = previous_deterministic_;
+  random_source.seed = previous_seed_;
+  random_source.counter = previous_counter_;
+  random_source.Discard();
+  if (previous_deterministic_) {
+    memcpy(random_source.buffer + previous_position_, previous_buffer_.data(),
+           previous_buffer_.size());
+    random_source.position = previous_position_;
+  }
+}
+
 std::string AddCertHeadersAndNewlines(const std::string& key) {
   std::string newlines = key;
   for (size_t i = 64; i < newlines.size(); i += 65) {
@@ -15,6 +15,7 @@
 #ifndef CPIX_CC_CPIX_UTIL_H_
 #define CPIX_CC_CPIX_UTIL_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -28,12 +29,63 @@ constexpr char kPrivateKeyFooter[] = "\n-----END PRIVATE KEY-----\n";
 constexpr char kCertHeader[] = "-----BEGIN CERTIFICATE-----\n";
 constexpr char kCertFooter[] = "\n-----END CERTIFICATE-----\n";
 
-// Returns a vector of raw bytes from a string of hex digits.
+// Size in bytes of a GUID, and length of its dashed string form.
+constexpr size_t kGUIDSize = 16;
+constexpr size_t kGUIDStringSize = 36;
+
+// Writes |size| bytes from |data| to |out| as 2 * |size| lowercase hex digits.
+void EncodeHex(const uint8_t* data, size_t size, char* out);
+
+// Decodes |size| hex digits from |str| into |size| / 2 bytes at |out|. Returns
+// false if |size| is odd or |str| contains anything but hex digits, in which
+// case the contents of |out| are unspecified.
+bool DecodeHex(const char* str, size_t size, uint8_t* out);
+
+// Writes the kGUIDSize bytes at |data| to |out| as a kGUIDStringSize-character
+// dashed GUID. The output is not NUL-terminated.
+void EncodeGUID(const uint8_t* data, char* out);
+
+// Decodes a dashed GUID, or a GUID written as 32 bare hex digits, into the
+// kGUIDSize bytes at |out|. Returns false if |str| is malformed.
+bool DecodeGUID(const char* str, size_t size, uint8_t* out);
+
+// Length of the longest xs:dateTime written by EncodeDateTime(),
+// "CCYY-MM-DDThh:mm:ss.ffffffZ".
+constexpr size_t kMaxDateTimeStringSize = 27;
+
+// The earliest and latest times EncodeDateTime() can write, in microseconds
+// since the Unix epoch: 0001-01-01T00:00:00Z and 9999-12-31T23:59:59.999999Z.
+constexpr int64_t kMinDateTime = int64_t{-62135596800} * 1000000;
+constexpr int64_t kMaxDateTime = int64_t{253402300800} * 1000000 - 1;
+
+// Decodes the xs:dateTime "CCYY-MM-DDThh:mm:ss[.s+][Z|(+|-)hh:mm]" in |str|
+// into microseconds since the Unix epoch, UTC. Times without a timezone are
+// taken as UTC, and |has_timezone|, if not null, tells whether there was one.
+// Digits of the fraction past microseconds are dropped. Only years 0001 to
+// 9999 are accepted. Returns false if |str| is malformed or names a date or
+// time that does not exist; 24:00:00 is read as the start of the next day.
+bool DecodeDateTime(const char* str, size_t size, int64_t* micros,
+                    bool* has_timezone);
+
+// Writes |micros| since the Unix epoch to |out| as the canonical xs:dateTime
+// "CCYY-MM-DDThh:mm:ss[.s+][Z]", with the fraction trimmed of trailing zeros
+// and the "Z" only if |utc_designator|. |out| must have room for
+// kMaxDateTimeStringSize characters and is not NUL-terminated. Returns the
+// number of characters written, or 0 if the year is outside 0001 to 9999.
+size_t EncodeDateTime(int64_t micros, bool utc_designator, char* out);
+
+// Returns a vector of raw bytes from a string of hex digits, or an empty vector
+// if |str| is not valid hex.
 std::vector<uint8_t> HexStringToBytes(const std::string& str);
 
-// Returns a vector of raw bytes from a GUID-formatted hex string.
+// Returns a vector of raw bytes from a GUID-formatted hex string, or an empty
+// vector if |str| is malformed.
 std::vector<uint8_t> GUIDStringToBytes(const std::string& str);
 
+// Stores the raw bytes of the GUID-formatted hex string |str| in |bytes|. An
+// empty |str| yields an empty |bytes|. Returns false if |str| is malformed.
+bool GUIDStringToBytes(const std::string& str, std::vector<uint8_t>* bytes);
+
 // Returns a vector of raw bytes from a Base64 encoded string.
 std::vector<uint8_t> Base64StringToBytes(const std::string& str);
 
@@ -49,6 +101,41 @@ std::string BytesToHexString(const std::vector<uint8_t>& data);
 // Get a vector of n / 8 randomly-generated bytes.
 std::vector<uint8_t> GetRandomBytes(int num_bytes);
 
+// Fills |out| with |size| random bytes. Small requests are served from a
+// per-thread buffer that is refilled from RAND_bytes in large chunks, so
+// generating many keys and IVs costs one RNG call per few thousand bytes.
+// Crashes if the RNG fails, rather than returning predictable bytes. A forked
+// child discards the buffer it inherits.
+void GetRandomBytes(uint8_t* out, size_t size);
+
+// While alive, makes the random bytes returned on the calling thread a
+// deterministic function of |seed|, for reproducible benchmarks and golden
+// tests. The stream is SHA-256 in counter mode and must never be used to
+// generate production keys. Buffered bytes are discarded on entry and exit, so
+// deterministic and random output never mix. Scopes may nest: an enclosing
+// deterministic stream continues on exit as if the inner scope never ran.
+class ScopedDeterministicRandom {
+ public:
+  explicit ScopedDeterministicRandom(uint64_t seed);
+  ~ScopedDeterministicRandom();
+
+  ScopedDeterministicRandom(const ScopedDeterministicRandom&) = delete;
+  ScopedDeterministicRandom& operator=(const ScopedDeterministicRandom&) =
+      delete;
+
+ private:
+  bool previous_deterministic_;
+  uint64_t previous_seed_;
+  uint64_t previous_counter_;
+  size_t previous_position_;
+  // Unserved bytes of an enclosing deterministic stream.
+  std::vector<uint8_t> previous_buffer_;
+};
+
+// Returns true while a ScopedDeterministicRandom is alive on the calling
+// thread.
+bool IsDeterministicRandom();
+
 // Takes a base64 encoded certificate PEM string and properly formats it with
 // header/footer and newlines every 64 characters.
 std::string AddCertHeadersAndNewlines(const std::string& key);
@@ -14,8 +14,13 @@
 
 #include "cpix_util.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstdint>
 #include <iterator>
+#include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -137,6 +142,64 @@ TEST(CPIXUtilTest, BytesToGUID) {
 
 TEST(CPIXUtilTest, GetRandomBytes) { EXPECT_EQ(GetRandomBytes(32).size(), 32); }
 
+TEST(CPIXUtilTest, GetRandomBytesIntoBuffer) {
+  std::vector<uint8_t> small(16);
+  std::vector<uint8_t> large(10000);
+  GetRandomBytes(small.data(), small.size());
+  GetRandomBytes(large.data(), large.size());
+  EXPECT_NE(small, std::vector<uint8_t>(16));
+  EXPECT_NE(std::vector<uint8_t>(large.end() - 16, large.end()),
+            std::vector<uint8_t>(16));
+  EXPECT_NE(GetRandomBytes(32), GetRandomBytes(32));
+}
+
+TEST(CPIXUtilTest, DeterministicRandomIsReproducible) {
+  std::vector<uint8_t> first;
+  std::vector<uint8_t> second;
+  {
+    ScopedDeterministicRandom deterministic(42);
+    first = GetRandomBytes(5000);
+  }
+  {
+    ScopedDeterministicRandom deterministic(42);
+    for (int i = 0; i < 50; i++) {
+      std::vector<uint8_t> chunk = GetRandomBytes(100);
+      second.insert(second.end(), chunk.begin(), chunk.end());
+    }
+  }
+  EXPECT_EQ(first, second);
+  {
+    ScopedDeterministicRandom deterministic(43);
+    EXPECT_NE(GetRandomBytes(32),
+              std::vector<uint8_t>(first.begin(), first.begin() + 32));
+  }
+  EXPECT_NE(GetRandomBytes(32),
+            std::vector<uint8_t>(first.begin(), first.begin() + 32));
+}
+
+TEST(CPIXUtilTest, ForkedChildDiscardsBufferedRandomBytes) {
+  // Fills the buffer, leaving most of it to be served.
+  GetRandomBytes(16);
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    std::vector<uint8_t> bytes = GetRandomBytes(16);
+    _exit(write(fds[1], bytes.data(), bytes.size()) == 16 ? 0 : 1);
+  }
+  std::vector<uint8_t> parent = GetRandomBytes(16);
+  std::vector<uint8_t> child(16);
+  EXPECT_EQ(read(fds[0], child.data(), child.size()), 16);
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_NE(parent, child);
+}
+
 TEST(CPIXUtilTest, AddPubKeyHeaders) {
   EXPECT_EQ(AddPubKeyHeadersAndNewlines(kGoodPubKeyNoHeader), kGoodPubKey);
 }
@@ -158,5 +221,107 @@ TEST(CPIXUtilTest, GUIDToBytes) {
             HexStringToBytes(kGoodHexString));
 }
 
+TEST(CPIXUtilTest, HexStringToBytesRejectsMalformed) {
+  EXPECT_TRUE(HexStringToBytes("bd5").empty());
+  EXPECT_TRUE(HexStringToBytes("bd5x").empty());
+  EXPECT_EQ(HexStringToBytes("BD5A"), std::vector<uint8_t>({0xbd, 0x5a}));
+}
+
+TEST(CPIXUtilTest, GUIDToBytesReportsMalformed) {
+  std::vector<uint8_t> bytes;
+  EXPECT_TRUE(GUIDStringToBytes(kGoodHexString, &bytes));
+  EXPECT_EQ(bytes, HexStringToBytes(kGoodHexString));
+  EXPECT_TRUE(GUIDStringToBytes("", &bytes));
+  EXPECT_TRUE(bytes.empty());
+  EXPECT_FALSE(
+      GUIDStringToBytes("bd5adf51-cf04-410f-aac3-ec63a69e929", &bytes));
+  EXPECT_FALSE(
+      GUIDStringToBytes("bd5adf51-cf04-410f-aac3-ec63a69e929g", &bytes));
+  EXPECT_FALSE(
+      GUIDStringToBytes("bd5adf51+cf04-410f-aac3-ec63a69e929e", &bytes));
+  EXPECT_TRUE(bytes.empty());
+}
+
+TEST(CPIXUtilTest, EncodeAndDecodeGUIDInPlace) {
+  char guid[kGUIDStringSize];
+  EncodeGUID(kGoodHexBytes, guid);
+  EXPECT_EQ(std::string(guid, kGUIDStringSize), kGoodGUIDString);
+
+  uint8_t bytes[kGUIDSize];
+  ASSERT_TRUE(DecodeGUID(guid, kGUIDStringSize, bytes));
+  EXPECT_TRUE(std::equal(std::begin(bytes), std::end(bytes), kGoodHexBytes));
+}
+
+std::string RoundTripDateTime(const std::string& str) {
+  int64_t micros;
+  bool has_timezone;
+  if (!DecodeDateTime(str.data(), str.size(), &micros, &has_timezone)) {
+    return "invalid";
+  }
+  char out[kMaxDateTimeStringSize];
+  return std::string(out, EncodeDateTime(micros, has_timezone, out));
+}
+
+TEST(CPIXUtilTest, DecodeDateTime) {
+  int64_t micros;
+  ASSERT_TRUE(DecodeDateTime("1970-01-01T00:00:00Z", 20, &micros, nullptr));
+  EXPECT_EQ(micros, 0);
+  ASSERT_TRUE(DecodeDateTime("2019-03-01T12:34:56.789Z", 24, &micros, nullptr));
+  EXPECT_EQ(micros, 1551443696789000);
+  ASSERT_TRUE(DecodeDateTime("1969-12-31T23:59:59.9999999", 27, &micros,
+                             nullptr));
+  EXPECT_EQ(micros, -1);
+
+  bool has_timezone = true;
+  ASSERT_TRUE(
+      DecodeDateTime("2000-02-29T24:00:00", 19, &micros, &has_timezone));
+  EXPECT_FALSE(has_timezone);
+  int64_t next_day;
+  ASSERT_TRUE(DecodeDateTime("2000-03-01T00:00:00", 19, &next_day, nullptr));
+  EXPECT_EQ(micros, next_day);
+}
+
+TEST(CPIXUtilTest, DecodeDateTimeRejectsMalformed) {
+  for (const std::string str :
+       {"", "2019-03-01", "2019-03-01T12:34", "2019-3-01T12:34:56",
+        "2019-03-01 12:34:56", "2019-03-01T12:34:56.", "2019-03-01T12:34:56z",
+        "2019-03-01T12:34:56+1:00", "2019-03-01T12:34:56+15:00",
+        "2019-03-01T12:34:56Zjunk", "0000-01-01T00:00:00",
+        "2019-13-01T00:00:00", "2019-02-29T00:00:00", "1900-02-29T00:00:00",
+        "2019-03-01T24:00:01", "2019-03-01T12:60:00", "2019-03-01T12:00:60"}) {
+    int64_t micros;
+    EXPECT_FALSE(DecodeDateTime(str.data(), str.size(), &micros, nullptr))
+        << str;
+  }
+}
+
+TEST(CPIXUtilTest, EncodeDateTime) {
+  EXPECT_EQ(RoundTripDateTime("2019-03-01T12:34:56Z"), "2019-03-01T12:34:56Z");
+  EXPECT_EQ(RoundTripDateTime("2019-03-01T12:34:56"), "2019-03-01T12:34:56");
+  EXPECT_EQ(RoundTripDateTime("2019-03-01T12:34:56.120000Z"),
+            "2019-03-01T12:34:56.12Z");
+  EXPECT_EQ(RoundTripDateTime("2019-03-01T01:30:00+02:00"),
+            "2019-02-28T23:30:00Z");
+  EXPECT_EQ(RoundTripDateTime("2019-12-31T23:30:00.000001-01:00"),
+            "2020-01-01T00:30:00.000001Z");
+  EXPECT_EQ(RoundTripDateTime("0001-01-01T00:00:00Z"), "0001-01-01T00:00:00Z");
+  EXPECT_EQ(RoundTripDateTime("9999-12-31T23:59:59.999999Z"),
+            "9999-12-31T23:59:59.999999Z");
+
+  // Offsets can move a time out of the years that can be written.
+  int64_t micros;
+  ASSERT_TRUE(
+      DecodeDateTime("0001-01-01T00:00:00+01:00", 25, &micros, nullptr));
+  char out[kMaxDateTimeStringSize];
+  EXPECT_EQ(EncodeDateTime(micros, true, out), 0);
+
+  EXPECT_EQ(std::string(out, EncodeDateTime(kMinDateTime, true, out)),
+            "0001-01-01T00:00:00Z");
+  EXPECT_EQ(std::string(out, EncodeDateTime(kMaxDateTime, true, out)),
+            "9999-12-31T23:59:59.999999Z");
+  EXPECT_EQ(EncodeDateTime(kMinDateTime - 1, true, out), 0);
+  EXPECT_EQ(EncodeDateTime(kMaxDateTime + 1, true, out), 0);
+}
+
 }  // namespace
 }  // namespace cpix
@@ -0,0 +1,351 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpix_validator.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "content_key.h"
+#include "cpix_util.h"
+#include "drm_system.h"
+#include "key_period.h"
+#include "label.h"
+#include "usage_rule.h"
+
+namespace cpix {
+namespace {
+
+constexpr int64_t kMinValue = std::numeric_limits<int64_t>::min();
+constexpr int64_t kMaxValue = std::numeric_limits<int64_t>::max();
+
+// Matches any value of a key.
+constexpr int32_t kAny = -1;
+
+// The keys a region is grouped on: key period, label and track type.
+constexpr int kKeyCount = 3;
+constexpr int kTrackTypeKey = 2;
+constexpr int32_t kVideo = 0;
+constexpr int32_t kAudio = 1;
+
+// The filter properties a region is swept on.
+constexpr int kRangeCount = 4;
+constexpr int kPixels = 0;
+constexpr int kFps = 1;
+constexpr int kChannels = 2;
+constexpr int kBitrate = 3;
+
+// The tracks one rule matches through one combination of its filters. Keys
+// and KIDs are interned. HDR and WCG filters are ignored, since a track
+// supporting both passes every video filter.
+struct Region {
+  uint32_t rule;
+  int32_t kid;
+  int32_t keys[kKeyCount];
+  int64_t low[kRangeCount];
+  int64_t high[kRangeCount];
+};
+
+using RulePairs = absl::flat_hash_set<std::pair<uint32_t, uint32_t>>;
+
+// Sets the inclusive range of a filter, with -1 for an open end.
+void SetRange(int min, int max, int range, Region* region) {
+  region->low[range] = min == -1 ? kMinValue : min;
+  region->high[range] = max == -1 ? kMaxValue : max;
+}
+
+bool IsUnconstrained(const Region& region, int range) {
+  return region.low[range] == kMinValue && region.high[range] == kMaxValue;
+}
+
+bool IsEmpty(const Region& region) {
+  for (int range = 0; range < kRangeCount; range++) {
+    if (region.low[range] > region.high[range]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RangesMeet(const Region& a, const Region& b) {
+  for (int range = 0; range < kRangeCount; range++) {
+    if (a.high[range] < b.low[range] || b.high[range] < a.low[range]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Expands |rule| into one region per combination of its key period, label,
+// video or audio, and bitrate filters.
+void AddRegions(const UsageRule& rule, uint32_t index, int32_t kid,
+                absl::flat_hash_map<std::string, int32_t>* periods,
+                absl::flat_hash_map<std::string, int32_t>* labels,
+                std::vector<Region>* regions) {
+  // Video filters only match video tracks and audio filters only audio
+  // tracks, so a rule with both matches nothing.
+  if (!rule.video_filters().empty() && !rule.audio_filters().empty()) {
+    return;
+  }
+
+  auto intern = [](const std::string& value,
+                   absl::flat_hash_map<std::string, int32_t>* ids,
+                   std::vector<int32_t>* interned) {
+    interned->push_back(
+        ids->emplace(value, static_cast<int32_t>(ids->size())).first->second);
+  };
+  std::vector<int32_t> period_ids;
+  for (const std::string& period : rule.key_period_filter_ids()) {
+    intern(period, periods, &period_ids);
+  }
+  std::vector<int32_t> label_ids;
+  for (const Label& label : rule.label_filters()) {
+    intern(label.text(), labels, &label_ids);
+  }
+  for (std::vector<int32_t>* interned : {&period_ids, &label_ids}) {
+    if (interned->empty()) {
+      interned->push_back(kAny);
+    }
+  }
+
+  Region any;
+  any.rule = index;
+  any.kid = kid;
+  for (int range = 0; range < kRangeCount; range++) {
+    SetRange(-1, -1, range, &any);
+  }
+  any.keys[kTrackTypeKey] = kAny;
+
+  std::vector<Region> shapes;
+  for (const VideoFilter& filter : rule.video_filters()) {
+    Region shape = any;
+    shape.keys[kTrackTypeKey] = kVideo;
+    SetRange(filter.min_pixels, filter.max_pixels, kPixels, &shape);
+    SetRange(filter.min_fps, filter.max_fps, kFps, &shape);
+    shapes.push_back(shape);
+  }
+  for (const AudioFilter& filter : rule.audio_filters()) {
+    Region shape = any;
+    shape.keys[kTrackTypeKey] = kAudio;
+    SetRange(filter.min_channels, filter.max_channels, kChannels, &shape);
+    shapes.push_back(shape);
+  }
+  if (shapes.empty()) {
+    shapes.push_back(any);
+  }
+  if (!rule.bitrate_filters().empty()) {
+    std::vector<Region> with_bitrates;
+    for (const Region& shape : shapes) {
+      for (const BitrateFilter& filter : rule.bitrate_filters()) {
+        with_bitrates.push_back(shape);
+        SetRange(filter.min_bitrate, filter.max_bitrate, kBitrate,
+                 &with_bitrates.back());
+      }
+    }
+    shapes.swap(with_bitrates);
+  }
+
+  for (int32_t period : period_ids) {
+    for (int32_t label : label_ids) {
+      for (Region shape : shapes) {
+        if (IsEmpty(shape)) {
+          continue;
+        }
+        shape.keys[0] = period;
+        shape.keys[1] = label;
+        regions->push_back(shape);
+      }
+    }
+  }
+}
+
+// Finds the pairs of |regions| for different keys whose ranges meet. The
+// regions are sorted on the range the fewest of them leave open, and only
+// regions still open on it when the next one starts are compared.
+void Sweep(std::vector<const Region*> regions, RulePairs* pairs) {
+  int sweep_range = 0;
+  size_t fewest_open = regions.size() + 1;
+  for (int range = 0; range < kRangeCount; range++) {
+    size_t open = std::count_if(
+        regions.begin(), regions.end(),
+        [range](const Region* region) {
+          return IsUnconstrained(*region, range);
+        });
+    if (open < fewest_open) {
+      fewest_open = open;
+      sweep_range = range;
+    }
+  }
+  std::sort(regions.begin(), regions.end(),
+            [sweep_range](const Region* a, const Region* b) {
+              return a->low[sweep_range] < b->low[sweep_range];
+            });
+
+  std::vector<const Region*> active;
+  for (const Region* region : regions) {
+    int64_t start = region->low[sweep_range];
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [sweep_range, start](const Region* other) {
+                                  return other->high[sweep_range] < start;
+                                }),
+                 active.end());
+    for (const Region* other : active) {
+      if (other->kid != region->kid && RangesMeet(*other, *region)) {
+        pairs->emplace(std::min(other->rule, region->rule),
+                       std::max(other->rule, region->rule));
+      }
+    }
+    active.push_back(region);
+  }
+}
+
+// Splits |regions| on key |key| and recurses into each group that can apply
+// to the same tracks: the regions with one value of the key together with the
+// regions matching any value.
+void FindOverlaps(std::vector<const Region*> regions, int key,
+                  RulePairs* pairs) {
+  if (regions.size() < 2 ||
+      std::all_of(regions.begin(), regions.end(),
+                  [&regions](const Region* region) {
+                    return region->kid == regions.front()->kid;
+                  })) {
+    return;
+  }
+  if (key == kKeyCount) {
+    Sweep(std::move(regions), pairs);
+    return;
+  }
+
+  absl::flat_hash_map<int32_t, std::vector<const Region*>> groups;
+  std::vector<const Region*> any;
+  for (const Region* region : regions) {
+    if (region->keys[key] == kAny) {
+      any.push_back(region);
+    } else {
+      groups[region->keys[key]].push_back(region);
+    }
+  }
+  if (groups.empty()) {
+    FindOverlaps(std::move(any), key + 1, pairs);
+    return;
+  }
+  for (auto& group : groups) {
+    std::vector<const Region*>& members = group.second;
+    members.insert(members.end(), any.begin(), any.end());
+    FindOverlaps(std::move(members), key + 1, pairs);
+  }
+}
+
+}  // namespace
+
+bool CheckReferences(const std::vector<const ContentKey*>& keys,
+                     const std::vector<const DRMSystem*>& drm_systems,
+                     const std::vector<const UsageRule*>& rules,
+                     const std::vector<const KeyPeriod*>& periods,
+                     std::vector<std::string>* errors) {
+  size_t error_count = 0;
+  auto report = [&error_count, errors](std::string error) {
+    error_count++;
+    if (errors) {
+      errors->push_back(std::move(error));
+    }
+  };
+
+  absl::flat_hash_set<std::vector<uint8_t>> kids;
+  kids.reserve(keys.size());
+  for (const ContentKey* key : keys) {
+    if (!kids.insert(key->kid()).second) {
+      report(absl::StrCat("Duplicate content key ", BytesToGUID(key->kid())));
+    }
+  }
+  absl::flat_hash_set<std::string> period_ids;
+  period_ids.reserve(periods.size());
+  for (const KeyPeriod* period : periods) {
+    if (!period_ids.insert(period->id()).second) {
+      report(absl::StrCat("Duplicate key period id ", period->id()));
+    }
+  }
+
+  for (size_t i = 0; i < drm_systems.size(); i++) {
+    if (kids.count(drm_systems[i]->kid()) == 0) {
+      report(absl::StrCat("DRM system ", i, " refers to unknown content key ",
+                          BytesToGUID(drm_systems[i]->kid())));
+    }
+  }
+  for (size_t i = 0; i < rules.size(); i++) {
+    if (kids.count(rules[i]->kid()) == 0) {
+      report(absl::StrCat("Usage rule ", i, " refers to unknown content key ",
+                          BytesToGUID(rules[i]->kid())));
+    }
+    for (const std::string& id : rules[i]->key_period_filter_ids()) {
+      if (period_ids.count(id) == 0) {
+        report(absl::StrCat("Usage rule ", i, " refers to unknown key period ",
+                            id));
+      }
+    }
+  }
+  return error_count == 0;
+}
+
+bool CheckUsageRulesUnambiguous(const std::vector<const UsageRule*>& rules,
+                                std::vector<std::string>* errors) {
+  absl::flat_hash_map<std::vector<uint8_t>, int32_t> kids;
+  absl::flat_hash_map<std::string, int32_t> periods;
+  absl::flat_hash_map<std::string, int32_t> labels;
+  std::vector<Region> regions;
+  regions.reserve(rules.size());
+  for (size_t i = 0; i < rules.size(); i++) {
+    int32_t kid =
+        kids.emplace(rules[i]->kid(), static_cast<int32_t>(kids.size()))
+            .first->second;
+    AddRegions(*rules[i], static_cast<uint32_t>(i), kid, &periods, &labels,
+               &regions);
+  }
+
+  std::vector<const Region*> region_ptrs;
+  region_ptrs.reserve(regions.size());
+  for (const Region& region : regions) {
+    region_ptrs.push_back(&region);
+  }
+  RulePairs pairs;
+  FindOverlaps(std::move(region_ptrs), 0, &pairs);
+  if (pairs.empty()) {
+    return true;
+  }
+
+  if (errors) {
+    std::vector<std::pair<uint32_t, uint32_t>> sorted(pairs.begin(),
+                                                      pairs.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto& pair : sorted) {
+      errors->push_back(absl::StrCat("Usage rules ", pair.first, " and ",
+                                     pair.second,
+                                     " match the same tracks with different "
+                                     "content keys"));
+    }
+  }
+  return false;
+}
+
+}  // namespace cpix
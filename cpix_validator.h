@@ -0,0 +1,54 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_CPIX_VALIDATOR_H_
+#define CPIX_CC_CPIX_VALIDATOR_H_
+
+#include <string>
+#include <vector>
+
+// Semantic checks of CPIX documents that the XML schema cannot express. Each
+// check appends a description of every problem it finds to |errors|, if not
+// null, and returns true if it found none. See CPIXMessage::Validate().
+
+namespace cpix {
+
+class ContentKey;
+class DRMSystem;
+class KeyPeriod;
+class UsageRule;
+
+// Checks that content key KIDs and key period ids are unique, and that every
+// DRM system and usage rule refers to a content key of the document and every
+// KeyPeriodFilter to a key period of the document. Runs in linear time.
+bool CheckReferences(const std::vector<const ContentKey*>& keys,
+                     const std::vector<const DRMSystem*>& drm_systems,
+                     const std::vector<const UsageRule*>& rules,
+                     const std::vector<const KeyPeriod*>& periods,
+                     std::vector<std::string>* errors);
+
+// Checks that no track can match two usage rules for different content keys,
+// which CPIX forbids. Tracks are assumed to carry at most one label.
+//
+// Rules are grouped by key period, then label, then track type, so only rules
+// that can apply to the same tracks are compared, and each group is swept
+// along one filter property so only rules whose ranges meet are compared on
+// the others. A rule without filters of a kind joins every group of that
+// kind, so the cost grows with the number of such rules times the number of
+// groups; documents made of per-period rules stay at O(n log n).
+bool CheckUsageRulesUnambiguous(const std::vector<const UsageRule*>& rules,
+                                std::vector<std::string>* errors);
+
+}  // namespace cpix
+#endif  // CPIX_CC_CPIX_VALIDATOR_H_
@@ -0,0 +1,183 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpix_validator.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "content_key.h"
+#include "drm_system.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "key_period.h"
+#include "usage_rule.h"
+
+namespace cpix {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+std::vector<uint8_t> Kid(uint8_t index) {
+  std::vector<uint8_t> kid(16);
+  kid[15] = index;
+  return kid;
+}
+
+class UsageRuleOverlapTest : public ::testing::Test {
+ protected:
+  UsageRule* AddRule(uint8_t kid) {
+    rules_.push_back(absl::make_unique<UsageRule>());
+    rules_.back()->set_key_id(Kid(kid));
+    return rules_.back().get();
+  }
+
+  // Returns the descriptions of the overlaps found.
+  std::vector<std::string> Check() {
+    std::vector<const UsageRule*> rules;
+    for (const auto& rule : rules_) {
+      rules.push_back(rule.get());
+    }
+    std::vector<std::string> errors;
+    bool unambiguous = CheckUsageRulesUnambiguous(rules, &errors);
+    EXPECT_EQ(unambiguous, errors.empty());
+    return errors;
+  }
+
+  std::vector<std::unique_ptr<UsageRule>> rules_;
+};
+
+TEST_F(UsageRuleOverlapTest, DisjointVideoRanges) {
+  VideoFilter sd;
+  sd.max_pixels = 1000;
+  AddRule(0)->AddVideoFilter(sd);
+  VideoFilter hd;
+  hd.min_pixels = 1001;
+  AddRule(1)->AddVideoFilter(hd);
+  AudioFilter audio;
+  AddRule(2)->AddAudioFilter(audio);
+  EXPECT_TRUE(Check().empty());
+
+  // A rule without video or audio filters matches every track.
+  AddRule(3);
+  EXPECT_THAT(Check(),
+              ElementsAre(HasSubstr("rules 0 and 3"),
+                          HasSubstr("rules 1 and 3"),
+                          HasSubstr("rules 2 and 3")));
+}
+
+TEST_F(UsageRuleOverlapTest, OverlappingRanges) {
+  VideoFilter low;
+  low.max_pixels = 1000;
+  low.max_fps = 30;
+  AddRule(0)->AddVideoFilter(low);
+  VideoFilter high_fps;
+  high_fps.min_fps = 31;
+  AddRule(1)->AddVideoFilter(high_fps);
+  EXPECT_TRUE(Check().empty());
+
+  VideoFilter high;
+  high.min_pixels = 1000;
+  high.min_fps = 24;
+  AddRule(2)->AddVideoFilter(high);
+  EXPECT_THAT(Check(), ElementsAre(HasSubstr("rules 0 and 2"),
+                                   HasSubstr("rules 1 and 2")));
+}
+
+TEST_F(UsageRuleOverlapTest, SameKeyMayOverlap) {
+  AddRule(0)->AddLabelFilter("a");
+  AddRule(0);
+  EXPECT_TRUE(Check().empty());
+}
+
+TEST_F(UsageRuleOverlapTest, BitrateAppliesToEveryTrackType) {
+  BitrateFilter low;
+  low.max_bitrate = 100;
+  AddRule(0)->AddBitrateFilter(low);
+  UsageRule* audio = AddRule(1);
+  audio->AddAudioFilter(AudioFilter());
+  BitrateFilter high;
+  high.min_bitrate = 101;
+  audio->AddBitrateFilter(high);
+  EXPECT_TRUE(Check().empty());
+
+  high.min_bitrate = 100;
+  AddRule(2)->AddBitrateFilter(high);
+  EXPECT_THAT(Check(), ElementsAre(HasSubstr("rules 0 and 2"),
+                                   HasSubstr("rules 1 and 2")));
+}
+
+TEST_F(UsageRuleOverlapTest, LabelsAndPeriodsSeparateRules) {
+  for (uint8_t period = 0; period < 3; period++) {
+    for (uint8_t label = 0; label < 2; label++) {
+      UsageRule* rule = AddRule(period * 2 + label);
+      rule->AddKeyPeriodFilter("p" + std::to_string(period));
+      rule->AddLabelFilter("l" + std::to_string(label));
+    }
+  }
+  EXPECT_TRUE(Check().empty());
+
+  // Applies to label l1 in every period.
+  AddRule(9)->AddLabelFilter("l1");
+  EXPECT_THAT(Check(),
+              ElementsAre(HasSubstr("rules 1 and 6"),
+                          HasSubstr("rules 3 and 6"),
+                          HasSubstr("rules 5 and 6")));
+}
+
+TEST_F(UsageRuleOverlapTest, ManyPeriods) {
+  for (int period = 0; period < 100000; period++) {
+    AddRule(period % 200)->AddKeyPeriodFilter(std::to_string(period));
+  }
+  EXPECT_TRUE(Check().empty());
+  AddRule(255)->AddKeyPeriodFilter("99999");
+  EXPECT_THAT(Check(), ElementsAre(HasSubstr("rules 99999 and 100000")));
+}
+
+TEST(CheckReferencesTest, FindsDanglingReferences) {
+  ContentKey key;
+  key.set_key_id(Kid(1));
+  ContentKey duplicate;
+  duplicate.set_key_id(Kid(1));
+  KeyPeriod period;
+  period.set_id("p1");
+  DRMSystem drm;
+  drm.set_key_id(Kid(2));
+  UsageRule good;
+  good.set_key_id(Kid(1));
+  good.AddKeyPeriodFilter("p1");
+  UsageRule bad;
+  bad.set_key_id(Kid(1));
+  bad.AddKeyPeriodFilter("p2");
+
+  std::vector<std::string> errors;
+  EXPECT_TRUE(CheckReferences({&key}, {}, {&good}, {&period}, &errors));
+  EXPECT_TRUE(errors.empty());
+
+  EXPECT_FALSE(CheckReferences({&key, &duplicate}, {&drm}, {&good, &bad},
+                               {&period, &period}, &errors));
+  EXPECT_THAT(
+      errors,
+      ElementsAre(HasSubstr("Duplicate content key"),
+                  HasSubstr("Duplicate key period id p1"),
+                  HasSubstr("DRM system 0 refers to unknown content key"),
+                  HasSubstr("Usage rule 1 refers to unknown key period p2")));
+}
+
+}  // namespace
+}  // namespace cpix
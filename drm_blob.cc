@@ -0,0 +1,107 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "drm_blob.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "cpix_util.h"
+#include "intern_table.h"
+
+namespace cpix {
+
+DRMBlob::DRMBlob(std::vector<uint8_t> data, std::string base64,
+                 bool from_base64)
+    : from_base64_(from_base64),
+      done_(false),
+      data_(std::move(data)),
+      base64_(std::move(base64)) {}
+
+DRMBlob::~DRMBlob() = default;
+
+InternTable<DRMBlob>& DRMBlob::ByData() {
+  static InternTable<DRMBlob>* const kTable =
+      new InternTable<DRMBlob>(&DRMBlob::KeyOf);
+  return *kTable;
+}
+
+InternTable<DRMBlob>& DRMBlob::ByBase64() {
+  static InternTable<DRMBlob>* const kTable =
+      new InternTable<DRMBlob>(&DRMBlob::KeyOf);
+  return *kTable;
+}
+
+std::shared_ptr<const DRMBlob> DRMBlob::Intern(
+    const std::vector<uint8_t>& data) {
+  if (data.empty()) {
+    return nullptr;
+  }
+  absl::string_view key(reinterpret_cast<const char*>(data.data()),
+                        data.size());
+  return ByData().Intern(key,
+                         [&data]() { return new DRMBlob(data, "", false); });
+}
+
+std::shared_ptr<const DRMBlob> DRMBlob::InternBase64(
+    const std::string& base64) {
+  if (base64.empty()) {
+    return nullptr;
+  }
+  return ByBase64().Intern(base64, [&base64]() {
+    return new DRMBlob(std::vector<uint8_t>(), base64, true);
+  });
+}
+
+size_t DRMBlob::live_count() { return ByData().size() + ByBase64().size(); }
+
+const std::vector<uint8_t>& DRMBlob::data() const {
+  if (from_base64_) {
+    std::call_once(once_, [this]() {
+      data_ = Base64StringToBytes(base64_);
+      done_.store(true, std::memory_order_release);
+    });
+  }
+  return data_;
+}
+
+const std::string& DRMBlob::base64() const {
+  if (!from_base64_) {
+    std::call_once(once_, [this]() {
+      base64_ = BytesToBase64String(data_);
+      done_.store(true, std::memory_order_release);
+    });
+  }
+  return base64_;
+}
+
+bool DRMBlob::is_encoded() const {
+  return from_base64_ && !done_.load(std::memory_order_acquire);
+}
+
+absl::string_view DRMBlob::key() const {
+  if (from_base64_) {
+    return base64_;
+  }
+  return absl::string_view(reinterpret_cast<const char*>(data_.data()),
+                           data_.size());
+}
+
+absl::string_view DRMBlob::KeyOf(const DRMBlob& blob) { return blob.key(); }
+
+}  // namespace cpix
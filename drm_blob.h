@@ -0,0 +1,100 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_DRM_BLOB_H_
+#define CPIX_CC_DRM_BLOB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace cpix {
+
+template <typename T>
+class InternTable;
+
+// An immutable DRM signaling payload, such as the ContentProtectionData of a
+// DRMSystem. The DRM systems of one system ID usually carry the same payloads
+// for every key, so blobs are interned by content: every DRMSystem in the
+// process holding the same bytes shares one reference-counted blob, and with it
+// one cached Base64 encoding. A blob is dropped from the intern table when its
+// last holder releases it. Blobs may be shared between threads.
+//
+// Blobs read from documents keep their Base64 text instead, interned by that
+// text. They are decoded on first access to the data, and serialize back to
+// the text they were read from, so passing a document through never decodes
+// or re-encodes its payloads.
+class DRMBlob {
+ public:
+  ~DRMBlob();
+
+  DRMBlob(const DRMBlob&) = delete;
+  DRMBlob& operator=(const DRMBlob&) = delete;
+
+  // Returns the blob holding |data|, creating it if no live blob holds the same
+  // bytes. Returns nullptr for empty |data|.
+  static std::shared_ptr<const DRMBlob> Intern(
+      const std::vector<uint8_t>& data);
+
+  // Returns the blob read from the Base64 text |base64|, creating it if no
+  // live blob was read from the same text. Returns nullptr for empty
+  // |base64|. The text is not checked until the data is first accessed.
+  static std::shared_ptr<const DRMBlob> InternBase64(
+      const std::string& base64);
+
+  // Returns the number of live blobs in the process.
+  static size_t live_count();
+
+  // Returns the data, decoding it on first use for blobs read from Base64. The
+  // data of text that is not valid Base64 is empty.
+  const std::vector<uint8_t>& data() const;
+
+  // Returns the Base64 encoding of the data, computed on first use, or the
+  // text the blob was read from.
+  const std::string& base64() const;
+
+  // Returns true if the data has not been decoded from Base64 yet.
+  bool is_encoded() const;
+
+ private:
+  DRMBlob(std::vector<uint8_t> data, std::string base64, bool from_base64);
+
+  // The intern tables of blobs made from data and of blobs read from Base64,
+  // kept apart.
+  static InternTable<DRMBlob>& ByData();
+  static InternTable<DRMBlob>& ByBase64();
+
+  // The interned form: the text for blobs read from Base64, the data
+  // otherwise. Stable for the lifetime of the blob.
+  absl::string_view key() const;
+  static absl::string_view KeyOf(const DRMBlob& blob);
+
+  // Whether the blob was read from Base64, which decides which of the fields
+  // below is computed lazily.
+  const bool from_base64_;
+  mutable std::once_flag once_;
+  mutable std::atomic<bool> done_;
+  mutable std::vector<uint8_t> data_;
+  mutable std::string base64_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_DRM_BLOB_H_
@@ -0,0 +1,104 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "drm_blob.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+TEST(DRMBlobTest, InternsByContent) {
+  size_t live = DRMBlob::live_count();
+  std::shared_ptr<const DRMBlob> blob =
+      DRMBlob::Intern(std::vector<uint8_t>{1, 2, 3});
+  ASSERT_NE(blob, nullptr);
+  EXPECT_EQ(blob->data(), std::vector<uint8_t>({1, 2, 3}));
+  EXPECT_EQ(DRMBlob::Intern(std::vector<uint8_t>{1, 2, 3}), blob);
+  EXPECT_NE(DRMBlob::Intern(std::vector<uint8_t>{1, 2, 4}), blob);
+  EXPECT_EQ(DRMBlob::live_count(), live + 1);
+  EXPECT_EQ(DRMBlob::Intern(std::vector<uint8_t>()), nullptr);
+
+  blob.reset();
+  EXPECT_EQ(DRMBlob::live_count(), live);
+}
+
+TEST(DRMBlobTest, CachesBase64) {
+  std::shared_ptr<const DRMBlob> blob =
+      DRMBlob::Intern(std::vector<uint8_t>{'c', 'p', 'i', 'x'});
+  const std::string& base64 = blob->base64();
+  EXPECT_EQ(base64, "Y3BpeA==");
+  EXPECT_EQ(&DRMBlob::Intern(std::vector<uint8_t>{'c', 'p', 'i', 'x'})
+                 ->base64(),
+            &base64);
+}
+
+TEST(DRMBlobTest, DecodesBase64Lazily) {
+  // Wrapped text, which is valid but not what encoding the data gives.
+  std::shared_ptr<const DRMBlob> blob = DRMBlob::InternBase64("Y3Bp\neA==");
+  ASSERT_NE(blob, nullptr);
+  EXPECT_EQ(DRMBlob::InternBase64("Y3Bp\neA=="), blob);
+  EXPECT_TRUE(blob->is_encoded());
+  EXPECT_EQ(blob->base64(), "Y3Bp\neA==");
+  EXPECT_TRUE(blob->is_encoded());
+  EXPECT_EQ(blob->data(), std::vector<uint8_t>({'c', 'p', 'i', 'x'}));
+  EXPECT_FALSE(blob->is_encoded());
+  // Still serializes to the text it was read from.
+  EXPECT_EQ(blob->base64(), "Y3Bp\neA==");
+
+  EXPECT_TRUE(DRMBlob::InternBase64("not base64!")->data().empty());
+  EXPECT_EQ(DRMBlob::InternBase64(""), nullptr);
+}
+
+TEST(DRMBlobTest, ConcurrentIntern) {
+  size_t live = DRMBlob::live_count();
+  std::vector<std::vector<std::shared_ptr<const DRMBlob>>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&result]() {
+      for (int round = 0; round < 100; round++) {
+        for (uint8_t value = 0; value < 50; value++) {
+          std::shared_ptr<const DRMBlob> blob =
+              DRMBlob::Intern(std::vector<uint8_t>(100, value));
+          blob->base64();
+          // Decoded concurrently by every thread.
+          DRMBlob::InternBase64(blob->base64())->data();
+          if (round == 99) {
+            result.push_back(blob);
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (size_t value = 0; value < 50; value++) {
+    for (const auto& result : results) {
+      EXPECT_EQ(result[value], results[0][value]);
+    }
+  }
+  EXPECT_EQ(DRMBlob::live_count(), live + 50);
+  results.clear();
+  EXPECT_EQ(DRMBlob::live_count(), live);
+}
+
+}  // namespace
+}  // namespace cpix
@@ -20,12 +20,19 @@
 
 #include "absl/memory/memory.h"
 #include "cpix_util.h"
+#include "glog/logging.h"
 #include "xml_node.h"
 
 namespace cpix {
 DRMSystem::~DRMSystem() = default;
 
-std::unique_ptr<XMLNode> DRMSystem::GetNode() {
+const std::vector<uint8_t>& DRMSystem::Bytes(
+    const std::shared_ptr<const DRMBlob>& blob) {
+  static const std::vector<uint8_t>* const kEmpty = new std::vector<uint8_t>;
+  return blob ? blob->data() : *kEmpty;
+}
+
+std::unique_ptr<XMLNode> DRMSystem::GetNode() const {
   if (kid_.empty() || system_id_.empty()) {
     return nullptr;
   }
@@ -39,53 +46,53 @@ std::unique_ptr<XMLNode> DRMSystem::GetNode() {
   root->AddAttribute("kid", BytesToGUID(kid_));
   root->AddAttribute("systemId", BytesToGUID(system_id_));
 
-  if (!pssh_.empty()) {
+  if (pssh_) {
     std::unique_ptr<XMLNode> child = absl::make_unique<XMLNode>("", "PSSH");
-    child->SetContent(BytesToBase64String(pssh_));
+    child->SetContent(pssh_->base64());
     root->AddChild(std::move(child));
   }
 
-  if (!content_protection_data_.empty()) {
+  if (content_protection_data_) {
     std::unique_ptr<XMLNode> child =
         absl::make_unique<XMLNode>("", "ContentProtectionData");
-    child->SetContent(BytesToBase64String(content_protection_data_));
+    child->SetContent(content_protection_data_->base64());
     root->AddChild(std::move(child));
   }
 
-  if (!uri_ext_x_key_.empty()) {
+  if (uri_ext_x_key_) {
     std::unique_ptr<XMLNode> child =
         absl::make_unique<XMLNode>("", "URIExtXKey");
-    child->SetContent(BytesToBase64String(uri_ext_x_key_));
+    child->SetContent(uri_ext_x_key_->base64());
     root->AddChild(std::move(child));
   }
 
-  if (!hls_signaling_master_.empty()) {
+  if (hls_signaling_master_) {
     std::unique_ptr<XMLNode> child =
         absl::make_unique<XMLNode>("", "HLSSignalingData");
-    child->SetContent(BytesToBase64String(hls_signaling_master_));
+    child->SetContent(hls_signaling_master_->base64());
     child->AddAttribute("playlist", "master");
     root->AddChild(std::move(child));
   }
 
-  if (!hls_signaling_media_.empty()) {
+  if (hls_signaling_media_) {
     std::unique_ptr<XMLNode> child =
         absl::make_unique<XMLNode>("", "HLSSignalingData");
-    child->SetContent(BytesToBase64String(hls_signaling_media_));
+    child->SetContent(hls_signaling_media_->base64());
     child->AddAttribute("playlist", "media");
     root->AddChild(std::move(child));
   }
 
-  if (!smooth_streaming_data_.empty()) {
+  if (smooth_streaming_data_) {
     std::unique_ptr<XMLNode> child =
         absl::make_unique<XMLNode>("", "SmoothStreamingProtectionHeaderData");
-    child->SetContent(BytesToBase64String(smooth_streaming_data_));
+    child->SetContent(smooth_streaming_data_->base64());
     root->AddChild(std::move(child));
   }
 
-  if (!hds_signaling_data_.empty()) {
+  if (hds_signaling_data_) {
     std::unique_ptr<XMLNode> child =
         absl::make_unique<XMLNode>("", "HDSSignalingData");
-    child->SetContent(BytesToBase64String(hds_signaling_data_));
+    child->SetContent(hds_signaling_data_->base64());
     root->AddChild(std::move(child));
   }
 
@@ -98,49 +105,49 @@ bool DRMSystem::Deserialize(std::unique_ptr<XMLNode> node) {
     set_id(attribute);
   }
 
-  kid_ = GUIDStringToBytes(node->GetAttribute("kid"));
-  system_id_ = GUIDStringToBytes(node->GetAttribute("systemId"));
+  if (!GUIDStringToBytes(node->GetAttribute("kid"), &kid_)) {
+    LOG(ERROR) << "Malformed kid attribute.";
+    return false;
+  }
+  if (!GUIDStringToBytes(node->GetAttribute("systemId"), &system_id_)) {
+    LOG(ERROR) << "Malformed systemId attribute.";
+    return false;
+  }
 
   std::unique_ptr<XMLNode> child;
   child = node->GetFirstChildByName("PSSH");
   if (child) {
-    pssh_ = Base64StringToBytes(child->GetContent());
+    pssh_ = DRMBlob::InternBase64(child->GetContent());
   }
 
   child = node->GetFirstChildByName("ContentProtectionData");
   if (child) {
-    content_protection_data_ = Base64StringToBytes(child->GetContent());
+    content_protection_data_ = DRMBlob::InternBase64(child->GetContent());
   }
 
   child = node->GetFirstChildByName("URIExtXKey");
   if (child) {
-    uri_ext_x_key_ = Base64StringToBytes(child->GetContent());
+    uri_ext_x_key_ = DRMBlob::InternBase64(child->GetContent());
   }
 
-  child = node->GetFirstChildByName("HLSSignalingData");
-
-  if (child->GetAttribute("playlist") == "master") {
-    hls_signaling_master_ = Base64StringToBytes(child->GetContent());
-  } else {
-    hls_signaling_media_ = Base64StringToBytes(child->GetContent());
-  }
-
-  child = node->GetFirstChildByName("HLSSignalingData");
-
-  if (child->GetAttribute("playlist") == "master") {
-    hls_signaling_master_ = Base64StringToBytes(child->GetContent());
-  } else {
-    hls_signaling_media_ = Base64StringToBytes(child->GetContent());
+  // One element for the master playlist and one for the media playlist, both
+  // optional.
+  while ((child = node->GetFirstChildByName("HLSSignalingData"))) {
+    if (child->GetAttribute("playlist") == "master") {
+      hls_signaling_master_ = DRMBlob::InternBase64(child->GetContent());
+    } else {
+      hls_signaling_media_ = DRMBlob::InternBase64(child->GetContent());
+    }
   }
 
   child = node->GetFirstChildByName("SmoothStreamingProtectionHeaderData");
   if (child) {
-    smooth_streaming_data_ = Base64StringToBytes(child->GetContent());
+    smooth_streaming_data_ = DRMBlob::InternBase64(child->GetContent());
   }
 
   child = node->GetFirstChildByName("HDSSignalingData");
   if (child) {
-    hds_signaling_data_ = Base64StringToBytes(child->GetContent());
+    hds_signaling_data_ = DRMBlob::InternBase64(child->GetContent());
   }
 
   return true;
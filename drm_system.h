@@ -18,9 +18,11 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cpix_element.h"
+#include "drm_blob.h"
 
 namespace cpix {
 
@@ -28,6 +30,9 @@ class XMLNode;
 
 // A core element of the CPIX document. Contains information directly related to
 // a DRM system. One DRMSystem object maps to one ContentKey through |kid_|.
+// Signaling payloads are shared with every other DRMSystem holding the same
+// bytes. Payloads read from a document are only decoded when first accessed,
+// and are written back as they were read unless set again; see DRMBlob.
 
 class DRMSystem : public CPIXElement {
  public:
@@ -37,22 +42,24 @@ class DRMSystem : public CPIXElement {
   const std::vector<uint8_t>& kid() const { return kid_; }
   const std::vector<uint8_t>& system_id() const { return system_id_; }
   const std::vector<uint8_t>& content_protection_data() const {
-    return content_protection_data_;
+    return Bytes(content_protection_data_);
   }
-  const std::vector<uint8_t>& pssh() const { return pssh_; }
+  const std::vector<uint8_t>& pssh() const { return Bytes(pssh_); }
   const std::vector<uint8_t>& hls_signaling_master() const {
-    return hls_signaling_master_;
+    return Bytes(hls_signaling_master_);
   }
   const std::vector<uint8_t>& hls_signaling_media() const {
-    return hls_signaling_media_;
+    return Bytes(hls_signaling_media_);
   }
   const std::vector<uint8_t>& hds_signaling_data() const {
-    return hds_signaling_data_;
+    return Bytes(hds_signaling_data_);
   }
   const std::vector<uint8_t>& smooth_streaming_data() const {
-    return smooth_streaming_data_;
+    return Bytes(smooth_streaming_data_);
+  }
+  const std::vector<uint8_t>& uri_ext_x_key() const {
+    return Bytes(uri_ext_x_key_);
   }
-  const std::vector<uint8_t>& uri_ext_x_key() const { return uri_ext_x_key_; }
 
   void set_key_id(const std::vector<uint8_t>& kid) { kid_ = kid; }
 
@@ -60,24 +67,31 @@ class DRMSystem : public CPIXElement {
     system_id_ = system_id;
   }
   void set_content_protection_data(const std::vector<uint8_t>& data) {
-    content_protection_data_ = data;
+    content_protection_data_ = DRMBlob::Intern(data);
+  }
+  void set_pssh(const std::vector<uint8_t>& pssh) {
+    pssh_ = DRMBlob::Intern(pssh);
+  }
+  // Like above, with a box that is already interned, such as one from
+  // PsshBuilder.
+  void set_pssh(std::shared_ptr<const DRMBlob> pssh) {
+    pssh_ = std::move(pssh);
   }
-  void set_pssh(const std::vector<uint8_t>& pssh) { pssh_ = pssh; }
   void set_hls_signaling_master(const std::vector<uint8_t>& hls) {
-    hls_signaling_master_ = hls;
+    hls_signaling_master_ = DRMBlob::Intern(hls);
   }
   void set_hls_signaling_media(const std::vector<uint8_t>& hls) {
-    hls_signaling_media_ = hls;
+    hls_signaling_media_ = DRMBlob::Intern(hls);
   }
   void set_smooth_streaming_data(const std::vector<uint8_t>& data) {
-    smooth_streaming_data_ = data;
+    smooth_streaming_data_ = DRMBlob::Intern(data);
   }
   void set_uri_ext_x_key(const std::vector<uint8_t>& key) {
-    uri_ext_x_key_ = key;
+    uri_ext_x_key_ = DRMBlob::Intern(key);
   }
 
   void set_hds_ignaling_data(const std::vector<uint8_t>& data) {
-    hds_signaling_data_ = data;
+    hds_signaling_data_ = DRMBlob::Intern(data);
   }
 
  protected:
@@ -85,17 +99,22 @@ class DRMSystem : public CPIXElement {
 
  private:
   friend class DRMSystemList;
-  std::unique_ptr<XMLNode> GetNode() override;
+  std::unique_ptr<XMLNode> GetNode() const override;
+
+  // Returns the data of |blob|, or an empty vector if it is null.
+  static const std::vector<uint8_t>& Bytes(
+      const std::shared_ptr<const DRMBlob>& blob);
 
   std::vector<uint8_t> kid_;
   std::vector<uint8_t> system_id_;
-  std::vector<uint8_t> content_protection_data_;
-  std::vector<uint8_t> pssh_;
-  std::vector<uint8_t> hls_signaling_master_;
-  std::vector<uint8_t> hls_signaling_media_;
-  std::vector<uint8_t> smooth_streaming_data_;
-  std::vector<uint8_t> uri_ext_x_key_;
-  std::vector<uint8_t> hds_signaling_data_;
+  // Payloads are interned, see DRMBlob. Null when empty.
+  std::shared_ptr<const DRMBlob> content_protection_data_;
+  std::shared_ptr<const DRMBlob> pssh_;
+  std::shared_ptr<const DRMBlob> hls_signaling_master_;
+  std::shared_ptr<const DRMBlob> hls_signaling_media_;
+  std::shared_ptr<const DRMBlob> smooth_streaming_data_;
+  std::shared_ptr<const DRMBlob> uri_ext_x_key_;
+  std::shared_ptr<const DRMBlob> hds_signaling_data_;
 };  // namespace cpix
 }  // namespace cpix
 
@@ -17,10 +17,13 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
-#include "absl/memory/memory.h"
 #include "cpix_element.h"
 #include "drm_system.h"
+#include "executor.h"
+#include "glog/logging.h"
+#include "pssh.h"
 #include "xml_node.h"
 
 namespace cpix {
@@ -34,8 +37,48 @@ bool DRMSystemList::AddDRMSystem(std::unique_ptr<DRMSystem> drm) {
   return true;
 }
 
-std::unique_ptr<CPIXElement> DRMSystemList::CreateElement() {
-  return absl::make_unique<DRMSystem>();
+bool DRMSystemList::AddDRMSystems(
+    std::vector<std::unique_ptr<DRMSystem>> drms) {
+  for (const auto& drm : drms) {
+    if (drm->system_id().empty() || drm->kid().empty()) {
+      return false;
+    }
+  }
+  AddElements(std::move(drms));
+  return true;
+}
+
+bool DRMSystemList::BuildPsshBoxes(PsshBuilder* builder) {
+  for (const DRMSystem* drm : elements_) {
+    if (drm->system_id().size() != kPsshSystemIdSize ||
+        drm->kid().size() != kPsshKidSize) {
+      return false;
+    }
+  }
+
+  // Every box is built before any is set, so a failure changes nothing.
+  std::vector<std::shared_ptr<const DRMBlob>> boxes(elements_.size());
+  ParallelFor(executor_, elements_.size(), kParallelGrain,
+              [this, builder, &boxes](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                  const DRMSystem* drm = elements_[i];
+                  boxes[i] = builder->Build(drm->system_id(), {drm->kid()});
+                }
+              });
+  for (const std::shared_ptr<const DRMBlob>& box : boxes) {
+    if (!box) {
+      LOG(ERROR) << "Failed to build a PSSH box.";
+      return false;
+    }
+  }
+  for (size_t i = 0; i < elements_.size(); i++) {
+    DRMSystem* drm = elements_[i];
+    if (boxes[i] != drm->pssh_) {
+      drm->set_pssh(std::move(boxes[i]));
+      InvalidateFragment(drm);
+    }
+  }
+  return true;
 }
 
 }  // namespace cpix
@@ -16,22 +16,32 @@
 #define CPIX_CC_DRM_SYSTEM_LIST_H_
 
 #include <memory>
+#include <vector>
 
 #include "cpix_element.h"
 #include "cpix_element_list.h"
 #include "drm_system.h"
+#include "pssh.h"
 
 namespace cpix {
 
-class DRMSystemList : public CPIXElementList {
+class DRMSystemList : public CPIXElementList<DRMSystem> {
  public:
-  DRMSystemList() : CPIXElementList("DRMSystemList") {}
+  DRMSystemList() : CPIXElementList<DRMSystem>("DRMSystemList") {}
   ~DRMSystemList();
   bool AddDRMSystem(std::unique_ptr<DRMSystem> drm);
 
+  // Adds all of |drms|, or none of them if any lacks a system ID or KID.
+  bool AddDRMSystems(std::vector<std::unique_ptr<DRMSystem>> drms);
+
+  // Sets the PSSH of every DRM system to the box |builder| gives for its
+  // system ID and KID, spread over the executor. Returns false, changing
+  // nothing, if the system ID or KID of any DRM system is not 16 bytes
+  // long, or if any box cannot be built.
+  bool BuildPsshBoxes(PsshBuilder* builder);
+
  private:
   friend class CPIXMessage;
-  std::unique_ptr<CPIXElement> CreateElement();
 };
 }  // namespace cpix
 
@@ -16,12 +16,15 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "cpix_util.h"
 #include "drm_system.h"
+#include "executor.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "pssh.h"
 #include "testable_cpix_element.h"
 #include "xml_node.h"
 
@@ -34,7 +37,7 @@ using ::testing::Test;
 
 class MockDRMSystem : public DRMSystem {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 constexpr char kGoodXML[] =
@@ -66,5 +69,58 @@ TEST(DRMSystemListTest, SerializeDRMSystemList) {
   EXPECT_EQ(drm_list.Serialize(), kGoodXML);
 }
 
+TEST(DRMSystemListTest, BuildPsshBoxes) {
+  const std::vector<uint8_t> widevine(kWidevineSystemId,
+                                      kWidevineSystemId + kPsshSystemIdSize);
+  const std::vector<uint8_t> playready(
+      kPlayReadySystemId, kPlayReadySystemId + kPsshSystemIdSize);
+  WorkStealingPool pool(4);
+  DRMSystemList drm_list;
+  drm_list.set_executor(&pool);
+  // Enough systems to be spread over the pool, two per key.
+  std::vector<const DRMSystem*> drms;
+  for (int i = 0; i < 300; i++) {
+    std::vector<uint8_t> kid(kPsshKidSize);
+    kid[0] = i >> 8;
+    kid[1] = i;
+    for (const std::vector<uint8_t>* system_id : {&widevine, &playready}) {
+      std::unique_ptr<DRMSystem> drm = absl::make_unique<DRMSystem>();
+      drm->set_system_id(*system_id);
+      drm->set_key_id(kid);
+      drms.push_back(drm.get());
+      ASSERT_TRUE(drm_list.AddDRMSystem(std::move(drm)));
+    }
+  }
+
+  PsshBuilder builder;
+  ASSERT_TRUE(drm_list.BuildPsshBoxes(&builder));
+  EXPECT_EQ(builder.misses(), 600u);
+  for (const DRMSystem* drm : drms) {
+    PsshBoxView view;
+    ASSERT_TRUE(view.Parse(drm->pssh()));
+    EXPECT_EQ(std::vector<uint8_t>(view.system_id(),
+                                   view.system_id() + kPsshSystemIdSize),
+              drm->system_id());
+    ASSERT_EQ(view.kid_count(), 1u);
+    EXPECT_TRUE(view.HasKid(drm->kid()));
+  }
+
+  // Rebuilding hits the cache.
+  ASSERT_TRUE(drm_list.BuildPsshBoxes(&builder));
+  EXPECT_EQ(builder.hits(), 600u);
+
+  // IDs that are not 16 bytes long fail the whole batch.
+  std::unique_ptr<DRMSystem> drm = absl::make_unique<DRMSystem>();
+  drm->set_system_id(HexStringToBytes(kGoodGUID));
+  drm->set_key_id({1, 2, 3});
+  ASSERT_TRUE(drm_list.AddDRMSystem(std::move(drm)));
+  PsshBuilder other;
+  EXPECT_FALSE(drm_list.BuildPsshBoxes(&other));
+  EXPECT_EQ(other.misses(), 0u);
+  // The boxes built before are kept.
+  PsshBoxView view;
+  EXPECT_TRUE(view.Parse(drms.front()->pssh()));
+}
+
 }  // namespace
 }  // namespace cpix
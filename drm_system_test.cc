@@ -120,5 +120,46 @@ TEST(DRMSystemTest, DeserializeDRMSystem) {
   EXPECT_TRUE(drm.hds_signaling_data().empty());
 }
 
+TEST(DRMSystemTest, PassesPayloadsThrough) {
+  TestableCPIXElement<DRMSystem> drm;
+  std::unique_ptr<XMLNode> node = absl::make_unique<XMLNode>(
+      "<DRMSystem kid=\"bd5adf51-cf04-410f-aac3-ec63a69e929e\" "
+      "systemId=\"edef8ba9-79d6-4ace-a3c8-27dcd51d21ed\">"
+      "<PSSH>AAAA\nAAAA</PSSH></DRMSystem>");
+  ASSERT_TRUE(drm.Deserialize(std::move(node)));
+  // Re-emitted as read, without decoding.
+  EXPECT_EQ(drm.Serialize(),
+            "<DRMSystem kid=\"bd5adf51-cf04-410f-aac3-ec63a69e929e\" "
+            "systemId=\"edef8ba9-79d6-4ace-a3c8-27dcd51d21ed\">"
+            "<PSSH>AAAA\nAAAA</PSSH></DRMSystem>");
+  EXPECT_EQ(drm.pssh(), std::vector<uint8_t>(6, 0));
+}
+
+TEST(DRMSystemTest, SharesPayloads) {
+  TestableCPIXElement<DRMSystem> first;
+  std::unique_ptr<XMLNode> node = absl::make_unique<XMLNode>(kGoodXML);
+  ASSERT_TRUE(first.Deserialize(std::move(node)));
+  TestableCPIXElement<DRMSystem> second;
+  node = absl::make_unique<XMLNode>(kGoodXML);
+  ASSERT_TRUE(second.Deserialize(std::move(node)));
+  EXPECT_EQ(&first.content_protection_data(),
+            &second.content_protection_data());
+
+  DRMSystem third;
+  third.set_content_protection_data(first.content_protection_data());
+  DRMSystem fourth;
+  fourth.set_content_protection_data(first.content_protection_data());
+  EXPECT_EQ(&third.content_protection_data(),
+            &fourth.content_protection_data());
+
+  // The HLS signaling elements are optional.
+  TestableCPIXElement<DRMSystem> sparse;
+  node = absl::make_unique<XMLNode>(
+      "<DRMSystem kid=\"bd5adf51-cf04-410f-aac3-ec63a69e929e\" "
+      "systemId=\"edef8ba9-79d6-4ace-a3c8-27dcd51d21ed\"/>");
+  ASSERT_TRUE(sparse.Deserialize(std::move(node)));
+  EXPECT_TRUE(sparse.hls_signaling_master().empty());
+}
+
 }  // namespace
 }  // namespace cpix
@@ -0,0 +1,184 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace cpix {
+namespace {
+
+// The pool and queue the calling thread works for, if it is a pool worker.
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+// Progress of one ParallelFor call, shared with the tasks it schedules. Tasks
+// that start after every range is taken return without touching |fn|.
+struct ParallelForState {
+  const std::function<void(size_t, size_t)>* fn;
+  size_t count;
+  size_t range_size;
+  size_t ranges;
+  std::atomic<size_t> next_range{0};
+  std::atomic<size_t> ranges_done{0};
+  std::mutex mutex;
+  std::condition_variable done;
+
+  // Runs ranges until none are left.
+  void Work() {
+    size_t range;
+    while ((range = next_range.fetch_add(1)) < ranges) {
+      size_t begin = range * range_size;
+      (*fn)(begin, std::min(count, begin + range_size));
+      if (ranges_done.fetch_add(1) + 1 == ranges) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+      }
+    }
+  }
+};
+
+}  // namespace
+
+Executor::~Executor() = default;
+
+WorkStealingPool::WorkStealingPool(size_t num_threads) : next_queue_(0) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  for (size_t i = 0; i < num_threads; i++) {
+    queues_.push_back(absl::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < num_threads; i++) {
+    workers_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkStealingPool::Schedule(std::function<void()> task) {
+  size_t index = current_pool == this
+                     ? current_queue
+                     : next_queue_.fetch_add(1) % queues_.size();
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_++;
+  }
+  wake_.notify_one();
+}
+
+bool WorkStealingPool::PopOrSteal(size_t index,
+                                  std::function<void()>* task) {
+  {
+    Queue& own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); i++) {
+    Queue& victim = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::WorkerLoop(size_t index) {
+  current_pool = this;
+  current_queue = index;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this]() { return pending_ > 0 || stopping_; });
+      if (pending_ == 0) {
+        return;
+      }
+      pending_--;
+    }
+    // Every unit of |pending_| stands for a task already queued, so the task
+    // reserved above is in some queue even if another worker took the one
+    // this worker would have found first.
+    std::function<void()> task;
+    while (!PopOrSteal(index, &task)) {
+      std::this_thread::yield();
+    }
+    task();
+  }
+}
+
+Executor* DefaultExecutor() {
+  static Executor* executor =
+      new WorkStealingPool(std::thread::hardware_concurrency());
+  return executor;
+}
+
+void ParallelFor(Executor* executor, size_t count, size_t grain,
+                 const std::function<void(size_t begin, size_t end)>& fn) {
+  grain = std::max<size_t>(grain, 1);
+  if (!executor || count <= grain || executor->concurrency() < 2) {
+    if (count > 0) {
+      fn(0, count);
+    }
+    return;
+  }
+
+  auto state = std::make_shared<ParallelForState>();
+  state->fn = &fn;
+  state->count = count;
+  // A few ranges per thread balance uneven work without many tiny tasks.
+  size_t target_ranges = executor->concurrency() * 4;
+  state->range_size =
+      std::max(grain, (count + target_ranges - 1) / target_ranges);
+  state->ranges = (count + state->range_size - 1) / state->range_size;
+
+  size_t helpers = std::min(state->ranges, executor->concurrency()) - 1;
+  for (size_t i = 0; i < helpers; i++) {
+    executor->Schedule([state]() { state->Work(); });
+  }
+  state->Work();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done.wait(lock, [&state]() {
+    return state->ranges_done.load() == state->ranges;
+  });
+}
+
+}  // namespace cpix
@@ -0,0 +1,94 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_EXECUTOR_H_
+#define CPIX_CC_EXECUTOR_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpix {
+
+// Executor runs tasks, possibly on other threads. Callers may implement it to
+// run CPIX work on their own thread pools.
+class Executor {
+ public:
+  virtual ~Executor();
+
+  // Runs |task| once, at some later point.
+  virtual void Schedule(std::function<void()> task) = 0;
+
+  // The number of tasks that may run at the same time.
+  virtual size_t concurrency() const = 0;
+};
+
+// A fixed set of worker threads, each with its own task queue. Tasks scheduled
+// from a worker go to that worker's queue and are run newest first; idle
+// workers steal the oldest tasks from other queues. Pending tasks are run
+// before the pool is destroyed.
+class WorkStealingPool : public Executor {
+ public:
+  explicit WorkStealingPool(size_t num_threads);
+  ~WorkStealingPool() override;
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  void Schedule(std::function<void()> task) override;
+  size_t concurrency() const override { return workers_.size(); }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void WorkerLoop(size_t index);
+
+  // Takes a task from queue |index|, or steals one from another queue.
+  // Returns false if every queue is empty.
+  bool PopOrSteal(size_t index, std::function<void()>* task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_queue_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  // Tasks scheduled but not yet taken by a worker.
+  size_t pending_ = 0;
+  bool stopping_ = false;
+};
+
+// Returns a process-wide WorkStealingPool with one thread per core.
+Executor* DefaultExecutor();
+
+// Calls |fn|(begin, end) on consecutive ranges that together cover
+// [0, |count|), spreading them over |executor|, and returns once every range is
+// done. Ranges are at least |grain| long, so work smaller than |grain| runs
+// inline, as does all work when |executor| is null. The calling thread takes
+// ranges too, so ParallelFor may be nested inside tasks of the same executor.
+void ParallelFor(Executor* executor, size_t count, size_t grain,
+                 const std::function<void(size_t begin, size_t end)>& fn);
+
+}  // namespace cpix
+#endif  // CPIX_CC_EXECUTOR_H_
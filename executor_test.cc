@@ -0,0 +1,111 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "executor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+TEST(WorkStealingPoolTest, RunsEveryTask) {
+  std::atomic<int> runs(0);
+  {
+    WorkStealingPool pool(4);
+    EXPECT_EQ(pool.concurrency(), 4);
+    for (int i = 0; i < 1000; i++) {
+      pool.Schedule([&runs]() { runs++; });
+    }
+  }
+  // Destroying the pool runs whatever was still pending.
+  EXPECT_EQ(runs.load(), 1000);
+}
+
+TEST(WorkStealingPoolTest, TasksMayScheduleTasks) {
+  std::atomic<int> runs(0);
+  {
+    WorkStealingPool pool(3);
+    for (int i = 0; i < 10; i++) {
+      pool.Schedule([&pool, &runs]() {
+        for (int j = 0; j < 10; j++) {
+          pool.Schedule([&runs]() { runs++; });
+        }
+      });
+    }
+    while (runs.load() < 100) {
+    }
+  }
+  EXPECT_EQ(runs.load(), 100);
+}
+
+TEST(ParallelForTest, CoversEveryIndexOnce) {
+  WorkStealingPool pool(4);
+  for (size_t count : {0, 1, 7, 100, 1000, 12345}) {
+    for (size_t grain : {1, 16, 5000}) {
+      std::vector<std::atomic<int>> hits(count);
+      ParallelFor(&pool, count, grain, [&hits](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          hits[i]++;
+        }
+      });
+      for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(hits[i].load(), 1) << count << " " << grain << " " << i;
+      }
+    }
+  }
+}
+
+TEST(ParallelForTest, RunsInlineWithoutExecutor) {
+  size_t calls = 0;
+  ParallelFor(nullptr, 1000, 1, [&calls](size_t begin, size_t end) {
+    EXPECT_EQ(begin, 0);
+    EXPECT_EQ(end, 1000);
+    calls++;
+  });
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(ParallelForTest, Nests) {
+  // Every worker blocks in an inner ParallelFor; the callers run the inner
+  // ranges themselves, so this cannot deadlock.
+  WorkStealingPool pool(2);
+  std::atomic<size_t> total(0);
+  ParallelFor(&pool, 64, 1, [&pool, &total](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      ParallelFor(&pool, 100, 10, [&total](size_t inner_begin,
+                                           size_t inner_end) {
+        total += inner_end - inner_begin;
+      });
+    }
+  });
+  EXPECT_EQ(total.load(), 6400);
+}
+
+TEST(ParallelForTest, DefaultExecutor) {
+  Executor* executor = DefaultExecutor();
+  ASSERT_NE(executor, nullptr);
+  EXPECT_EQ(executor, DefaultExecutor());
+  std::atomic<size_t> total(0);
+  ParallelFor(executor, 10000, 100, [&total](size_t begin, size_t end) {
+    total += end - begin;
+  });
+  EXPECT_EQ(total.load(), 10000);
+}
+
+}  // namespace
+}  // namespace cpix
@@ -0,0 +1,132 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_INTERN_TABLE_H_
+#define CPIX_CC_INTERN_TABLE_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <mutex>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+
+namespace cpix {
+
+// A table of immutable values of type T interned by a string key, such as
+// their bytes or text. Interning a key returns the live value with that key,
+// shared by reference count, and a value is dropped from the table when its
+// last holder releases it, so the table only holds values in use. Documents
+// are deserialized in parallel, so the table is split into shards with a lock
+// each. A table must outlive its values, and may be used from any number of
+// threads.
+template <typename T>
+class InternTable {
+ public:
+  // |key_of| returns the key of a value, which must point into the value and
+  // stay the same for its lifetime.
+  explicit InternTable(absl::string_view (*key_of)(const T&))
+      : key_of_(key_of) {}
+
+  InternTable(const InternTable&) = delete;
+  InternTable& operator=(const InternTable&) = delete;
+
+  // Returns the live value with |key|, or else interns and returns the value
+  // |make|() allocates with new, which must have |key| as its key.
+  template <typename Make>
+  std::shared_ptr<const T> Intern(absl::string_view key, const Make& make);
+
+  // Returns the number of live values in the table.
+  size_t size() const;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+
+  struct Entry {
+    // Identifies the value the entry was made for, even once it has expired.
+    const T* value;
+    std::weak_ptr<const T> weak;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    // Keyed by the key of each value, which outlives the entry.
+    absl::flat_hash_map<absl::string_view, Entry> values;
+  };
+
+  Shard& GetShard(absl::string_view key) {
+    return shards_[absl::Hash<absl::string_view>()(key) % kShardCount];
+  }
+
+  // Deleter of interned values: drops |value| from the table, unless it has
+  // been replaced there already, and deletes it.
+  void Release(const T* value);
+
+  absl::string_view (*const key_of_)(const T&);
+  Shard shards_[kShardCount];
+};
+
+template <typename T>
+constexpr size_t InternTable<T>::kShardCount;
+
+template <typename T>
+template <typename Make>
+std::shared_ptr<const T> InternTable<T>::Intern(absl::string_view key,
+                                                const Make& make) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto found = shard.values.find(key);
+  if (found != shard.values.end()) {
+    std::shared_ptr<const T> value = found->second.weak.lock();
+    if (value) {
+      return value;
+    }
+    // The value is being released. Its key points into it, so replace the
+    // entry rather than its value.
+    shard.values.erase(found);
+  }
+  std::shared_ptr<const T> value(
+      make(), [this](const T* value) { Release(value); });
+  shard.values.emplace(key_of_(*value), Entry{value.get(), value});
+  return value;
+}
+
+template <typename T>
+size_t InternTable<T>::size() const {
+  size_t count = 0;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    count += shard.values.size();
+  }
+  return count;
+}
+
+template <typename T>
+void InternTable<T>::Release(const T* value) {
+  {
+    absl::string_view key = key_of_(*value);
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.values.find(key);
+    if (found != shard.values.end() && found->second.value == value) {
+      shard.values.erase(found);
+    }
+  }
+  delete value;
+}
+
+}  // namespace cpix
+#endif  // CPIX_CC_INTERN_TABLE_H_
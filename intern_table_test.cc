@@ -0,0 +1,81 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "intern_table.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+absl::string_view KeyOf(const std::string& value) { return value; }
+
+std::shared_ptr<const std::string> Intern(InternTable<std::string>* table,
+                                          const std::string& key) {
+  return table->Intern(key, [&key]() { return new std::string(key); });
+}
+
+TEST(InternTableTest, InternsByKey) {
+  InternTable<std::string> table(&KeyOf);
+  std::shared_ptr<const std::string> value = Intern(&table, "a");
+  EXPECT_EQ(*value, "a");
+  EXPECT_EQ(Intern(&table, "a"), value);
+  EXPECT_NE(Intern(&table, "b"), value);
+  EXPECT_EQ(table.size(), 1);
+
+  // A value stays interned while any holder has it.
+  std::shared_ptr<const std::string> copy = value;
+  value.reset();
+  EXPECT_EQ(Intern(&table, "a"), copy);
+  copy.reset();
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_EQ(*Intern(&table, "a"), "a");
+}
+
+TEST(InternTableTest, TablesAreIndependent) {
+  InternTable<std::string> first(&KeyOf);
+  InternTable<std::string> second(&KeyOf);
+  std::shared_ptr<const std::string> value = Intern(&first, "a");
+  EXPECT_NE(Intern(&second, "a"), value);
+  EXPECT_EQ(first.size(), 1);
+  EXPECT_EQ(second.size(), 0);
+}
+
+TEST(InternTableTest, InternsConcurrently) {
+  InternTable<std::string> table(&KeyOf);
+  std::shared_ptr<const std::string> kept = Intern(&table, "kept");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&table, &kept]() {
+      for (int j = 0; j < 1000; j++) {
+        EXPECT_EQ(Intern(&table, "kept"), kept);
+        std::string key = std::to_string(j % 4);
+        EXPECT_EQ(*Intern(&table, key), key);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(table.size(), 1);
+}
+
+}  // namespace
+}  // namespace cpix
@@ -16,13 +16,35 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/numbers.h"
+#include "cpix_util.h"
 #include "glog/logging.h"
 #include "xml_node.h"
 
 namespace cpix {
+namespace {
+
+// Reads the xs:dateTime |value| into |micros| and rewrites it in canonical
+// form, in UTC if it had a timezone.
+bool NormalizeTime(std::string* value, int64_t* micros) {
+  bool has_timezone;
+  if (!DecodeDateTime(value->data(), value->size(), micros, &has_timezone)) {
+    return false;
+  }
+  char normalized[kMaxDateTimeStringSize];
+  size_t size = EncodeDateTime(*micros, has_timezone, normalized);
+  if (size == 0) {
+    return false;
+  }
+  value->assign(normalized, size);
+  return true;
+}
+
+}  // namespace
+
 KeyPeriod::~KeyPeriod() = default;
 
 void KeyPeriod::SetIndex(int index) {
@@ -31,13 +53,25 @@ void KeyPeriod::SetIndex(int index) {
   index_ = index;
 }
 
-void KeyPeriod::SetInterval(const std::string& start, const std::string& end) {
+bool KeyPeriod::SetInterval(const std::string& start, const std::string& end) {
+  std::string normalized_start = start;
+  std::string normalized_end = end;
+  int64_t start_time, end_time;
+  if (!NormalizeTime(&normalized_start, &start_time) ||
+      !NormalizeTime(&normalized_end, &end_time) || end_time < start_time) {
+    LOG(WARNING) << "Invalid KeyPeriod interval " << start << " to " << end
+                 << ". Interval not set.";
+    return false;
+  }
   index_ = -1;
-  start_ = start;
-  end_ = end;
+  start_ = std::move(normalized_start);
+  end_ = std::move(normalized_end);
+  start_time_ = start_time;
+  end_time_ = end_time;
+  return true;
 }
 
-std::unique_ptr<XMLNode> KeyPeriod::GetNode() {
+std::unique_ptr<XMLNode> KeyPeriod::GetNode() const {
   if ((index_ != -1 && !(start_.empty() && end_.empty())) ||
       (index_ == -1 && (start_.empty() || end_.empty()))) {
     return nullptr;
@@ -52,8 +86,6 @@ std::unique_ptr<XMLNode> KeyPeriod::GetNode() {
   if (index_ != -1) {
     root->AddAttribute("index", std::to_string(index_));
   } else {
-    // Assumes start/end string in proper xs:dateTime format which is not
-    // currently checked.
     root->AddAttribute("start", start_);
     root->AddAttribute("end", end_);
   }
@@ -62,6 +94,11 @@ std::unique_ptr<XMLNode> KeyPeriod::GetNode() {
 }
 
 bool KeyPeriod::Deserialize(std::unique_ptr<XMLNode> node) {
+  std::string attribute;
+  if (!(attribute = node->GetAttribute("id")).empty()) {
+    set_id(attribute);
+  }
+
   if (!node->GetAttribute("index").empty()) {
     int index;
     if (!absl::SimpleAtoi(node->GetAttribute("index"), &index)) {
@@ -73,7 +110,10 @@ bool KeyPeriod::Deserialize(std::unique_ptr<XMLNode> node) {
   }
   if (!node->GetAttribute("start").empty() &&
       !node->GetAttribute("end").empty()) {
-    SetInterval(node->GetAttribute("start"), node->GetAttribute("end"));
+    if (!SetInterval(node->GetAttribute("start"), node->GetAttribute("end"))) {
+      LOG(ERROR) << "Invalid KeyPeriod. Not added to document\n";
+      return false;
+    }
     return true;
   }
   LOG(ERROR) << "Invalid KeyPeriod. Not added to document\n";
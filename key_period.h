@@ -15,6 +15,8 @@
 #ifndef CPIX_CC_KEY_PERIOD_H_
 #define CPIX_CC_KEY_PERIOD_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 
@@ -35,19 +37,37 @@ class KeyPeriod : public CPIXElement {
   void SetIndex(int index);
 
   // Requires time strings in xs:dateTime format
-  // "CCYY-MM-DDThh:mm:ss[Z|(+|-)hh:mm".
-  void SetInterval(const std::string& start, const std::string& end);
+  // "CCYY-MM-DDThh:mm:ss[.s+][Z|(+|-)hh:mm]". Returns false, leaving the
+  // period unchanged, if either is malformed or |end| is before |start|. The
+  // times are kept in canonical form, converted to UTC if they have a
+  // timezone.
+  bool SetInterval(const std::string& start, const std::string& end);
+
+  // Returns the index of the period, or -1 if it is an interval.
+  int index() const { return index_; }
+  const std::string& start() const { return start_; }
+  const std::string& end() const { return end_; }
+
+  // Returns true if the period is an interval.
+  bool has_time_interval() const { return index_ == -1 && !start_.empty(); }
+
+  // The interval in microseconds since the Unix epoch, UTC. Times without a
+  // timezone are taken as UTC. Only meaningful if has_time_interval().
+  int64_t start_time() const { return start_time_; }
+  int64_t end_time() const { return end_time_; }
 
  protected:
   bool Deserialize(std::unique_ptr<XMLNode> node) override;
 
  private:
   friend class ContentKeyList;
-  std::unique_ptr<XMLNode> GetNode() override;
+  std::unique_ptr<XMLNode> GetNode() const override;
 
   int index_ = -1;
   std::string start_;
   std::string end_;
+  int64_t start_time_ = 0;
+  int64_t end_time_ = 0;
 };
 }  // namespace cpix
 
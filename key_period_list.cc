@@ -14,11 +14,16 @@
 
 #include "key_period_list.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <utility>
 
-#include "absl/memory/memory.h"
+#include "absl/container/flat_hash_set.h"
 #include "cpix_element.h"
 #include "key_period.h"
+#include "xml_node.h"
 
 namespace cpix {
 
@@ -26,11 +31,175 @@ KeyPeriodList::~KeyPeriodList() = default;
 
 bool KeyPeriodList::AddKeyPeriod(std::unique_ptr<KeyPeriod> key_period) {
   AddElement(std::move(key_period));
+  IndexPeriods(elements_.size() - 1);
   return true;
 }
 
-std::unique_ptr<CPIXElement> KeyPeriodList::CreateElement() {
-  return absl::make_unique<KeyPeriod>();
+const KeyPeriod* KeyPeriodList::FindPeriodAt(int64_t time) const {
+  if (by_time_.empty()) {
+    return nullptr;
+  }
+  auto after = std::upper_bound(
+      by_time_.begin(), by_time_.end(), time,
+      [](int64_t time, const TimeEntry& entry) { return time < entry.start; });
+  // Every entry before |after| starts at or before |time|.
+  int64_t found = FindLastEndingAfter(1, 0, end_leaves_,
+                                      after - by_time_.begin(), time);
+  return found == -1 ? nullptr : by_time_[found].period;
+}
+
+int64_t KeyPeriodList::FindLastEndingAfter(size_t node, size_t low,
+                                           size_t high, size_t limit,
+                                           int64_t time) const {
+  if (low >= limit || end_tree_[node] <= time) {
+    return -1;
+  }
+  if (high - low == 1) {
+    return low;
+  }
+  // A subtree that lies before |limit| and ends after |time| always holds a
+  // match, so only O(log n) nodes are visited.
+  size_t middle = low + (high - low) / 2;
+  int64_t found = FindLastEndingAfter(2 * node + 1, middle, high, limit, time);
+  if (found != -1) {
+    return found;
+  }
+  return FindLastEndingAfter(2 * node, low, middle, limit, time);
+}
+
+const KeyPeriod* KeyPeriodList::FindPeriodByIndex(int index) const {
+  auto entry = std::lower_bound(
+      by_index_.begin(), by_index_.end(), index,
+      [](const std::pair<int, const KeyPeriod*>& entry, int index) {
+        return entry.first < index;
+      });
+  if (entry == by_index_.end() || entry->first != index) {
+    return nullptr;
+  }
+  return entry->second;
+}
+
+size_t KeyPeriodList::RemoveKeyPeriods(
+    const std::function<bool(const KeyPeriod&)>& remove) {
+  absl::flat_hash_set<const KeyPeriod*> removed;
+  RemoveElements([&remove, &removed](const KeyPeriod& period) {
+    if (!remove(period)) {
+      return false;
+    }
+    removed.insert(&period);
+    return true;
+  });
+  if (removed.empty()) {
+    return 0;
+  }
+
+  // Periods usually expire oldest first, so only the entries from the first
+  // removed one onwards move.
+  const size_t old_size = by_time_.size();
+  auto first_removed = std::find_if(
+      by_time_.begin(), by_time_.end(), [&removed](const TimeEntry& entry) {
+        return removed.count(entry.period) > 0;
+      });
+  size_t changed = first_removed - by_time_.begin();
+  by_time_.erase(std::remove_if(first_removed, by_time_.end(),
+                                [&removed](const TimeEntry& entry) {
+                                  return removed.count(entry.period) > 0;
+                                }),
+                 by_time_.end());
+  UpdateEndTree(changed, old_size);
+  by_index_.erase(
+      std::remove_if(by_index_.begin(), by_index_.end(),
+                     [&removed](const std::pair<int, const KeyPeriod*>& entry) {
+                       return removed.count(entry.second) > 0;
+                     }),
+      by_index_.end());
+  return removed.size();
+}
+
+bool KeyPeriodList::Deserialize(std::unique_ptr<XMLNode> node) {
+  size_t first = elements_.size();
+  bool result = CPIXElementList<KeyPeriod>::Deserialize(std::move(node));
+  IndexPeriods(first);
+  return result;
+}
+
+void KeyPeriodList::IndexPeriods(size_t first) {
+  size_t old_times = by_time_.size();
+  size_t old_indexes = by_index_.size();
+  for (size_t i = first; i < elements_.size(); i++) {
+    const KeyPeriod* period = elements_[i];
+    if (period->has_time_interval()) {
+      by_time_.push_back(
+          {period->start_time(), period->end_time(), period});
+    } else if (period->index() != -1) {
+      by_index_.emplace_back(period->index(), period);
+    }
+  }
+
+  // New periods usually come after the existing ones, in which case nothing
+  // needs to move. Otherwise only the tail they land in is merged. Sorts and
+  // merges are stable, so among equal keys the period added first stays
+  // first.
+  auto by_start = [](const TimeEntry& a, const TimeEntry& b) {
+    return a.start < b.start;
+  };
+  std::stable_sort(by_time_.begin() + old_times, by_time_.end(), by_start);
+  // Entries before |changed| keep their place.
+  size_t changed = old_times;
+  if (old_times > 0 && old_times < by_time_.size() &&
+      by_time_[old_times].start < by_time_[old_times - 1].start) {
+    changed = std::upper_bound(by_time_.begin(), by_time_.begin() + old_times,
+                               by_time_[old_times], by_start) -
+              by_time_.begin();
+    std::inplace_merge(by_time_.begin() + changed,
+                       by_time_.begin() + old_times, by_time_.end(),
+                       by_start);
+  }
+  UpdateEndTree(changed, old_times);
+
+  auto by_index = [](const std::pair<int, const KeyPeriod*>& a,
+                     const std::pair<int, const KeyPeriod*>& b) {
+    return a.first < b.first;
+  };
+  std::stable_sort(by_index_.begin() + old_indexes, by_index_.end(),
+                   by_index);
+  if (old_indexes > 0 && old_indexes < by_index_.size() &&
+      by_index_[old_indexes].first < by_index_[old_indexes - 1].first) {
+    std::inplace_merge(
+        std::upper_bound(by_index_.begin(), by_index_.begin() + old_indexes,
+                         by_index_[old_indexes], by_index),
+        by_index_.begin() + old_indexes, by_index_.end(), by_index);
+  }
+}
+
+void KeyPeriodList::UpdateEndTree(size_t first, size_t old_size) {
+  constexpr int64_t kNoEnd = std::numeric_limits<int64_t>::min();
+  if (by_time_.size() > end_leaves_) {
+    // Grows the tree to the next power of two, and fills all of it.
+    end_leaves_ = std::max<size_t>(end_leaves_, 1);
+    while (end_leaves_ < by_time_.size()) {
+      end_leaves_ *= 2;
+    }
+    end_tree_.assign(2 * end_leaves_, kNoEnd);
+    first = 0;
+  }
+
+  // Leaves from |first| to the larger of the old and new sizes change, and
+  // with them the nodes above.
+  size_t last = std::max(old_size, by_time_.size());
+  if (first >= last) {
+    return;
+  }
+  for (size_t i = first; i < last; i++) {
+    end_tree_[end_leaves_ + i] = i < by_time_.size() ? by_time_[i].end : kNoEnd;
+  }
+  for (size_t low = (end_leaves_ + first) / 2,
+              high = (end_leaves_ + last - 1) / 2;
+       low > 0; low /= 2, high /= 2) {
+    for (size_t node = low; node <= high; node++) {
+      end_tree_[node] = std::max(end_tree_[2 * node], end_tree_[2 * node + 1]);
+    }
+  }
 }
 
 }  // namespace cpix
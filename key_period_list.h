@@ -15,22 +15,75 @@
 #ifndef CPIX_CC_KEY_PERIOD_LIST_H_
 #define CPIX_CC_KEY_PERIOD_LIST_H_
 
+#include <stdint.h>
+
+#include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "cpix_element.h"
 #include "cpix_element_list.h"
 #include "key_period.h"
 
 namespace cpix {
-class KeyPeriodList : public CPIXElementList {
+
+// The content key periods of a document. Besides the periods themselves, the
+// list keeps the periods sorted by start time and by index, so the period for
+// a media time can be found in logarithmic time even in live documents with
+// tens of thousands of periods. The indexes reflect the periods as they were
+// when added.
+class KeyPeriodList : public CPIXElementList<KeyPeriod> {
  public:
-  KeyPeriodList() : CPIXElementList("ContentKeyPeriodList") {}
+  KeyPeriodList() : CPIXElementList<KeyPeriod>("ContentKeyPeriodList") {}
   ~KeyPeriodList();
   bool AddKeyPeriod(std::unique_ptr<KeyPeriod> key_period);
 
+  // Returns the period whose interval [start, end) contains |time|, given in
+  // microseconds since the Unix epoch, or nullptr if there is none. If periods
+  // overlap, the one starting last is returned.
+  const KeyPeriod* FindPeriodAt(int64_t time) const;
+
+  // Returns the first period added with index |index|, or nullptr.
+  const KeyPeriod* FindPeriodByIndex(int index) const;
+
+  // Removes every period for which |remove| returns true and drops it from
+  // the indexes. Returns the number of periods removed.
+  size_t RemoveKeyPeriods(const std::function<bool(const KeyPeriod&)>& remove);
+
+ protected:
+  bool Deserialize(std::unique_ptr<XMLNode> node) override;
+
  private:
   friend class CPIXMessage;
-  std::unique_ptr<CPIXElement> CreateElement();
+
+  struct TimeEntry {
+    int64_t start;
+    int64_t end;
+    const KeyPeriod* period;
+  };
+
+  // Adds elements_[first] onwards to the indexes.
+  void IndexPeriods(size_t first);
+
+  // Updates the end tree after the entries from by_time_[first] onwards have
+  // changed, where there were |old_size| entries before.
+  void UpdateEndTree(size_t first, size_t old_size);
+
+  // Returns the position of the last entry before |limit| in by_time_ that
+  // ends after |time|, or -1, searching the subtree of end tree node |node|,
+  // which covers positions [low, high).
+  int64_t FindLastEndingAfter(size_t node, size_t low, size_t high,
+                              size_t limit, int64_t time) const;
+
+  std::vector<TimeEntry> by_time_;
+  // A max tree over the ends of by_time_: leaf i + end_leaves_ holds the end
+  // of entry i, and every other node the latest end below it. It finds the
+  // last period started by a time that is still running in O(log n), however
+  // the periods overlap.
+  size_t end_leaves_ = 0;
+  std::vector<int64_t> end_tree_;
+  std::vector<std::pair<int, const KeyPeriod*>> by_index_;
 };
 }  // namespace cpix
 
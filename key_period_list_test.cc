@@ -0,0 +1,161 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "key_period_list.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+#include "key_period.h"
+#include "testable_cpix_element.h"
+#include "xml_node.h"
+
+namespace cpix {
+namespace {
+
+constexpr int64_t kMicrosPerSecond = 1000000;
+
+constexpr char kGoodXML[] =
+    "<ContentKeyPeriodList>"
+    "<ContentKeyPeriod id=\"second\" start=\"2019-01-01T00:00:10Z\" "
+    "end=\"2019-01-01T00:00:20Z\"/>"
+    "<ContentKeyPeriod id=\"first\" start=\"2019-01-01T00:00:00Z\" "
+    "end=\"2019-01-01T00:00:10Z\"/>"
+    "<ContentKeyPeriod id=\"indexed\" index=\"7\"/>"
+    "</ContentKeyPeriodList>";
+
+// 2019-01-01T00:00:00Z.
+constexpr int64_t kStart = 1546300800 * kMicrosPerSecond;
+
+std::string Seconds(int seconds) {
+  return "2019-01-01T00:00:" + std::string(seconds < 10 ? "0" : "") +
+         std::to_string(seconds) + "Z";
+}
+
+std::unique_ptr<KeyPeriod> Interval(const std::string& id, int start,
+                                    int end) {
+  std::unique_ptr<KeyPeriod> period = absl::make_unique<KeyPeriod>();
+  period->set_id(id);
+  period->SetInterval(Seconds(start), Seconds(end));
+  return period;
+}
+
+std::unique_ptr<KeyPeriod> Indexed(const std::string& id, int index) {
+  std::unique_ptr<KeyPeriod> period = absl::make_unique<KeyPeriod>();
+  period->set_id(id);
+  period->SetIndex(index);
+  return period;
+}
+
+std::string IdAt(const KeyPeriodList& list, int64_t time) {
+  const KeyPeriod* period = list.FindPeriodAt(time);
+  return period ? period->id() : "";
+}
+
+TEST(KeyPeriodListTest, FindPeriodAt) {
+  KeyPeriodList list;
+  list.AddKeyPeriod(Interval("b", 10, 20));
+  list.AddKeyPeriod(Interval("a", 0, 10));
+  list.AddKeyPeriod(Interval("d", 30, 40));
+
+  EXPECT_EQ(IdAt(list, kStart - 1), "");
+  EXPECT_EQ(IdAt(list, kStart), "a");
+  EXPECT_EQ(IdAt(list, kStart + 10 * kMicrosPerSecond - 1), "a");
+  EXPECT_EQ(IdAt(list, kStart + 10 * kMicrosPerSecond), "b");
+  EXPECT_EQ(IdAt(list, kStart + 25 * kMicrosPerSecond), "");
+  EXPECT_EQ(IdAt(list, kStart + 39 * kMicrosPerSecond), "d");
+  EXPECT_EQ(IdAt(list, kStart + 40 * kMicrosPerSecond), "");
+}
+
+TEST(KeyPeriodListTest, FindPeriodAtOverlapping) {
+  KeyPeriodList list;
+  list.AddKeyPeriod(Interval("long", 0, 50));
+  list.AddKeyPeriod(Interval("short", 10, 20));
+
+  EXPECT_EQ(IdAt(list, kStart + 15 * kMicrosPerSecond), "short");
+  // Past the end of the later period, the earlier, longer one still applies.
+  EXPECT_EQ(IdAt(list, kStart + 30 * kMicrosPerSecond), "long");
+}
+
+TEST(KeyPeriodListTest, FindPeriodAtUnderLongPeriod) {
+  KeyPeriodList list;
+  list.AddKeyPeriod(Interval("long", 0, 59));
+  for (int second = 1; second < 57; second += 4) {
+    list.AddKeyPeriod(Interval(std::to_string(second), second, second + 2));
+  }
+
+  for (int second = 1; second < 57; second += 4) {
+    EXPECT_EQ(IdAt(list, kStart + second * kMicrosPerSecond),
+              std::to_string(second));
+    EXPECT_EQ(IdAt(list, kStart + (second + 2) * kMicrosPerSecond), "long");
+  }
+
+  list.RemoveKeyPeriods(
+      [](const KeyPeriod& period) { return period.id() == "long"; });
+  EXPECT_EQ(IdAt(list, kStart + 5 * kMicrosPerSecond), "5");
+  EXPECT_EQ(IdAt(list, kStart + 7 * kMicrosPerSecond), "");
+
+  list.RemoveKeyPeriods(
+      [](const KeyPeriod& period) { return period.id() != "53"; });
+  EXPECT_EQ(IdAt(list, kStart + 5 * kMicrosPerSecond), "");
+  EXPECT_EQ(IdAt(list, kStart + 54 * kMicrosPerSecond), "53");
+}
+
+TEST(KeyPeriodListTest, FindPeriodByIndex) {
+  KeyPeriodList list;
+  list.AddKeyPeriod(Indexed("five", 5));
+  list.AddKeyPeriod(Indexed("two", 2));
+  list.AddKeyPeriod(Indexed("other five", 5));
+  list.AddKeyPeriod(Interval("interval", 0, 10));
+
+  ASSERT_NE(list.FindPeriodByIndex(2), nullptr);
+  EXPECT_EQ(list.FindPeriodByIndex(2)->id(), "two");
+  ASSERT_NE(list.FindPeriodByIndex(5), nullptr);
+  EXPECT_EQ(list.FindPeriodByIndex(5)->id(), "five");
+  EXPECT_EQ(list.FindPeriodByIndex(3), nullptr);
+  EXPECT_EQ(list.FindPeriodByIndex(-1), nullptr);
+}
+
+TEST(KeyPeriodListTest, DeserializeBuildsIndexes) {
+  TestableCPIXElement<KeyPeriodList> list;
+  ASSERT_TRUE(list.Deserialize(absl::make_unique<XMLNode>(kGoodXML)));
+
+  EXPECT_EQ(IdAt(list, kStart + 5 * kMicrosPerSecond), "first");
+  EXPECT_EQ(IdAt(list, kStart + 15 * kMicrosPerSecond), "second");
+  ASSERT_NE(list.FindPeriodByIndex(7), nullptr);
+  EXPECT_EQ(list.FindPeriodByIndex(7)->id(), "indexed");
+}
+
+TEST(KeyPeriodListTest, ManyPeriods) {
+  KeyPeriodList list;
+  constexpr int kPeriods = 10000;
+  for (int i = 0; i < kPeriods; i++) {
+    std::unique_ptr<KeyPeriod> period = absl::make_unique<KeyPeriod>();
+    period->set_id(std::to_string(i));
+    period->SetIndex(i);
+    list.AddKeyPeriod(std::move(period));
+  }
+  for (int i = 0; i < kPeriods; i += 997) {
+    ASSERT_NE(list.FindPeriodByIndex(i), nullptr);
+    EXPECT_EQ(list.FindPeriodByIndex(i)->id(), std::to_string(i));
+  }
+  EXPECT_EQ(list.FindPeriodByIndex(kPeriods), nullptr);
+}
+
+}  // namespace
+}  // namespace cpix
@@ -14,6 +14,7 @@
 
 #include "key_period.h"
 
+#include <cstdint>
 #include <memory>
 #include <utility>
 
@@ -48,6 +49,34 @@ TEST(KeyPeriodTest, SerializeKeyPeriodInterval) {
   EXPECT_EQ(key_period.Serialize(), kGoodXMLInterval);
 }
 
+TEST(KeyPeriodTest, IntervalTimes) {
+  KeyPeriod key_period;
+  ASSERT_TRUE(key_period.SetInterval("1970-01-01T12:00:00",
+                                     "1970-01-01T13:30:00.5+01:00"));
+  ASSERT_TRUE(key_period.has_time_interval());
+  // Times with a timezone are normalized to UTC.
+  EXPECT_EQ(key_period.end(), "1970-01-01T12:30:00.5Z");
+  EXPECT_EQ(key_period.start_time(), int64_t{12 * 3600} * 1000000);
+  EXPECT_EQ(key_period.end_time(),
+            int64_t{12 * 3600 + 1800} * 1000000 + 500000);
+
+  EXPECT_FALSE(key_period.SetInterval("noon", "1970-01-01T13:00:00"));
+  EXPECT_FALSE(key_period.SetInterval("1970-01-01T13:00:00",
+                                      "1970-01-01T12:00:00"));
+  EXPECT_EQ(key_period.start(), "1970-01-01T12:00:00");
+
+  key_period.SetIndex(1);
+  EXPECT_FALSE(key_period.has_time_interval());
+  EXPECT_EQ(key_period.index(), 1);
+}
+
+TEST(KeyPeriodTest, DeserializeRejectsMalformedInterval) {
+  TestableCPIXElement<KeyPeriod> key_period;
+  EXPECT_FALSE(key_period.Deserialize(absl::make_unique<XMLNode>(
+      "<ContentKeyPeriod start=\"1970-02-30T12:00:00\" "
+      "end=\"1970-03-01T12:30:00\"/>")));
+}
+
 TEST(ContentKeyTest, DeserializeKeyPeriodIndex) {
   TestableCPIXElement<KeyPeriod> key_period;
   std::unique_ptr<XMLNode> node = absl::make_unique<XMLNode>(kGoodXMLIndex);
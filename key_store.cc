@@ -0,0 +1,112 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "key_store.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "key_table.h"
+
+namespace cpix {
+namespace {
+
+std::atomic<size_t> next_reader_shard(0);
+
+// Returns the shard used by the calling thread.
+size_t ReaderShardForCurrentThread() {
+  static thread_local size_t shard = next_reader_shard.fetch_add(1);
+  return shard;
+}
+
+}  // namespace
+
+constexpr size_t KeyStore::kReaderShards;
+
+KeyStore::Reader::Reader(const KeyStore& store) {
+  // The epoch is sampled before the increment and the table loaded after it.
+  // A writer that flipped the epoch in between either sees this increment
+  // while draining the old epoch or has already swapped in the new table, so
+  // the table loaded here is never freed while this reader holds it.
+  uint64_t epoch = store.epoch_.load();
+  ReaderShard& shard =
+      store.shards_[ReaderShardForCurrentThread() % kReaderShards];
+  counter_ = &shard.counters[epoch % 2];
+  counter_->fetch_add(1);
+  table_ = store.current_.load();
+}
+
+KeyStore::Reader::~Reader() { counter_->fetch_sub(1); }
+
+KeyStore::KeyStore() : current_(nullptr), epoch_(0) {
+  for (ReaderShard& shard : shards_) {
+    shard.counters[0].store(0);
+    shard.counters[1].store(0);
+  }
+}
+
+KeyStore::~KeyStore() = default;
+
+void KeyStore::WaitForReaders(uint64_t epoch) {
+  epoch_.store(epoch + 1);
+  for (const ReaderShard& shard : shards_) {
+    while (shard.counters[epoch % 2].load() != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool KeyStore::Publish(std::shared_ptr<const KeyTable> table) {
+  if (!table) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(publish_mutex_);
+  current_.store(table.get());
+  // Two epoch flips, as in sleepable RCU: a reader can sample the epoch just
+  // before one flip and increment its counter just after it, so it is only
+  // guaranteed to be drained by the second.
+  uint64_t epoch = epoch_.load();
+  WaitForReaders(epoch);
+  WaitForReaders(epoch + 1);
+  owned_ = std::move(table);
+  return true;
+}
+
+bool KeyStore::Lookup(const uint8_t* kid, Entry* entry) const {
+  Reader reader(*this);
+  const KeyTable* table = reader.table();
+  if (!table) {
+    return false;
+  }
+  size_t index = table->Find(kid);
+  if (index == KeyTable::kNotFound) {
+    return false;
+  }
+  entry->key_size = table->key_size(index);
+  memcpy(entry->key, table->key(index), entry->key_size);
+  const uint8_t* iv = table->iv(index);
+  entry->has_iv = iv != nullptr;
+  if (iv) {
+    memcpy(entry->iv, iv, KeyTable::kIVSize);
+  }
+  return true;
+}
+
+}  // namespace cpix
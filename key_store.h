@@ -0,0 +1,106 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_KEY_STORE_H_
+#define CPIX_CC_KEY_STORE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "key_table.h"
+
+namespace cpix {
+
+// KeyStore holds the KeyTable that readers currently use and lets a writer
+// replace it at any time, read-copy-update style. Readers never lock and never
+// wait: entering a read section is one counter increment and one pointer load.
+// Publishing swaps the pointer atomically and then waits, on the writer's
+// thread only, until every reader that might still see the old table has left
+// its read section before letting it go.
+//
+// Typical use has packager threads calling Lookup() per segment while a
+// control thread calls Publish(message.ExportKeyTable()) for each new key
+// period.
+class KeyStore {
+ public:
+  // A copy of one key, taken so callers never touch a table after their read
+  // section ends.
+  struct Entry {
+    uint8_t key[KeyTable::kMaxKeySize];
+    size_t key_size;
+    uint8_t iv[KeyTable::kIVSize];
+    bool has_iv;
+  };
+
+  // A read section. While a Reader is alive, the table it returns stays valid
+  // even if a new one is published. Readers should be short-lived, because a
+  // concurrent Publish() waits for them to finish; a thread must not publish
+  // while it holds a Reader of the same store.
+  class Reader {
+   public:
+    explicit Reader(const KeyStore& store);
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    // The current table when the Reader was created, or nullptr if nothing has
+    // been published yet.
+    const KeyTable* table() const { return table_; }
+
+   private:
+    std::atomic<int64_t>* counter_;
+    const KeyTable* table_;
+  };
+
+  KeyStore();
+  ~KeyStore();
+
+  KeyStore(const KeyStore&) = delete;
+  KeyStore& operator=(const KeyStore&) = delete;
+
+  // Makes |table| the current table. Returns once no reader can still observe
+  // the previous table. Returns false if |table| is null.
+  bool Publish(std::shared_ptr<const KeyTable> table);
+
+  // Copies the key with the 16-byte KID |kid| from the current table into
+  // |entry|. Returns false if there is no such key.
+  bool Lookup(const uint8_t* kid, Entry* entry) const;
+
+ private:
+  // Number of independent reader counter pairs. Threads are spread across
+  // them so readers on different cores rarely share a cache line.
+  static constexpr size_t kReaderShards = 32;
+
+  // Readers in the current epoch count themselves in counters[epoch % 2].
+  struct alignas(64) ReaderShard {
+    std::atomic<int64_t> counters[2];
+  };
+
+  // Flips the epoch and waits until readers of the previous epoch are done.
+  void WaitForReaders(uint64_t epoch);
+
+  std::atomic<const KeyTable*> current_;
+  std::atomic<uint64_t> epoch_;
+  mutable ReaderShard shards_[kReaderShards];
+
+  std::mutex publish_mutex_;
+  std::shared_ptr<const KeyTable> owned_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_KEY_STORE_H_
@@ -0,0 +1,116 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "key_store.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "content_key.h"
+#include "gtest/gtest.h"
+#include "key_table.h"
+
+namespace cpix {
+namespace {
+
+constexpr size_t kKeysPerTable = 64;
+
+std::vector<uint8_t> Kid(size_t index) {
+  std::vector<uint8_t> kid(16);
+  kid[15] = index;
+  return kid;
+}
+
+// Builds a table whose key values are all filled with |generation|, so that a
+// reader can tell whether it saw one consistent table.
+std::shared_ptr<const KeyTable> MakeTable(uint8_t generation) {
+  std::vector<std::unique_ptr<ContentKey>> keys;
+  std::vector<const ContentKey*> pointers;
+  for (size_t i = 0; i < kKeysPerTable; i++) {
+    keys.push_back(absl::make_unique<ContentKey>());
+    keys.back()->set_key_id(Kid(i));
+    keys.back()->SetKeyValue(std::vector<uint8_t>(16, generation));
+    pointers.push_back(keys.back().get());
+  }
+  return KeyTable::Create(pointers);
+}
+
+TEST(KeyStoreTest, EmptyStore) {
+  KeyStore store;
+  KeyStore::Entry entry;
+  EXPECT_FALSE(store.Lookup(Kid(0).data(), &entry));
+  KeyStore::Reader reader(store);
+  EXPECT_EQ(reader.table(), nullptr);
+  EXPECT_FALSE(store.Publish(nullptr));
+}
+
+TEST(KeyStoreTest, PublishReplacesTable) {
+  KeyStore store;
+  ASSERT_TRUE(store.Publish(MakeTable(1)));
+  KeyStore::Entry entry;
+  ASSERT_TRUE(store.Lookup(Kid(3).data(), &entry));
+  EXPECT_EQ(entry.key_size, 16);
+  EXPECT_EQ(entry.key[0], 1);
+  EXPECT_FALSE(entry.has_iv);
+  EXPECT_FALSE(store.Lookup(Kid(kKeysPerTable).data(), &entry));
+
+  ASSERT_TRUE(store.Publish(MakeTable(2)));
+  ASSERT_TRUE(store.Lookup(Kid(3).data(), &entry));
+  EXPECT_EQ(entry.key[0], 2);
+}
+
+TEST(KeyStoreTest, ReadersSeeConsistentTablesWhilePublishing) {
+  KeyStore store;
+  ASSERT_TRUE(store.Publish(MakeTable(0)));
+
+  std::atomic<bool> done(false);
+  std::atomic<bool> consistent(true);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&store, &done, &consistent]() {
+      uint8_t last_generation = 0;
+      while (!done.load()) {
+        KeyStore::Reader reader(store);
+        const KeyTable* table = reader.table();
+        uint8_t generation = *table->key(0);
+        // Tables are published in order, so a reader never goes back.
+        if (generation < last_generation) {
+          consistent.store(false);
+        }
+        last_generation = generation;
+        for (size_t i = 0; i < table->size(); i++) {
+          if (*table->key(i) != generation) {
+            consistent.store(false);
+          }
+        }
+      }
+    });
+  }
+
+  for (int generation = 1; generation < 100; generation++) {
+    ASSERT_TRUE(store.Publish(MakeTable(generation)));
+  }
+  done.store(true);
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  EXPECT_TRUE(consistent.load());
+}
+
+}  // namespace
+}  // namespace cpix
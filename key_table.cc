@@ -0,0 +1,133 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "key_table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "content_key.h"
+#include "glog/logging.h"
+#include "openssl/crypto.h"
+
+namespace cpix {
+
+constexpr size_t KeyTable::kKidSize;
+constexpr size_t KeyTable::kMaxKeySize;
+constexpr size_t KeyTable::kIVSize;
+constexpr size_t KeyTable::kNotFound;
+
+KeyTable::~KeyTable() { OPENSSL_cleanse(keys_.data(), keys_.size()); }
+
+KeyTable::Kid KeyTable::ReadKid(const uint8_t* kid) {
+  Kid result = {0, 0};
+  for (size_t i = 0; i < 8; i++) {
+    result.high = (result.high << 8) | kid[i];
+    result.low = (result.low << 8) | kid[8 + i];
+  }
+  return result;
+}
+
+std::shared_ptr<const KeyTable> KeyTable::Create(
+    const std::vector<const ContentKey*>& keys) {
+  for (const ContentKey* key : keys) {
+    if (key->is_encrypted()) {
+      LOG(ERROR) << "Content keys must be decrypted before export.";
+      return nullptr;
+    }
+    const std::vector<uint8_t>& iv = key->explicit_iv();
+    if (key->kid().size() != kKidSize ||
+        key->key_value().size() > kMaxKeySize ||
+        (!iv.empty() && iv.size() != kIVSize)) {
+      LOG(ERROR) << "Content key has an unsupported KID, value or IV size.";
+      return nullptr;
+    }
+  }
+
+  std::vector<const ContentKey*> sorted = keys;
+  std::sort(sorted.begin(), sorted.end(),
+            [](const ContentKey* a, const ContentKey* b) {
+              return memcmp(a->kid().data(), b->kid().data(), kKidSize) < 0;
+            });
+  for (size_t i = 1; i < sorted.size(); i++) {
+    if (sorted[i - 1]->kid() == sorted[i]->kid()) {
+      LOG(ERROR) << "Duplicate KID in content keys.";
+      return nullptr;
+    }
+  }
+
+  std::shared_ptr<KeyTable> table(new KeyTable);
+  table->kids_.reserve(sorted.size());
+  table->keys_.resize(sorted.size() * kMaxKeySize);
+  table->key_sizes_.reserve(sorted.size());
+  table->ivs_.resize(sorted.size() * kIVSize);
+  table->has_iv_.reserve(sorted.size());
+  for (size_t i = 0; i < sorted.size(); i++) {
+    const ContentKey* key = sorted[i];
+    table->kids_.push_back(ReadKid(key->kid().data()));
+    std::copy(key->key_value().begin(), key->key_value().end(),
+              table->keys_.begin() + i * kMaxKeySize);
+    table->key_sizes_.push_back(key->key_value().size());
+    std::copy(key->explicit_iv().begin(), key->explicit_iv().end(),
+              table->ivs_.begin() + i * kIVSize);
+    table->has_iv_.push_back(!key->explicit_iv().empty());
+  }
+  return table;
+}
+
+size_t KeyTable::Find(const uint8_t* kid) const {
+  if (kids_.empty()) {
+    return kNotFound;
+  }
+  const Kid target = ReadKid(kid);
+  auto less = [&target](const Kid& probe) {
+    return probe.high < target.high ||
+           (probe.high == target.high && probe.low < target.low);
+  };
+  // Branch-free lower bound: the range halves every step and the only choice,
+  // which half to keep, compiles to a conditional move.
+  const Kid* base = kids_.data();
+  size_t count = kids_.size();
+  while (count > 1) {
+    size_t half = count / 2;
+    base = less(base[half]) ? base + half : base;
+    count -= half;
+  }
+  base += less(*base);
+  if (base == kids_.data() + kids_.size() || base->high != target.high ||
+      base->low != target.low) {
+    return kNotFound;
+  }
+  return base - kids_.data();
+}
+
+size_t KeyTable::Find(const std::vector<uint8_t>& kid) const {
+  if (kid.size() != kKidSize) {
+    return kNotFound;
+  }
+  return Find(kid.data());
+}
+
+void KeyTable::GetKid(size_t index, uint8_t* kid) const {
+  for (size_t i = 0; i < 8; i++) {
+    kid[i] = kids_[index].high >> (56 - 8 * i);
+    kid[8 + i] = kids_[index].low >> (56 - 8 * i);
+  }
+}
+
+}  // namespace cpix
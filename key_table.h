@@ -0,0 +1,86 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_KEY_TABLE_H_
+#define CPIX_CC_KEY_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cpix {
+
+class ContentKey;
+
+// KeyTable is an immutable, flat lookup table of clear content keys, meant for
+// code that looks up a key per media segment. KIDs, key values and IVs live in
+// three separate arrays ordered by KID, and lookups are a binary search over
+// KIDs held as pairs of integers. Once created a KeyTable is never modified, so
+// it may be shared and read from any number of threads.
+class KeyTable {
+ public:
+  static constexpr size_t kKidSize = 16;
+  static constexpr size_t kMaxKeySize = 32;
+  static constexpr size_t kIVSize = 16;
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+  ~KeyTable();
+
+  KeyTable(const KeyTable&) = delete;
+  KeyTable& operator=(const KeyTable&) = delete;
+
+  // Builds a table from |keys|. Returns nullptr if a key is still encrypted,
+  // has a KID that is not 16 bytes or a value longer than 32 bytes, or if two
+  // keys share a KID.
+  static std::shared_ptr<const KeyTable> Create(
+      const std::vector<const ContentKey*>& keys);
+
+  // Returns the index of the key with the 16-byte KID |kid|, or kNotFound.
+  size_t Find(const uint8_t* kid) const;
+  size_t Find(const std::vector<uint8_t>& kid) const;
+
+  size_t size() const { return key_sizes_.size(); }
+
+  // Accessors for the key at |index|, which must be less than size(). Keys are
+  // ordered by KID. iv() returns nullptr if the key has no explicit IV.
+  void GetKid(size_t index, uint8_t* kid) const;
+  const uint8_t* key(size_t index) const {
+    return &keys_[index * kMaxKeySize];
+  }
+  size_t key_size(size_t index) const { return key_sizes_[index]; }
+  const uint8_t* iv(size_t index) const {
+    return has_iv_[index] ? &ivs_[index * kIVSize] : nullptr;
+  }
+
+ private:
+  // A KID read as a big-endian 128-bit number, so KIDs order like their bytes.
+  struct Kid {
+    uint64_t high;
+    uint64_t low;
+  };
+
+  KeyTable() = default;
+
+  static Kid ReadKid(const uint8_t* kid);
+
+  std::vector<Kid> kids_;
+  std::vector<uint8_t> keys_;
+  std::vector<uint8_t> key_sizes_;
+  std::vector<uint8_t> ivs_;
+  std::vector<bool> has_iv_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_KEY_TABLE_H_
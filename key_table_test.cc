@@ -0,0 +1,109 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "key_table.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "content_key.h"
+#include "cpix_util.h"
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+std::vector<std::unique_ptr<ContentKey>> MakeKeys(size_t count) {
+  std::vector<std::unique_ptr<ContentKey>> keys;
+  for (size_t i = 0; i < count; i++) {
+    std::unique_ptr<ContentKey> key = absl::make_unique<ContentKey>();
+    // Spread KIDs so that both halves of the 128-bit value matter.
+    std::vector<uint8_t> kid(16);
+    kid[0] = (i * 7919) % 251;
+    kid[15] = i % 256;
+    kid[14] = i / 256;
+    key->set_key_id(kid);
+    key->SetKeyValue(std::vector<uint8_t>(i % 2 ? 32 : 16, i % 256));
+    if (i % 3 == 0) {
+      key->set_explicit_iv(std::vector<uint8_t>(16, 0xa0 + i % 16));
+    }
+    keys.push_back(std::move(key));
+  }
+  return keys;
+}
+
+std::vector<const ContentKey*> Pointers(
+    const std::vector<std::unique_ptr<ContentKey>>& keys) {
+  std::vector<const ContentKey*> pointers;
+  for (const auto& key : keys) {
+    pointers.push_back(key.get());
+  }
+  return pointers;
+}
+
+TEST(KeyTableTest, FindsEveryKey) {
+  for (size_t count : {1, 2, 3, 17, 1000}) {
+    std::vector<std::unique_ptr<ContentKey>> keys = MakeKeys(count);
+    std::shared_ptr<const KeyTable> table = KeyTable::Create(Pointers(keys));
+    ASSERT_TRUE(table);
+    ASSERT_EQ(table->size(), count);
+    for (const auto& key : keys) {
+      size_t index = table->Find(key->kid());
+      ASSERT_NE(index, KeyTable::kNotFound);
+      uint8_t kid[KeyTable::kKidSize];
+      table->GetKid(index, kid);
+      EXPECT_EQ(std::vector<uint8_t>(kid, kid + sizeof(kid)), key->kid());
+      const uint8_t* value = table->key(index);
+      EXPECT_EQ(std::vector<uint8_t>(value, value + table->key_size(index)),
+                key->key_value());
+      if (key->explicit_iv().empty()) {
+        EXPECT_EQ(table->iv(index), nullptr);
+      } else {
+        EXPECT_EQ(std::vector<uint8_t>(table->iv(index),
+                                       table->iv(index) + KeyTable::kIVSize),
+                  key->explicit_iv());
+      }
+    }
+  }
+}
+
+TEST(KeyTableTest, MissingKids) {
+  std::vector<std::unique_ptr<ContentKey>> keys = MakeKeys(100);
+  std::shared_ptr<const KeyTable> table = KeyTable::Create(Pointers(keys));
+  ASSERT_TRUE(table);
+  EXPECT_EQ(table->Find(std::vector<uint8_t>(16, 0xff)), KeyTable::kNotFound);
+  EXPECT_EQ(table->Find(std::vector<uint8_t>(16, 0x01)), KeyTable::kNotFound);
+  EXPECT_EQ(table->Find(std::vector<uint8_t>(8)), KeyTable::kNotFound);
+
+  std::shared_ptr<const KeyTable> empty = KeyTable::Create({});
+  ASSERT_TRUE(empty);
+  EXPECT_EQ(empty->Find(keys[0]->kid()), KeyTable::kNotFound);
+}
+
+TEST(KeyTableTest, RejectsDuplicateKids) {
+  std::vector<std::unique_ptr<ContentKey>> keys = MakeKeys(10);
+  keys[7]->set_key_id(keys[2]->kid());
+  EXPECT_FALSE(KeyTable::Create(Pointers(keys)));
+}
+
+TEST(KeyTableTest, RejectsBadKids) {
+  std::vector<std::unique_ptr<ContentKey>> keys = MakeKeys(10);
+  keys[4]->set_key_id(std::vector<uint8_t>(8));
+  EXPECT_FALSE(KeyTable::Create(Pointers(keys)));
+}
+
+}  // namespace
+}  // namespace cpix
@@ -0,0 +1,40 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "label.h"
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "intern_table.h"
+
+namespace cpix {
+namespace {
+
+InternTable<std::string>& Labels() {
+  static InternTable<std::string>* const kLabels =
+      new InternTable<std::string>(
+          [](const std::string& text) { return absl::string_view(text); });
+  return *kLabels;
+}
+
+}  // namespace
+
+Label::Label(const std::string& text)
+    : text_(Labels().Intern(text,
+                            [&text]() { return new std::string(text); })) {}
+
+size_t Label::live_count() { return Labels().size(); }
+
+}  // namespace cpix
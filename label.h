@@ -0,0 +1,47 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_LABEL_H_
+#define CPIX_CC_LABEL_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+namespace cpix {
+
+// The label of a LabelFilter. Labels are interned by text: every Label in the
+// process with the same text shares one reference-counted string, so the many
+// rules of a document naming the same few labels hold each of them once, and
+// labels compare by identity. A string is dropped from the intern table when
+// its last Label is destroyed. Labels may be shared between threads.
+class Label {
+ public:
+  explicit Label(const std::string& text);
+
+  // Returns the number of distinct live labels in the process.
+  static size_t live_count();
+
+  const std::string& text() const { return *text_; }
+
+  bool operator==(const Label& other) const { return text_ == other.text_; }
+  bool operator!=(const Label& other) const { return text_ != other.text_; }
+
+ private:
+  std::shared_ptr<const std::string> text_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_LABEL_H_
@@ -0,0 +1,75 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "label.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+TEST(LabelTest, InternsByText) {
+  size_t live = Label::live_count();
+  Label label("HD-video");
+  EXPECT_EQ(label.text(), "HD-video");
+  EXPECT_EQ(Label("HD-video"), label);
+  EXPECT_EQ(&Label("HD-video").text(), &label.text());
+  EXPECT_NE(Label("SD-video"), label);
+  EXPECT_EQ(Label::live_count(), live + 1);
+
+  // Copies share the string, which goes once the last of them does.
+  {
+    Label copy = label;
+    EXPECT_EQ(&copy.text(), &label.text());
+  }
+  EXPECT_EQ(Label::live_count(), live + 1);
+}
+
+TEST(LabelTest, DropsUnusedLabels) {
+  size_t live = Label::live_count();
+  {
+    std::vector<Label> labels;
+    for (int i = 0; i < 100; i++) {
+      labels.emplace_back("label " + std::to_string(i % 10));
+    }
+    EXPECT_EQ(Label::live_count(), live + 10);
+  }
+  EXPECT_EQ(Label::live_count(), live);
+  EXPECT_EQ(Label("label 1").text(), "label 1");
+}
+
+TEST(LabelTest, InternsConcurrently) {
+  Label expected("shared");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&expected, i]() {
+      for (int j = 0; j < 1000; j++) {
+        EXPECT_EQ(Label("shared"), expected);
+        // Labels created and dropped by several threads at once.
+        Label transient("transient " + std::to_string(j % 4));
+        EXPECT_EQ(transient.text(), "transient " + std::to_string(j % 4));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+}  // namespace cpix
@@ -0,0 +1,260 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pssh.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "drm_blob.h"
+#include "glog/logging.h"
+
+namespace cpix {
+namespace {
+
+constexpr uint8_t kPsshType[] = {'p', 's', 's', 'h'};
+
+// Box header, full box header and system ID.
+constexpr size_t kPsshHeaderSize = 8 + 4 + kPsshSystemIdSize;
+
+uint32_t ReadUint32(const uint8_t* data) {
+  return (uint32_t{data[0]} << 24) | (uint32_t{data[1]} << 16) |
+         (uint32_t{data[2]} << 8) | uint32_t{data[3]};
+}
+
+void AppendUint32(uint32_t value, std::vector<uint8_t>* out) {
+  out->push_back(value >> 24);
+  out->push_back(value >> 16);
+  out->push_back(value >> 8);
+  out->push_back(value);
+}
+
+}  // namespace
+
+const uint8_t kCommonPsshSystemId[kPsshSystemIdSize] = {
+    0x10, 0x77, 0xef, 0xec, 0xc0, 0xb2, 0x4d, 0x02,
+    0xac, 0xe3, 0x3c, 0x1e, 0x52, 0xe2, 0xfb, 0x4b};
+const uint8_t kWidevineSystemId[kPsshSystemIdSize] = {
+    0xed, 0xef, 0x8b, 0xa9, 0x79, 0xd6, 0x4a, 0xce,
+    0xa3, 0xc8, 0x27, 0xdc, 0xd5, 0x1d, 0x21, 0xed};
+const uint8_t kPlayReadySystemId[kPsshSystemIdSize] = {
+    0x9a, 0x04, 0xf0, 0x79, 0x98, 0x40, 0x42, 0x86,
+    0xab, 0x92, 0xe6, 0x5b, 0xe0, 0x88, 0x5f, 0x95};
+const uint8_t kFairPlaySystemId[kPsshSystemIdSize] = {
+    0x94, 0xce, 0x86, 0xfb, 0x07, 0xff, 0x4f, 0x43,
+    0xad, 0xb8, 0x93, 0xd2, 0xfa, 0x96, 0x8c, 0xa2};
+
+std::vector<uint8_t> BuildPsshBox(int version,
+                                  const std::vector<uint8_t>& system_id,
+                                  const std::vector<std::vector<uint8_t>>& kids,
+                                  const std::vector<uint8_t>& data) {
+  if ((version != 0 && version != 1) ||
+      system_id.size() != kPsshSystemIdSize) {
+    return std::vector<uint8_t>();
+  }
+  uint64_t size = kPsshHeaderSize + 4 + uint64_t{data.size()};
+  if (version == 1) {
+    for (const std::vector<uint8_t>& kid : kids) {
+      if (kid.size() != kPsshKidSize) {
+        return std::vector<uint8_t>();
+      }
+    }
+    size += 4 + uint64_t{kids.size()} * kPsshKidSize;
+  }
+  if (size > std::numeric_limits<uint32_t>::max()) {
+    return std::vector<uint8_t>();
+  }
+
+  std::vector<uint8_t> box;
+  box.reserve(size);
+  AppendUint32(size, &box);
+  box.insert(box.end(), kPsshType, kPsshType + sizeof(kPsshType));
+  // Version, then 24 bits of flags, which are all zero.
+  AppendUint32(uint32_t(version) << 24, &box);
+  box.insert(box.end(), system_id.begin(), system_id.end());
+  if (version == 1) {
+    AppendUint32(kids.size(), &box);
+    for (const std::vector<uint8_t>& kid : kids) {
+      box.insert(box.end(), kid.begin(), kid.end());
+    }
+  }
+  AppendUint32(data.size(), &box);
+  box.insert(box.end(), data.begin(), data.end());
+  return box;
+}
+
+bool PsshBoxView::Parse(const uint8_t* data, size_t size) {
+  *this = PsshBoxView();
+  if (size < 8 || memcmp(data + 4, kPsshType, sizeof(kPsshType)) != 0) {
+    return false;
+  }
+  uint64_t box_size = ReadUint32(data);
+  size_t pos = 8;
+  if (box_size == 1) {
+    // A 64-bit size follows the type.
+    if (size < 16) {
+      return false;
+    }
+    box_size = (uint64_t{ReadUint32(data + 8)} << 32) | ReadUint32(data + 12);
+    pos = 16;
+  } else if (box_size == 0) {
+    // The box extends to the end of the buffer.
+    box_size = size;
+  }
+  if (box_size > size || box_size < pos + 4 + kPsshSystemIdSize) {
+    return false;
+  }
+  const size_t end = box_size;
+
+  const int version = data[pos];
+  if (version > 1) {
+    return false;
+  }
+  pos += 4;
+  const uint8_t* system_id = data + pos;
+  pos += kPsshSystemIdSize;
+
+  size_t kid_count = 0;
+  const uint8_t* kids = nullptr;
+  if (version == 1) {
+    if (end - pos < 4) {
+      return false;
+    }
+    kid_count = ReadUint32(data + pos);
+    pos += 4;
+    if (kid_count > (end - pos) / kPsshKidSize) {
+      return false;
+    }
+    kids = data + pos;
+    pos += kid_count * kPsshKidSize;
+  }
+
+  if (end - pos < 4) {
+    return false;
+  }
+  size_t data_size = ReadUint32(data + pos);
+  pos += 4;
+  if (data_size != end - pos) {
+    return false;
+  }
+
+  size_ = end;
+  version_ = version;
+  system_id_ = system_id;
+  kid_count_ = kid_count;
+  kids_ = kids;
+  data_ = data + pos;
+  data_size_ = data_size;
+  return true;
+}
+
+bool PsshBoxView::HasKid(const std::vector<uint8_t>& kid) const {
+  if (kid.size() != kPsshKidSize) {
+    return false;
+  }
+  for (size_t i = 0; i < kid_count_; i++) {
+    if (memcmp(this->kid(i), kid.data(), kPsshKidSize) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PsshBuilder::PsshBuilder(int version, size_t capacity)
+    : version_(version), capacity_(capacity) {
+  CHECK(version == 0 || version == 1) << "Invalid PSSH box version " << version;
+}
+
+PsshBuilder::~PsshBuilder() = default;
+
+void PsshBuilder::SetSystemData(const std::vector<uint8_t>& system_id,
+                                const std::vector<uint8_t>& data) {
+  data_[system_id] = data;
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+}
+
+std::shared_ptr<const DRMBlob> PsshBuilder::Build(
+    const std::vector<uint8_t>& system_id,
+    const std::vector<std::vector<uint8_t>>& kids) {
+  if (system_id.size() != kPsshSystemIdSize) {
+    return nullptr;
+  }
+  for (const std::vector<uint8_t>& kid : kids) {
+    if (kid.size() != kPsshKidSize) {
+      return nullptr;
+    }
+  }
+
+  std::string key(system_id.begin(), system_id.end());
+  std::vector<std::vector<uint8_t>> sorted_kids;
+  // Version 0 boxes are the same for every KID.
+  if (version_ == 1) {
+    sorted_kids = kids;
+    std::sort(sorted_kids.begin(), sorted_kids.end());
+    sorted_kids.erase(std::unique(sorted_kids.begin(), sorted_kids.end()),
+                      sorted_kids.end());
+    key.reserve(key.size() + sorted_kids.size() * kPsshKidSize);
+    for (const std::vector<uint8_t>& kid : sorted_kids) {
+      key.append(kid.begin(), kid.end());
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = cache_.find(key);
+    if (found != cache_.end()) {
+      hits_++;
+      return found->second;
+    }
+    misses_++;
+  }
+
+  // Built outside the lock. Threads racing on the same box build it twice
+  // and get the same interned blob.
+  static const std::vector<uint8_t>* const kNoData = new std::vector<uint8_t>;
+  auto data = data_.find(system_id);
+  std::shared_ptr<const DRMBlob> box = DRMBlob::Intern(
+      BuildPsshBox(version_, system_id, sorted_kids,
+                   data == data_.end() ? *kNoData : data->second));
+  if (!box) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cache_.size() >= capacity_) {
+    cache_.clear();
+  }
+  cache_.emplace(std::move(key), box);
+  return box;
+}
+
+size_t PsshBuilder::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+size_t PsshBuilder::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+}  // namespace cpix
@@ -0,0 +1,136 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_PSSH_H_
+#define CPIX_CC_PSSH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "drm_blob.h"
+
+// Building and parsing of the Common Encryption 'pssh' boxes carried in the
+// PSSH element of DRMSystem, as defined in ISO/IEC 23001-7.
+
+namespace cpix {
+
+constexpr size_t kPsshSystemIdSize = 16;
+constexpr size_t kPsshKidSize = 16;
+
+// System IDs of common DRM systems.
+extern const uint8_t kCommonPsshSystemId[kPsshSystemIdSize];
+extern const uint8_t kWidevineSystemId[kPsshSystemIdSize];
+extern const uint8_t kPlayReadySystemId[kPsshSystemIdSize];
+extern const uint8_t kFairPlaySystemId[kPsshSystemIdSize];
+
+// Returns a 'pssh' box of |version| 0 or 1 for |system_id|, holding |data|.
+// Version 1 boxes also list |kids|; version 0 boxes leave the KIDs to the
+// system-specific data. Returns an empty vector if an ID is not 16 bytes long
+// or |version| is not 0 or 1.
+std::vector<uint8_t> BuildPsshBox(int version,
+                                  const std::vector<uint8_t>& system_id,
+                                  const std::vector<std::vector<uint8_t>>& kids,
+                                  const std::vector<uint8_t>& data);
+
+// A view of one 'pssh' box in a caller-owned buffer. Parsing checks the whole
+// box without copying or allocating, and the accessors point into the buffer,
+// which must outlive the view.
+class PsshBoxView {
+ public:
+  // Parses the box at the start of |data|, which may be followed by more
+  // boxes. Returns false if it is not a well-formed 'pssh' box of version 0
+  // or 1.
+  bool Parse(const uint8_t* data, size_t size);
+  bool Parse(const std::vector<uint8_t>& box) {
+    return Parse(box.data(), box.size());
+  }
+
+  // Size of the whole box, where the next box, if any, starts.
+  size_t size() const { return size_; }
+  int version() const { return version_; }
+  const uint8_t* system_id() const { return system_id_; }
+
+  // KIDs listed by version 1 boxes, each kPsshKidSize bytes.
+  size_t kid_count() const { return kid_count_; }
+  const uint8_t* kid(size_t index) const {
+    return kids_ + index * kPsshKidSize;
+  }
+
+  // Returns true if the box lists |kid|. Version 0 boxes list no KIDs.
+  bool HasKid(const std::vector<uint8_t>& kid) const;
+
+  const uint8_t* data() const { return data_; }
+  size_t data_size() const { return data_size_; }
+
+ private:
+  size_t size_ = 0;
+  int version_ = 0;
+  const uint8_t* system_id_ = nullptr;
+  size_t kid_count_ = 0;
+  const uint8_t* kids_ = nullptr;
+  const uint8_t* data_ = nullptr;
+  size_t data_size_ = 0;
+};
+
+// PsshBuilder builds the 'pssh' boxes of many DRM systems, such as every
+// DRMSystem of a list (see DRMSystemList::BuildPsshBoxes()). Boxes are cached
+// by system ID and KID set, and returned as interned DRMBlobs, so identical
+// inputs are built, stored and Base64-encoded once. Build() may be called from
+// any number of threads.
+class PsshBuilder {
+ public:
+  // Builds boxes of |version|, which must be 0 or 1, and caches at most
+  // |capacity| of them. The cache is emptied when full.
+  explicit PsshBuilder(int version = 1, size_t capacity = 4096);
+  ~PsshBuilder();
+
+  PsshBuilder(const PsshBuilder&) = delete;
+  PsshBuilder& operator=(const PsshBuilder&) = delete;
+
+  int version() const { return version_; }
+
+  // Sets the system-specific data of the boxes for |system_id|, empty by
+  // default. Must not be called concurrently with Build().
+  void SetSystemData(const std::vector<uint8_t>& system_id,
+                     const std::vector<uint8_t>& data);
+
+  // Returns the box for |system_id| and |kids|, in any order, or nullptr if an
+  // ID is not 16 bytes long. Version 1 boxes list the KIDs sorted, without
+  // repeats.
+  std::shared_ptr<const DRMBlob> Build(
+      const std::vector<uint8_t>& system_id,
+      const std::vector<std::vector<uint8_t>>& kids);
+
+  size_t hits() const;
+  size_t misses() const;
+
+ private:
+  const int version_;
+  const size_t capacity_;
+  absl::flat_hash_map<std::vector<uint8_t>, std::vector<uint8_t>> data_;
+  mutable std::mutex mutex_;
+  // Keyed by the system ID followed by the KIDs of version 1 boxes.
+  absl::flat_hash_map<std::string, std::shared_ptr<const DRMBlob>> cache_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_PSSH_H_
@@ -0,0 +1,228 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pssh.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cpix_util.h"
+#include "drm_blob.h"
+#include "gtest/gtest.h"
+
+namespace cpix {
+namespace {
+
+// A version 0 Widevine box as packagers emit it.
+constexpr char kWidevinePssh[] =
+    "AAAAOHBzc2gAAAAA7e+LqXnWSs6jyCfc1R0h7QAAABgSELTDGIvt3UU9m8IcvKdWYjlI49yVm"
+    "wY=";
+
+const std::vector<uint8_t> kWidevine(kWidevineSystemId,
+                                     kWidevineSystemId + kPsshSystemIdSize);
+const std::vector<uint8_t> kKid1 =
+    HexStringToBytes("b4c3188beddd453d9bc21cbca7566239");
+const std::vector<uint8_t> kKid2 =
+    HexStringToBytes("0e4da92bd0e84a6ebd6a7f8a4b4b6c01");
+
+std::vector<uint8_t> ToVector(const uint8_t* data, size_t size) {
+  return std::vector<uint8_t>(data, data + size);
+}
+
+TEST(PsshTest, BuildsVersion1Box) {
+  std::vector<uint8_t> box =
+      BuildPsshBox(1, kWidevine, {kKid1, kKid2}, {1, 2, 3});
+  ASSERT_EQ(box.size(), 28u + 4 + 2 * kPsshKidSize + 4 + 3);
+
+  PsshBoxView view;
+  ASSERT_TRUE(view.Parse(box));
+  EXPECT_EQ(view.size(), box.size());
+  EXPECT_EQ(view.version(), 1);
+  EXPECT_EQ(ToVector(view.system_id(), kPsshSystemIdSize), kWidevine);
+  ASSERT_EQ(view.kid_count(), 2u);
+  EXPECT_EQ(ToVector(view.kid(0), kPsshKidSize), kKid1);
+  EXPECT_EQ(ToVector(view.kid(1), kPsshKidSize), kKid2);
+  EXPECT_TRUE(view.HasKid(kKid2));
+  EXPECT_FALSE(view.HasKid(kWidevine));
+  EXPECT_EQ(ToVector(view.data(), view.data_size()),
+            std::vector<uint8_t>({1, 2, 3}));
+}
+
+TEST(PsshTest, BuildsVersion0Box) {
+  std::vector<uint8_t> box = BuildPsshBox(0, kWidevine, {kKid1}, {});
+  ASSERT_EQ(box.size(), 32u);
+
+  PsshBoxView view;
+  ASSERT_TRUE(view.Parse(box));
+  EXPECT_EQ(view.version(), 0);
+  EXPECT_EQ(view.kid_count(), 0u);
+  EXPECT_FALSE(view.HasKid(kKid1));
+  EXPECT_EQ(view.data_size(), 0u);
+}
+
+TEST(PsshTest, RejectsBadBuildArguments) {
+  EXPECT_TRUE(BuildPsshBox(2, kWidevine, {}, {}).empty());
+  EXPECT_TRUE(BuildPsshBox(1, {1, 2, 3}, {}, {}).empty());
+  EXPECT_TRUE(BuildPsshBox(1, kWidevine, {{1, 2, 3}}, {}).empty());
+}
+
+TEST(PsshTest, ParsesWidevineBox) {
+  std::vector<uint8_t> box = Base64StringToBytes(kWidevinePssh);
+  PsshBoxView view;
+  ASSERT_TRUE(view.Parse(box));
+  EXPECT_EQ(view.size(), 56u);
+  EXPECT_EQ(view.version(), 0);
+  EXPECT_EQ(ToVector(view.system_id(), kPsshSystemIdSize), kWidevine);
+  EXPECT_EQ(view.data_size(), 24u);
+  EXPECT_EQ(view.data(), box.data() + 32);
+
+  // Building the same box gives the same bytes.
+  EXPECT_EQ(BuildPsshBox(0, kWidevine, {}, ToVector(view.data(), 24)), box);
+}
+
+TEST(PsshTest, ParsesConsecutiveBoxes) {
+  std::vector<uint8_t> boxes = BuildPsshBox(1, kWidevine, {kKid1}, {7});
+  std::vector<uint8_t> second = BuildPsshBox(0, kWidevine, {}, {8, 9});
+  boxes.insert(boxes.end(), second.begin(), second.end());
+
+  PsshBoxView view;
+  ASSERT_TRUE(view.Parse(boxes));
+  EXPECT_EQ(view.version(), 1);
+  ASSERT_TRUE(
+      view.Parse(boxes.data() + view.size(), boxes.size() - view.size()));
+  EXPECT_EQ(view.version(), 0);
+  EXPECT_EQ(ToVector(view.data(), view.data_size()),
+            std::vector<uint8_t>({8, 9}));
+}
+
+TEST(PsshTest, ParsesSpecialSizes) {
+  std::vector<uint8_t> box = BuildPsshBox(1, kWidevine, {kKid1}, {7});
+  PsshBoxView view;
+
+  // A size of 0 extends the box to the end of the buffer.
+  std::vector<uint8_t> open = box;
+  open[0] = open[1] = open[2] = open[3] = 0;
+  ASSERT_TRUE(view.Parse(open));
+  EXPECT_EQ(view.size(), box.size());
+  EXPECT_TRUE(view.HasKid(kKid1));
+
+  // A size of 1 is followed by a 64-bit size.
+  std::vector<uint8_t> large = {0, 0, 0, 1, 'p', 's', 's', 'h',
+                                0, 0, 0, 0, 0, 0, 0, 0};
+  large.insert(large.end(), box.begin() + 8, box.end());
+  large[15] = large.size();
+  ASSERT_TRUE(view.Parse(large));
+  EXPECT_EQ(view.size(), large.size());
+  EXPECT_TRUE(view.HasKid(kKid1));
+  EXPECT_EQ(ToVector(view.data(), view.data_size()),
+            std::vector<uint8_t>({7}));
+}
+
+TEST(PsshTest, RejectsMalformedBoxes) {
+  std::vector<uint8_t> box = BuildPsshBox(1, kWidevine, {kKid1, kKid2}, {7});
+  PsshBoxView view;
+  for (size_t size = 0; size < box.size(); size++) {
+    EXPECT_FALSE(view.Parse(box.data(), size)) << size;
+  }
+
+  std::vector<uint8_t> bad = box;
+  bad[7] = 'x';
+  EXPECT_FALSE(view.Parse(bad));
+
+  bad = box;
+  bad[8] = 2;
+  EXPECT_FALSE(view.Parse(bad));
+
+  // KID count beyond the box.
+  bad = box;
+  bad[31] = 3;
+  EXPECT_FALSE(view.Parse(bad));
+
+  // Data size that does not fill the box.
+  bad = box;
+  bad[box.size() - 2] = 2;
+  EXPECT_FALSE(view.Parse(bad));
+
+  // Failed parses leave an empty view.
+  EXPECT_EQ(view.size(), 0u);
+  EXPECT_EQ(view.kid_count(), 0u);
+}
+
+TEST(PsshBuilderTest, CachesBoxesByKidSet) {
+  PsshBuilder builder;
+  std::shared_ptr<const DRMBlob> box = builder.Build(kWidevine, {kKid1, kKid2});
+  ASSERT_NE(box, nullptr);
+  EXPECT_EQ(builder.Build(kWidevine, {kKid2, kKid1, kKid2}), box);
+  EXPECT_NE(builder.Build(kWidevine, {kKid1}), box);
+  EXPECT_EQ(builder.hits(), 1u);
+  EXPECT_EQ(builder.misses(), 2u);
+
+  // KIDs are listed sorted, without repeats.
+  PsshBoxView view;
+  ASSERT_TRUE(view.Parse(box->data()));
+  ASSERT_EQ(view.kid_count(), 2u);
+  EXPECT_EQ(ToVector(view.kid(0), kPsshKidSize), kKid2);
+  EXPECT_EQ(ToVector(view.kid(1), kPsshKidSize), kKid1);
+
+  // Boxes are interned, so other builders share them.
+  PsshBuilder other;
+  EXPECT_EQ(other.Build(kWidevine, {kKid1, kKid2}), box);
+
+  EXPECT_EQ(builder.Build(kKid1, {{1, 2}}), nullptr);
+}
+
+TEST(PsshBuilderTest, BuildsVersion0Boxes) {
+  PsshBuilder builder(0);
+  std::vector<uint8_t> data = {1, 2, 3};
+  builder.SetSystemData(kWidevine, data);
+  std::shared_ptr<const DRMBlob> box = builder.Build(kWidevine, {kKid1});
+  ASSERT_NE(box, nullptr);
+  EXPECT_EQ(builder.Build(kWidevine, {kKid2}), box);
+  EXPECT_EQ(box->data(), BuildPsshBox(0, kWidevine, {}, data));
+
+  builder.SetSystemData(kWidevine, {4});
+  EXPECT_NE(builder.Build(kWidevine, {kKid1}), box);
+}
+
+TEST(PsshBuilderTest, EmptiesFullCache) {
+  PsshBuilder builder(1, 1);
+  std::shared_ptr<const DRMBlob> box = builder.Build(kWidevine, {kKid1});
+  builder.Build(kWidevine, {kKid2});
+  EXPECT_EQ(builder.Build(kWidevine, {kKid1}), box);
+  EXPECT_EQ(builder.hits(), 0u);
+  EXPECT_EQ(builder.misses(), 3u);
+}
+
+TEST(PsshBuilderTest, BuildsConcurrently) {
+  PsshBuilder builder;
+  std::shared_ptr<const DRMBlob> expected = DRMBlob::Intern(
+      BuildPsshBox(1, kWidevine, {kKid2, kKid1}, std::vector<uint8_t>()));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&builder, &expected]() {
+      for (int j = 0; j < 100; j++) {
+        EXPECT_EQ(builder.Build(kWidevine, {kKid1, kKid2}), expected);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(builder.hits() + builder.misses(), 800u);
+}
+
+}  // namespace
+}  // namespace cpix
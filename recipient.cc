@@ -15,7 +15,10 @@
 #include "recipient.h"
 
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -27,11 +30,18 @@
 #include "xml_node.h"
 
 namespace cpix {
+namespace {
+
+// Bounds the public key cache. Deployments deliver to a handful of
+// recipients, so the cache is simply emptied when it fills up.
+constexpr size_t kMaxCachedPublicKeys = 64;
+
+}  // namespace
 
 Recipient::~Recipient() = default;
 
 bool Recipient::SetDocumentKey(const std::vector<uint8_t>& key) {
-  std::unique_ptr<RSAPublicKey> rsa = CreateRSAPublicKey();
+  std::shared_ptr<RSAPublicKey> rsa = GetRSAPublicKey();
   if (!rsa) {
     return false;
   }
@@ -66,7 +76,7 @@ bool Recipient::Deserialize(std::unique_ptr<XMLNode> node) {
   return true;
 }
 
-std::unique_ptr<XMLNode> Recipient::GetNode() {
+std::unique_ptr<XMLNode> Recipient::GetNode() const {
   if (encrypted_document_key_.empty()) {
     return nullptr;
   }
@@ -130,25 +140,40 @@ std::unique_ptr<XMLNode> Recipient::GetNode() {
   return root;
 }
 
-std::unique_ptr<RSAPublicKey> Recipient::CreateRSAPublicKey() {
+std::shared_ptr<RSAPublicKey> Recipient::GetRSAPublicKey() const {
+  static std::mutex* mutex = new std::mutex;
+  static auto* keys = new std::map<std::string, std::shared_ptr<RSAPublicKey>>;
+  std::string certificate(delivery_key_.begin(), delivery_key_.end());
+  {
+    std::lock_guard<std::mutex> lock(*mutex);
+    auto found = keys->find(certificate);
+    if (found != keys->end()) {
+      return found->second;
+    }
+  }
+
   std::unique_ptr<X509Certificate> cert =
       X509Certificate::CreateFromDER(delivery_key_);
   if (!cert) {
     return nullptr;
   }
+  std::shared_ptr<RSAPublicKey> key =
+      RSAPublicKey::CreateFromPEM(cert->GetPubKey());
+  if (!key) {
+    return nullptr;
+  }
 
-  return RSAPublicKey::CreateFromPEM(cert->GetPubKey());
+  std::lock_guard<std::mutex> lock(*mutex);
+  if (keys->size() >= kMaxCachedPublicKeys) {
+    keys->clear();
+  }
+  keys->emplace(std::move(certificate), key);
+  return key;
 }
 
 std::vector<uint8_t> Recipient::DecryptDocumentKeyWith(
-    const std::vector<uint8_t>& private_key) {
-  std::unique_ptr<RSAPrivateKey> rsa =
-      RSAPrivateKey::CreateFromDER(private_key);
-  if (!rsa) {
-    return std::vector<uint8_t>();
-  }
-
-  return rsa->Decrypt(encrypted_document_key_);
+    RSAPrivateKey* private_key) {
+  return private_key->Decrypt(encrypted_document_key_);
 }
 
 }  // namespace cpix
@@ -25,6 +25,7 @@
 
 namespace cpix {
 class XMLNode;
+class RSAPrivateKey;
 class RSAPublicKey;
 
 // A core element of the CPIX document. Contains the X509 certificate of a
@@ -55,10 +56,12 @@ class Recipient : public CPIXElement {
  private:
   friend class RecipientList;
   friend class CPIXMessage;
-  std::unique_ptr<XMLNode> GetNode() override;
-  std::unique_ptr<RSAPublicKey> CreateRSAPublicKey();
-  std::vector<uint8_t> DecryptDocumentKeyWith(
-      const std::vector<uint8_t>& private_key);
+  std::unique_ptr<XMLNode> GetNode() const override;
+  // Returns the public key of |delivery_key_|, or nullptr if the certificate
+  // is invalid. Keys are cached process-wide by certificate, so documents for
+  // the same recipients parse each certificate once.
+  std::shared_ptr<RSAPublicKey> GetRSAPublicKey() const;
+  std::vector<uint8_t> DecryptDocumentKeyWith(RSAPrivateKey* private_key);
 
   std::vector<uint8_t> delivery_key_;
   std::vector<uint8_t> encrypted_document_key_;
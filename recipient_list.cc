@@ -16,7 +16,6 @@
 
 #include <utility>
 
-#include "absl/memory/memory.h"
 #include "cpix_element.h"
 #include "cpix_util.h"
 
@@ -33,7 +32,4 @@ bool RecipientList::AddRecipient(std::unique_ptr<Recipient> recipient) {
   return true;
 }
 
-std::unique_ptr<CPIXElement> RecipientList::CreateElement() {
-  return absl::make_unique<Recipient>();
-}
 }  // namespace cpix
@@ -23,17 +23,15 @@
 #include "recipient.h"
 
 namespace cpix {
-class RecipientList : public CPIXElementList {
+class RecipientList : public CPIXElementList<Recipient> {
  public:
-  RecipientList() : CPIXElementList("DeliveryDataList") {}
+  RecipientList() : CPIXElementList<Recipient>("DeliveryDataList") {}
   ~RecipientList();
   bool AddRecipient(std::unique_ptr<Recipient> recipient);
 
  private:
   friend class CPIXMessage;
 
-  std::unique_ptr<CPIXElement> CreateElement() override;
-
   std::string document_key_;
 };
 }  // namespace cpix
@@ -93,6 +93,9 @@ bool RSAPrivateKey::SetPrivateKeyDER(
   }
 
   UniqueSslPtr<EVP_PKEY> key(d2i_PrivateKey_bio(bio.get(), nullptr));
+  if (!key) {
+    return false;
+  }
 
   rsa = UniqueSslPtr<RSA>(EVP_PKEY_get1_RSA(key.get()));
 
@@ -17,6 +17,7 @@
 
 #include <memory>
 
+#include "libxml/parser.h"
 #include "libxml/tree.h"
 #include "libxml/xmlschemastypes.h"
 
@@ -24,6 +25,7 @@ namespace cpix {
 
 struct XmlDeleter {
   inline void operator()(xmlNodePtr ptr) const { xmlFreeNode(ptr); }
+  inline void operator()(xmlNsPtr ptr) const { xmlFreeNs(ptr); }
   inline void operator()(xmlBufferPtr ptr) const { xmlBufferFree(ptr); }
   inline void operator()(xmlDocPtr ptr) const { xmlFreeDoc(ptr); }
   inline void operator()(xmlSchemaPtr ptr) const { xmlSchemaFree(ptr); }
@@ -33,6 +35,10 @@ struct XmlDeleter {
   inline void operator()(xmlSchemaValidCtxtPtr ptr) const {
     xmlSchemaFreeValidCtxt(ptr);
   }
+  inline void operator()(xmlParserCtxtPtr ptr) const {
+    xmlFreeParserCtxt(ptr);
+  }
+  inline void operator()(xmlDictPtr ptr) const { xmlDictFree(ptr); }
   inline void operator()(xmlChar* ptr) const { xmlFree(ptr); }
 };
 
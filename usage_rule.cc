@@ -24,10 +24,55 @@
 #include "xml_node.h"
 
 namespace cpix {
+namespace {
+
+// Attribute text of each UsageRule::TrackType, in enum order. kOther has none.
+constexpr const char* kTrackTypeNames[] = {"",   "AUDIO", "VIDEO", "SD", "HD",
+                                           "UHD", "UHD1", "UHD2",  ""};
+
+}  // namespace
+
+constexpr int UsageRule::kTrackTypeCount;
+
 UsageRule::~UsageRule() = default;
 
+void UsageRule::SetTrackType(const std::string& trackType) {
+  for (int type = 0; type < kTrackTypeCount - 1; type++) {
+    if (trackType == kTrackTypeNames[type]) {
+      SetTrackType(static_cast<TrackType>(type));
+      return;
+    }
+  }
+  track_type_ = TrackType::kOther;
+  other_track_type_ = trackType;
+}
+
+bool UsageRule::SetTrackType(TrackType type) {
+  if (type == TrackType::kOther) {
+    LOG(WARNING) << "Other track types must be set by name. Type not set.";
+    return false;
+  }
+  track_type_ = type;
+  other_track_type_.clear();
+  return true;
+}
+
+const std::string& UsageRule::intended_track_type() const {
+  static const std::string* const kNames = [] {
+    std::string* names = new std::string[kTrackTypeCount];
+    for (int type = 0; type < kTrackTypeCount; type++) {
+      names[type] = kTrackTypeNames[type];
+    }
+    return names;
+  }();
+  if (track_type_ == TrackType::kOther) {
+    return other_track_type_;
+  }
+  return kNames[static_cast<int>(track_type_)];
+}
+
 bool UsageRule::AddLabelFilter(const std::string& label) {
-  label_filters_.push_back(label);
+  label_filters_.emplace_back(label);
   return true;
 }
 
@@ -64,7 +109,7 @@ bool UsageRule::AddKeyPeriodFilter(const std::string& id) {
   return true;
 }
 
-std::unique_ptr<XMLNode> UsageRule::GetNode() {
+std::unique_ptr<XMLNode> UsageRule::GetNode() const {
   if (kid_.empty()) {
     return nullptr;
   }
@@ -78,8 +123,8 @@ std::unique_ptr<XMLNode> UsageRule::GetNode() {
 
   root->AddAttribute("kid", BytesToGUID(kid_));
 
-  if (!intended_track_type_.empty()) {
-    root->AddAttribute("intendedTrackType", intended_track_type_);
+  if (track_type_ != TrackType::kUnspecified) {
+    root->AddAttribute("intendedTrackType", intended_track_type());
   }
 
   for (auto const& filter : key_period_filter_ids_) {
@@ -92,7 +137,7 @@ std::unique_ptr<XMLNode> UsageRule::GetNode() {
   for (auto const& filter : label_filters_) {
     std::unique_ptr<XMLNode> label =
         absl::make_unique<XMLNode>("", "LabelFilter");
-    label->AddAttribute("label", filter);
+    label->AddAttribute("label", filter.text());
     root->AddChild(std::move(label));
   }
 
@@ -151,7 +196,10 @@ bool UsageRule::Deserialize(std::unique_ptr<XMLNode> node) {
     set_id(attribute);
   }
 
-  kid_ = GUIDStringToBytes(node->GetAttribute("kid"));
+  if (!GUIDStringToBytes(node->GetAttribute("kid"), &kid_)) {
+    LOG(ERROR) << "Malformed kid attribute.";
+    return false;
+  }
 
   std::unique_ptr<XMLNode> child;
 
@@ -160,7 +208,7 @@ bool UsageRule::Deserialize(std::unique_ptr<XMLNode> node) {
   }
 
   if (!(attribute = node->GetAttribute("intendedTrackType")).empty()) {
-    intended_track_type_ = attribute;
+    SetTrackType(attribute);
   }
 
   while ((child = node->GetFirstChildByName("KeyPeriodFilter"))) {
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "cpix_element.h"
+#include "label.h"
 
 namespace cpix {
 
@@ -58,9 +59,26 @@ class UsageRule : public CPIXElement {
   const std::vector<uint8_t>& kid() const { return kid_; }
   void set_key_id(const std::vector<uint8_t>& kid) { kid_ = kid; }
 
-  void SetTrackType(const std::string& trackType) {
-    intended_track_type_ = trackType;
-  }
+  // Common values of the intendedTrackType attribute. Any other value is
+  // kOther, and its text is kept as is.
+  enum class TrackType {
+    kUnspecified,
+    kAudio,
+    kVideo,
+    kSD,
+    kHD,
+    kUHD,
+    kUHD1,
+    kUHD2,
+    kOther,
+  };
+  static constexpr int kTrackTypeCount =
+      static_cast<int>(TrackType::kOther) + 1;
+
+  void SetTrackType(const std::string& trackType);
+  // Sets one of the common track types. kOther has no text of its own, so it
+  // is rejected; set such types by their text instead.
+  bool SetTrackType(TrackType type);
   bool AddLabelFilter(const std::string& label);
   bool AddVideoFilter(const VideoFilter& filter);
   bool AddAudioFilter(const AudioFilter& filter);
@@ -71,16 +89,38 @@ class UsageRule : public CPIXElement {
   // KeyPeriodList.
   bool AddKeyPeriodFilter(const std::string& id);
 
+  TrackType track_type() const { return track_type_; }
+
+  // The intendedTrackType attribute, empty if kUnspecified.
+  const std::string& intended_track_type() const;
+  const std::vector<Label>& label_filters() const {
+    return label_filters_;
+  }
+  const std::vector<VideoFilter>& video_filters() const {
+    return video_filters_;
+  }
+  const std::vector<AudioFilter>& audio_filters() const {
+    return audio_filters_;
+  }
+  const std::vector<BitrateFilter>& bitrate_filters() const {
+    return bitrate_filters_;
+  }
+  const std::vector<std::string>& key_period_filter_ids() const {
+    return key_period_filter_ids_;
+  }
+
  protected:
   bool Deserialize(std::unique_ptr<XMLNode> node) override;
 
  private:
   friend class UsageRuleList;
-  std::unique_ptr<XMLNode> GetNode() override;
+  std::unique_ptr<XMLNode> GetNode() const override;
 
   std::vector<uint8_t> kid_;
-  std::string intended_track_type_;
-  std::vector<std::string> label_filters_;
+  TrackType track_type_ = TrackType::kUnspecified;
+  // The attribute text if |track_type_| is kOther.
+  std::string other_track_type_;
+  std::vector<Label> label_filters_;
   std::vector<VideoFilter> video_filters_;
   std::vector<AudioFilter> audio_filters_;
   std::vector<BitrateFilter> bitrate_filters_;
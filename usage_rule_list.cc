@@ -14,24 +14,156 @@
 
 #include "usage_rule_list.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
-#include "absl/memory/memory.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
 #include "cpix_element.h"
+#include "label.h"
 #include "usage_rule.h"
 #include "xml_node.h"
 
 namespace cpix {
+namespace {
+
+const std::vector<const UsageRule*>& NoRules() {
+  static const std::vector<const UsageRule*>* const kNoRules =
+      new std::vector<const UsageRule*>;
+  return *kNoRules;
+}
+
+}  // namespace
+
 UsageRuleList::~UsageRuleList() = default;
 
 bool UsageRuleList::AddUsageRule(std::unique_ptr<UsageRule> rule) {
   AddElement(std::move(rule));
+  IndexRules(elements_.size() - 1);
+  return true;
+}
+
+bool UsageRuleList::AddUsageRules(
+    std::vector<std::unique_ptr<UsageRule>> rules) {
+  size_t first = elements_.size();
+  AddElements(std::move(rules));
+  IndexRules(first);
   return true;
 }
 
-std::unique_ptr<CPIXElement> UsageRuleList::CreateElement() {
-  return absl::make_unique<UsageRule>();
+const std::vector<const UsageRule*>& UsageRuleList::FindRulesByLabel(
+    const std::string& label) const {
+  auto entry = by_label_.find(label);
+  return entry == by_label_.end() ? NoRules() : entry->second.rules;
+}
+
+const std::vector<const UsageRule*>& UsageRuleList::FindRulesByTrackType(
+    UsageRule::TrackType type) const {
+  return by_track_type_[static_cast<int>(type)];
+}
+
+const std::vector<const UsageRule*>& UsageRuleList::FindRulesByKid(
+    const std::vector<uint8_t>& kid) const {
+  auto rules = by_kid_.find(kid);
+  return rules == by_kid_.end() ? NoRules() : rules->second;
+}
+
+size_t UsageRuleList::RemoveUsageRules(
+    const std::function<bool(const UsageRule&)>& remove) {
+  absl::flat_hash_set<const UsageRule*> removed;
+  // The index entries holding removed rules. Only these are filtered.
+  absl::flat_hash_set<Rules*> touched;
+  absl::flat_hash_set<absl::string_view> touched_labels;
+  absl::flat_hash_set<std::vector<uint8_t>> touched_kids;
+  RemoveElements([&](const UsageRule& rule) {
+    if (!remove(rule)) {
+      return false;
+    }
+    removed.insert(&rule);
+    for (const Label& label : rule.label_filters()) {
+      touched_labels.insert(label.text());
+    }
+    touched.insert(&by_track_type_[static_cast<int>(rule.track_type())]);
+    touched_kids.insert(rule.kid());
+    return true;
+  });
+
+  auto filter = [&removed](Rules* rules) {
+    rules->erase(std::remove_if(rules->begin(), rules->end(),
+                                [&removed](const UsageRule* rule) {
+                                  return removed.count(rule) > 0;
+                                }),
+                 rules->end());
+  };
+  for (Rules* rules : touched) {
+    filter(rules);
+  }
+  for (absl::string_view label : touched_labels) {
+    auto entry = by_label_.find(label);
+    filter(&entry->second.rules);
+    if (entry->second.rules.empty()) {
+      by_label_.erase(entry);
+    }
+  }
+  for (const std::vector<uint8_t>& kid : touched_kids) {
+    auto rules = by_kid_.find(kid);
+    filter(&rules->second);
+    // KIDs usually expire with all of their rules.
+    if (rules->second.empty()) {
+      by_kid_.erase(rules);
+    }
+  }
+  return removed.size();
+}
+
+size_t UsageRuleList::RemoveKeyPeriodFilters(
+    const absl::flat_hash_set<std::string>& period_ids) {
+  size_t changed = 0;
+  for (UsageRule* rule : elements_) {
+    std::vector<std::string>& ids = rule->key_period_filter_ids_;
+    auto kept = std::remove_if(ids.begin(), ids.end(),
+                               [&period_ids](const std::string& id) {
+                                 return period_ids.count(id) > 0;
+                               });
+    if (kept != ids.end()) {
+      ids.erase(kept, ids.end());
+      InvalidateFragment(rule);
+      changed++;
+    }
+  }
+  return changed;
+}
+
+bool UsageRuleList::Deserialize(std::unique_ptr<XMLNode> node) {
+  size_t first = elements_.size();
+  bool result = CPIXElementList<UsageRule>::Deserialize(std::move(node));
+  IndexRules(first);
+  return result;
+}
+
+void UsageRuleList::IndexRules(size_t first) {
+  for (size_t i = first; i < elements_.size(); i++) {
+    const UsageRule* rule = elements_[i];
+    for (const Label& label : rule->label_filters()) {
+      auto entry = by_label_.find(label.text());
+      if (entry == by_label_.end()) {
+        entry = by_label_.emplace(label.text(), LabelRules{label, Rules()})
+                    .first;
+      }
+      Rules& rules = entry->second.rules;
+      // A rule may repeat a label.
+      if (rules.empty() || rules.back() != rule) {
+        rules.push_back(rule);
+      }
+    }
+    by_track_type_[static_cast<int>(rule->track_type())].push_back(rule);
+    by_kid_[rule->kid()].push_back(rule);
+  }
 }
 
 }  // namespace cpix
@@ -15,23 +15,78 @@
 #ifndef CPIX_CC_USAGE_RULE_LIST_H_
 #define CPIX_CC_USAGE_RULE_LIST_H_
 
+#include <stdint.h>
+
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
 #include "cpix_element.h"
 #include "cpix_element_list.h"
+#include "label.h"
 #include "usage_rule.h"
 
 namespace cpix {
 
-class UsageRuleList : public CPIXElementList {
+// The usage rules of a document. The list also indexes the rules by label,
+// track type and KID, so the rules for one of them are found without walking
+// every rule. The label index is keyed by the interned text of each label, so
+// it stores each distinct label once, with one list of rules per label, and
+// drops a label once its last rule is removed. Rules must not change their
+// labels, track type or KID once added.
+class UsageRuleList : public CPIXElementList<UsageRule> {
  public:
-  UsageRuleList() : CPIXElementList("ContentKeyUsageRuleList") {}
+  UsageRuleList() : CPIXElementList<UsageRule>("ContentKeyUsageRuleList") {}
   ~UsageRuleList();
   bool AddUsageRule(std::unique_ptr<UsageRule> rule);
 
+  // Adds all of |rules|.
+  bool AddUsageRules(std::vector<std::unique_ptr<UsageRule>> rules);
+
+  // Return the rules with a LabelFilter for |label|, the given track type or
+  // the given KID, in document order.
+  const std::vector<const UsageRule*>& FindRulesByLabel(
+      const std::string& label) const;
+  const std::vector<const UsageRule*>& FindRulesByTrackType(
+      UsageRule::TrackType type) const;
+  const std::vector<const UsageRule*>& FindRulesByKid(
+      const std::vector<uint8_t>& kid) const;
+
+  // Removes every rule for which |remove| returns true and drops it from the
+  // index. Returns the number of rules removed.
+  size_t RemoveUsageRules(const std::function<bool(const UsageRule&)>& remove);
+
+ protected:
+  bool Deserialize(std::unique_ptr<XMLNode> node) override;
+
  private:
   friend class CPIXMessage;
-  std::unique_ptr<CPIXElement> CreateElement();
+
+  using Rules = std::vector<const UsageRule*>;
+
+  // Adds elements_[first] onwards to the index.
+  void IndexRules(size_t first);
+
+  // Drops the KeyPeriodFilters naming any of |period_ids| from every rule, and
+  // discards the kept fragments of the rules changed. Returns the number of
+  // rules changed.
+  size_t RemoveKeyPeriodFilters(
+      const absl::flat_hash_set<std::string>& period_ids);
+
+  // The rules with one label. The entry holds the label, so the interned text
+  // it is keyed by stays alive.
+  struct LabelRules {
+    Label label;
+    Rules rules;
+  };
+
+  absl::flat_hash_map<absl::string_view, LabelRules> by_label_;
+  Rules by_track_type_[UsageRule::kTrackTypeCount];
+  absl::flat_hash_map<std::vector<uint8_t>, Rules> by_kid_;
 };
 }  // namespace cpix
 #endif  // CPIX_CC_USAGE_RULE_LIST_H_
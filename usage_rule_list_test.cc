@@ -14,12 +14,16 @@
 
 #include "usage_rule_list.h"
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "label.h"
 #include "testable_cpix_element.h"
 #include "usage_rule.h"
 #include "xml_node.h"
@@ -33,7 +37,7 @@ using ::testing::Test;
 
 class MockUsageRule : public UsageRule {
  public:
-  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (override));
+  MOCK_METHOD(std::unique_ptr<XMLNode>, GetNode, (), (const, override));
 };
 
 constexpr char kGoodXML[] =
@@ -58,5 +62,92 @@ TEST(UsageRuleListTest, SerializeUsageRuleList) {
   EXPECT_EQ(usage_rule_list.Serialize(), kGoodXML);
 }
 
+std::unique_ptr<UsageRule> Rule(uint8_t kid, const std::string& type,
+                                std::vector<std::string> labels) {
+  std::unique_ptr<UsageRule> rule = absl::make_unique<UsageRule>();
+  rule->set_key_id(std::vector<uint8_t>(16, kid));
+  rule->SetTrackType(type);
+  for (const std::string& label : labels) {
+    rule->AddLabelFilter(label);
+  }
+  return rule;
+}
+
+TEST(UsageRuleListTest, FindRules) {
+  TestableCPIXElement<UsageRuleList> usage_rule_list;
+  usage_rule_list.AddUsageRule(Rule(1, "HD", {"HD-video", "main"}));
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  rules.push_back(Rule(2, "AUDIO", {"main"}));
+  rules.push_back(Rule(1, "custom", {"HD-video", "HD-video"}));
+  usage_rule_list.AddUsageRules(std::move(rules));
+
+  // Round-trip to also index deserialized rules.
+  TestableCPIXElement<UsageRuleList> parsed;
+  ASSERT_TRUE(parsed.Deserialize(
+      absl::make_unique<XMLNode>(usage_rule_list.Serialize())));
+  for (const UsageRuleList* list : {&usage_rule_list, &parsed}) {
+    ASSERT_EQ(list->FindRulesByLabel("HD-video").size(), 2);
+    EXPECT_EQ(list->FindRulesByLabel("HD-video")[0]->track_type(),
+              UsageRule::TrackType::kHD);
+    EXPECT_EQ(list->FindRulesByLabel("HD-video")[1]->intended_track_type(),
+              "custom");
+    EXPECT_EQ(list->FindRulesByLabel("main").size(), 2);
+    EXPECT_TRUE(list->FindRulesByLabel("other").empty());
+    ASSERT_EQ(list->FindRulesByTrackType(UsageRule::TrackType::kAudio).size(),
+              1);
+    EXPECT_EQ(list->FindRulesByTrackType(UsageRule::TrackType::kOther).size(),
+              1);
+    EXPECT_TRUE(
+        list->FindRulesByTrackType(UsageRule::TrackType::kSD).empty());
+    EXPECT_EQ(list->FindRulesByKid(std::vector<uint8_t>(16, 1)).size(), 2);
+    EXPECT_TRUE(list->FindRulesByKid(std::vector<uint8_t>(16, 3)).empty());
+  }
+}
+
+TEST(UsageRuleListTest, RemoveUsageRules) {
+  TestableCPIXElement<UsageRuleList> usage_rule_list;
+  usage_rule_list.AddUsageRule(Rule(1, "HD", {"main"}));
+  usage_rule_list.AddUsageRule(Rule(2, "AUDIO", {"main"}));
+  usage_rule_list.AddUsageRule(Rule(2, "AUDIO", {"alt"}));
+
+  EXPECT_EQ(usage_rule_list.RemoveUsageRules([](const UsageRule& rule) {
+    return rule.track_type() == UsageRule::TrackType::kAudio &&
+           rule.label_filters()[0].text() == "main";
+  }),
+            1);
+  EXPECT_EQ(usage_rule_list.size(), 2);
+  EXPECT_EQ(usage_rule_list.FindRulesByLabel("main").size(), 1);
+  EXPECT_EQ(usage_rule_list.FindRulesByKid(std::vector<uint8_t>(16, 2)).size(),
+            1);
+
+  usage_rule_list.RemoveUsageRules([](const UsageRule& rule) {
+    return rule.track_type() == UsageRule::TrackType::kAudio;
+  });
+  EXPECT_TRUE(
+      usage_rule_list.FindRulesByTrackType(UsageRule::TrackType::kAudio)
+          .empty());
+  EXPECT_TRUE(
+      usage_rule_list.FindRulesByKid(std::vector<uint8_t>(16, 2)).empty());
+  EXPECT_EQ(usage_rule_list.FindRulesByKid(std::vector<uint8_t>(16, 1)).size(),
+            1);
+}
+
+TEST(UsageRuleListTest, RemovingLastRuleDropsLabel) {
+  const size_t live = Label::live_count();
+  TestableCPIXElement<UsageRuleList> usage_rule_list;
+  usage_rule_list.AddUsageRule(Rule(1, "HD", {"expiring"}));
+  usage_rule_list.AddUsageRule(Rule(2, "HD", {"expiring", "expiring"}));
+  EXPECT_EQ(Label::live_count(), live + 1);
+  EXPECT_EQ(usage_rule_list.FindRulesByLabel("expiring").size(), 2);
+
+  usage_rule_list.RemoveUsageRules([](const UsageRule& rule) { return true; });
+  EXPECT_TRUE(usage_rule_list.FindRulesByLabel("expiring").empty());
+  // The index does not keep the label alive.
+  EXPECT_EQ(Label::live_count(), live);
+
+  usage_rule_list.AddUsageRule(Rule(3, "HD", {"expiring"}));
+  EXPECT_EQ(usage_rule_list.FindRulesByLabel("expiring").size(), 1);
+}
+
 }  // namespace
 }  // namespace cpix
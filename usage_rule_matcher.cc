@@ -0,0 +1,302 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "usage_rule_matcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "label.h"
+#include "usage_rule.h"
+
+namespace cpix {
+namespace {
+
+size_t WordsFor(size_t bits) { return (bits + 63) / 64; }
+
+// Scratch bitsets for one lookup. Up to 256 rules or filters of a kind fit
+// without allocating.
+using ScratchBits = absl::InlinedVector<uint64_t, 4>;
+
+// Returns true if |value| is in the inclusive range [min, max], where -1 is an
+// open end.
+bool InRange(int value, int min, int max) {
+  return (min == -1 || value >= min) && (max == -1 || value <= max);
+}
+
+// Calls |fn| with each node of a bottom-up segment tree with |leaves| leaves
+// that together cover exactly leaves [low, high).
+template <typename Fn>
+void ForEachCoveringNode(size_t leaves, size_t low, size_t high,
+                         const Fn& fn) {
+  for (low += leaves, high += leaves; low < high; low /= 2, high /= 2) {
+    if (low % 2 == 1) {
+      fn(low++);
+    }
+    if (high % 2 == 1) {
+      fn(--high);
+    }
+  }
+}
+
+}  // namespace
+
+UsageRuleMatcher::~UsageRuleMatcher() = default;
+
+size_t UsageRuleMatcher::IntervalTable::Interval(int64_t value) const {
+  return std::upper_bound(boundaries_.begin(), boundaries_.end(), value) -
+         boundaries_.begin();
+}
+
+void UsageRuleMatcher::IntervalTable::Build(
+    const std::vector<std::pair<int, int>>& ranges) {
+  boundaries_.clear();
+  for (const auto& range : ranges) {
+    if (range.first != -1) {
+      boundaries_.push_back(range.first);
+    }
+    if (range.second != -1) {
+      boundaries_.push_back(int64_t{range.second} + 1);
+    }
+  }
+  std::sort(boundaries_.begin(), boundaries_.end());
+  boundaries_.erase(std::unique(boundaries_.begin(), boundaries_.end()),
+                    boundaries_.end());
+
+  // Interval i starts at boundaries_[i - 1]. Every range starts and ends on a
+  // boundary, so it covers a run of whole intervals. Leaf i of the tree stands
+  // for interval i, and each run is stored in the nodes covering it exactly.
+  intervals_ = boundaries_.size() + 1;
+  std::vector<std::pair<size_t, size_t>> runs;
+  runs.reserve(ranges.size());
+  for (const auto& range : ranges) {
+    runs.emplace_back(range.first == -1 ? 0 : Interval(range.first),
+                      range.second == -1 ? intervals_
+                                         : Interval(range.second) + 1);
+  }
+
+  // Counts the entries of each node, then places them.
+  offsets_.assign(2 * intervals_ + 1, 0);
+  for (const auto& run : runs) {
+    ForEachCoveringNode(intervals_, run.first, run.second,
+                        [this](size_t node) { offsets_[node + 1]++; });
+  }
+  for (size_t node = 0; node < 2 * intervals_; node++) {
+    offsets_[node + 1] += offsets_[node];
+  }
+  entries_.resize(offsets_.back());
+  std::vector<uint32_t> next(offsets_.begin(), offsets_.end() - 1);
+  for (uint32_t entry = 0; entry < runs.size(); entry++) {
+    ForEachCoveringNode(intervals_, runs[entry].first, runs[entry].second,
+                        [this, &next, entry](size_t node) {
+                          entries_[next[node]++] = entry;
+                        });
+  }
+}
+
+template <typename Fn>
+void UsageRuleMatcher::IntervalTable::ForEach(int value, const Fn& fn) const {
+  if (entries_.empty()) {
+    return;
+  }
+  // The nodes covering a leaf are its ancestors.
+  for (size_t node = Interval(value) + intervals_; node > 0; node /= 2) {
+    for (uint32_t i = offsets_[node]; i < offsets_[node + 1]; i++) {
+      fn(entries_[i]);
+    }
+  }
+}
+
+void UsageRuleMatcher::RuleSet::Build(const std::vector<const UsageRule*>& all,
+                                      std::vector<uint32_t> indices) {
+  rules_ = std::move(indices);
+  words_ = WordsFor(rules_.size());
+  for (FilterSet* set : {&video_, &audio_, &bitrate_}) {
+    set->unconstrained.assign(words_, 0);
+  }
+  unlabeled_.assign(words_, 0);
+
+  std::vector<std::pair<int, int>> pixels, channels, bitrates;
+  for (uint32_t r = 0; r < rules_.size(); r++) {
+    const UsageRule& rule = *all[rules_[r]];
+
+    for (const VideoFilter& filter : rule.video_filters()) {
+      video_.owners.push_back(r);
+      video_filters_.push_back(filter);
+      pixels.emplace_back(filter.min_pixels, filter.max_pixels);
+    }
+    if (rule.video_filters().empty()) {
+      SetBit(r, video_.unconstrained.data());
+    }
+
+    for (const AudioFilter& filter : rule.audio_filters()) {
+      audio_.owners.push_back(r);
+      channels.emplace_back(filter.min_channels, filter.max_channels);
+    }
+    if (rule.audio_filters().empty()) {
+      SetBit(r, audio_.unconstrained.data());
+    }
+
+    for (const BitrateFilter& filter : rule.bitrate_filters()) {
+      bitrate_.owners.push_back(r);
+      bitrates.emplace_back(filter.min_bitrate, filter.max_bitrate);
+    }
+    if (rule.bitrate_filters().empty()) {
+      SetBit(r, bitrate_.unconstrained.data());
+    }
+
+    for (const Label& label : rule.label_filters()) {
+      std::vector<uint32_t>& rules = labels_[label.text()];
+      if (rules.empty() || rules.back() != r) {
+        rules.push_back(r);
+      }
+    }
+    if (rule.label_filters().empty()) {
+      SetBit(r, unlabeled_.data());
+    }
+  }
+
+  pixels_.Build(pixels);
+  channels_.Build(channels);
+  bitrates_.Build(bitrates);
+}
+
+int64_t UsageRuleMatcher::RuleSet::FirstMatch(
+    const TrackProperties& track) const {
+  if (rules_.empty()) {
+    return -1;
+  }
+
+  ScratchBits candidates(words_, ~uint64_t{0});
+  ScratchBits matched(words_);
+  // Narrows the candidates to the matched rules, and returns false once none
+  // are left.
+  auto keep_matched = [&candidates, &matched]() {
+    uint64_t any = 0;
+    for (size_t w = 0; w < candidates.size(); w++) {
+      candidates[w] &= matched[w];
+      any |= candidates[w];
+    }
+    return any != 0;
+  };
+
+  // Video filters. The pixel count selects the filters to check further.
+  matched.assign(video_.unconstrained.begin(), video_.unconstrained.end());
+  if (track.type == TrackProperties::Type::kVideo) {
+    pixels_.ForEach(track.pixels, [this, &track, &matched](uint32_t f) {
+      const VideoFilter& filter = video_filters_[f];
+      if (InRange(track.fps, filter.min_fps, filter.max_fps) &&
+          (track.hdr || !filter.hdr) && (track.wcg || !filter.wcg)) {
+        SetBit(video_.owners[f], matched.data());
+      }
+    });
+  }
+  if (!keep_matched()) {
+    return -1;
+  }
+
+  // Audio filters.
+  matched.assign(audio_.unconstrained.begin(), audio_.unconstrained.end());
+  if (track.type == TrackProperties::Type::kAudio) {
+    channels_.ForEach(track.channels, [this, &matched](uint32_t f) {
+      SetBit(audio_.owners[f], matched.data());
+    });
+  }
+  if (!keep_matched()) {
+    return -1;
+  }
+
+  // Bitrate filters, which apply to every type of track.
+  matched.assign(bitrate_.unconstrained.begin(), bitrate_.unconstrained.end());
+  bitrates_.ForEach(track.bitrate, [this, &matched](uint32_t f) {
+    SetBit(bitrate_.owners[f], matched.data());
+  });
+  if (!keep_matched()) {
+    return -1;
+  }
+
+  // Label filters.
+  matched.assign(unlabeled_.begin(), unlabeled_.end());
+  for (const std::string& label : track.labels) {
+    auto found = labels_.find(label);
+    if (found != labels_.end()) {
+      for (uint32_t r : found->second) {
+        SetBit(r, matched.data());
+      }
+    }
+  }
+  if (!keep_matched()) {
+    return -1;
+  }
+
+  for (size_t w = 0; w < words_; w++) {
+    if (candidates[w]) {
+      return rules_[w * 64 + __builtin_ctzll(candidates[w])];
+    }
+  }
+  return -1;
+}
+
+std::shared_ptr<const UsageRuleMatcher> UsageRuleMatcher::Create(
+    const std::vector<const UsageRule*>& rules) {
+  std::shared_ptr<UsageRuleMatcher> matcher(new UsageRuleMatcher);
+  std::vector<std::vector<uint32_t>> periods;
+  std::vector<uint32_t> unperiodized;
+  for (uint32_t r = 0; r < rules.size(); r++) {
+    const UsageRule& rule = *rules[r];
+    matcher->kids_.push_back(rule.kid());
+    for (const std::string& period : rule.key_period_filter_ids()) {
+      auto inserted = matcher->period_ids_.emplace(period, periods.size());
+      if (inserted.second) {
+        periods.emplace_back();
+      }
+      std::vector<uint32_t>& members = periods[inserted.first->second];
+      if (members.empty() || members.back() != r) {
+        members.push_back(r);
+      }
+    }
+    if (rule.key_period_filter_ids().empty()) {
+      unperiodized.push_back(r);
+    }
+  }
+
+  matcher->periods_.resize(periods.size());
+  for (size_t i = 0; i < periods.size(); i++) {
+    matcher->periods_[i].Build(rules, std::move(periods[i]));
+  }
+  matcher->unperiodized_.Build(rules, std::move(unperiodized));
+  return matcher;
+}
+
+const std::vector<uint8_t>* UsageRuleMatcher::Resolve(
+    const TrackProperties& track, const std::string& period_id) const {
+  int64_t first = unperiodized_.FirstMatch(track);
+  if (!period_id.empty()) {
+    auto found = period_ids_.find(period_id);
+    if (found != period_ids_.end()) {
+      int64_t in_period = periods_[found->second].FirstMatch(track);
+      if (in_period != -1 && (first == -1 || in_period < first)) {
+        first = in_period;
+      }
+    }
+  }
+  return first == -1 ? nullptr : &kids_[first];
+}
+
+}  // namespace cpix
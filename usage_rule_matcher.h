@@ -0,0 +1,163 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_USAGE_RULE_MATCHER_H_
+#define CPIX_CC_USAGE_RULE_MATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "usage_rule.h"
+
+namespace cpix {
+
+// The properties of a track that usage rules filter on. Properties that do not
+// apply to the track's type are ignored.
+struct TrackProperties {
+  enum class Type { kOther, kVideo, kAudio };
+
+  Type type = Type::kOther;
+  int pixels = 0;
+  int fps = 0;
+  bool hdr = false;
+  bool wcg = false;
+  int channels = 0;
+  int bitrate = 0;
+  std::vector<std::string> labels;
+};
+
+// UsageRuleMatcher answers which content key applies to a track, following the
+// CPIX rules: filters of the same kind are alternatives, filters of different
+// kinds must all match, and a rule without filters of a kind does not
+// constrain that kind. Video and audio filters only match tracks of that type.
+//
+// Rules are indexed by key period id first, so a lookup only considers the
+// rules of the requested period and the rules without key period filters, not
+// every rule of the document. Within each of those sets, every numeric filter
+// property is compiled into an interval table over the boundaries of its
+// ranges, so finding the filters accepting a value costs one binary search and
+// a walk of O(log n) nodes, followed by bitset operations over the rules of the
+// set. Labels are hashed. A matcher is immutable once created and may be used
+// from any number of threads.
+class UsageRuleMatcher {
+ public:
+  ~UsageRuleMatcher();
+
+  UsageRuleMatcher(const UsageRuleMatcher&) = delete;
+  UsageRuleMatcher& operator=(const UsageRuleMatcher&) = delete;
+
+  // Compiles |rules|, in document order.
+  static std::shared_ptr<const UsageRuleMatcher> Create(
+      const std::vector<const UsageRule*>& rules);
+
+  // Returns the KID of the first rule matching |track| in the key period with
+  // id |period_id|, or nullptr if no rule matches. Rules with key period
+  // filters never match an empty |period_id|. The KID stays valid for the
+  // lifetime of the matcher.
+  const std::vector<uint8_t>* Resolve(const TrackProperties& track,
+                                      const std::string& period_id) const;
+
+  size_t size() const { return kids_.size(); }
+
+ private:
+  using Bits = std::vector<uint64_t>;
+
+  // Maps each value of one integer property to the entries, filters, whose
+  // range accepts it. The ranges are stored in a segment tree over the
+  // intervals between range boundaries, each range in O(log n) nodes, so the
+  // table takes O(n log n) time and space to build for n ranges.
+  class IntervalTable {
+   public:
+    // |ranges|[i] is the inclusive range accepted by entry i, with -1 for an
+    // open end, as in the filter structs.
+    void Build(const std::vector<std::pair<int, int>>& ranges);
+
+    // Calls |fn| with each entry accepting |value|, in no particular order.
+    template <typename Fn>
+    void ForEach(int value, const Fn& fn) const;
+
+   private:
+    // Returns the interval holding |value|.
+    size_t Interval(int64_t value) const;
+
+    std::vector<int64_t> boundaries_;
+    size_t intervals_ = 0;
+    // The entries of tree node i are entries_[offsets_[i]..offsets_[i + 1]).
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> entries_;
+  };
+
+  // Filters of one kind, video, audio or bitrate, of the rules in a RuleSet.
+  struct FilterSet {
+    // The rule each filter belongs to, as an index into RuleSet::rules.
+    std::vector<uint32_t> owners;
+    // Rules with no filter of this kind.
+    Bits unconstrained;
+  };
+
+  // The rules of one key period, or the rules without key period filters.
+  class RuleSet {
+   public:
+    // Compiles the rules in |all| at |indices|, which are ascending.
+    void Build(const std::vector<const UsageRule*>& all,
+               std::vector<uint32_t> indices);
+
+    // Returns the index of the first rule of the set matching |track|, or -1.
+    int64_t FirstMatch(const TrackProperties& track) const;
+
+   private:
+    // Indices of the rules in the matcher, in document order.
+    std::vector<uint32_t> rules_;
+    size_t words_ = 0;
+
+    FilterSet video_;
+    IntervalTable pixels_;
+    std::vector<VideoFilter> video_filters_;
+
+    FilterSet audio_;
+    IntervalTable channels_;
+
+    FilterSet bitrate_;
+    IntervalTable bitrates_;
+
+    // Rules with each label, as indices into rules_, and rules with no label
+    // filters.
+    absl::flat_hash_map<std::string, std::vector<uint32_t>> labels_;
+    Bits unlabeled_;
+  };
+
+  UsageRuleMatcher() = default;
+
+  // Sets bit |index| of |bits|.
+  static void SetBit(size_t index, uint64_t* bits) {
+    bits[index / 64] |= uint64_t{1} << (index % 64);
+  }
+
+  std::vector<std::vector<uint8_t>> kids_;
+
+  // The rule set of each key period id, and the rules with no key period
+  // filters, which apply to every period.
+  absl::flat_hash_map<std::string, size_t> period_ids_;
+  std::vector<RuleSet> periods_;
+  RuleSet unperiodized_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_USAGE_RULE_MATCHER_H_
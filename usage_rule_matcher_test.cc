@@ -0,0 +1,421 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "usage_rule_matcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+#include "usage_rule.h"
+
+namespace cpix {
+namespace {
+
+std::vector<uint8_t> Kid(uint8_t index) {
+  std::vector<uint8_t> kid(16);
+  kid[15] = index;
+  return kid;
+}
+
+TrackProperties Video(int pixels, int fps) {
+  TrackProperties track;
+  track.type = TrackProperties::Type::kVideo;
+  track.pixels = pixels;
+  track.fps = fps;
+  return track;
+}
+
+TrackProperties Audio(int channels) {
+  TrackProperties track;
+  track.type = TrackProperties::Type::kAudio;
+  track.channels = channels;
+  return track;
+}
+
+class UsageRuleMatcherTest : public ::testing::Test {
+ protected:
+  UsageRule* AddRule() {
+    rules_.push_back(absl::make_unique<UsageRule>());
+    rules_.back()->set_key_id(Kid(rules_.size() - 1));
+    return rules_.back().get();
+  }
+
+  std::shared_ptr<const UsageRuleMatcher> Compile() {
+    std::vector<const UsageRule*> rules;
+    for (const auto& rule : rules_) {
+      rules.push_back(rule.get());
+    }
+    return UsageRuleMatcher::Create(rules);
+  }
+
+  // Returns the index of the rule resolved for |track|, or -1.
+  int Resolve(const TrackProperties& track,
+              const std::string& period_id = "") {
+    std::shared_ptr<const UsageRuleMatcher> matcher = Compile();
+    const std::vector<uint8_t>* kid = matcher->Resolve(track, period_id);
+    return kid ? (*kid)[15] : -1;
+  }
+
+  std::vector<std::unique_ptr<UsageRule>> rules_;
+};
+
+TEST_F(UsageRuleMatcherTest, NoRules) {
+  EXPECT_EQ(Compile()->size(), 0);
+  EXPECT_EQ(Resolve(Video(100, 30)), -1);
+}
+
+TEST_F(UsageRuleMatcherTest, VideoRanges) {
+  VideoFilter sd;
+  sd.max_pixels = 1000;
+  AddRule()->AddVideoFilter(sd);
+  VideoFilter hd;
+  hd.min_pixels = 1001;
+  hd.max_pixels = 5000;
+  hd.max_fps = 30;
+  AddRule()->AddVideoFilter(hd);
+
+  EXPECT_EQ(Resolve(Video(0, 60)), 0);
+  EXPECT_EQ(Resolve(Video(1000, 60)), 0);
+  EXPECT_EQ(Resolve(Video(1001, 30)), 1);
+  EXPECT_EQ(Resolve(Video(5000, 24)), 1);
+  EXPECT_EQ(Resolve(Video(5000, 31)), -1);
+  EXPECT_EQ(Resolve(Video(5001, 24)), -1);
+  // Video filters only match video tracks.
+  EXPECT_EQ(Resolve(Audio(2)), -1);
+}
+
+TEST_F(UsageRuleMatcherTest, HdrAndWcgRequireTrackSupport) {
+  VideoFilter hdr;
+  hdr.hdr = true;
+  AddRule()->AddVideoFilter(hdr);
+  VideoFilter wcg;
+  wcg.wcg = true;
+  AddRule()->AddVideoFilter(wcg);
+  AddRule()->AddVideoFilter(VideoFilter());
+
+  TrackProperties track = Video(100, 30);
+  EXPECT_EQ(Resolve(track), 2);
+  track.wcg = true;
+  EXPECT_EQ(Resolve(track), 1);
+  track.hdr = true;
+  EXPECT_EQ(Resolve(track), 0);
+}
+
+TEST_F(UsageRuleMatcherTest, FiltersOfOneKindAreAlternatives) {
+  AudioFilter stereo;
+  stereo.min_channels = 1;
+  stereo.max_channels = 2;
+  AudioFilter surround;
+  surround.min_channels = 6;
+  UsageRule* rule = AddRule();
+  rule->AddAudioFilter(stereo);
+  rule->AddAudioFilter(surround);
+
+  EXPECT_EQ(Resolve(Audio(2)), 0);
+  EXPECT_EQ(Resolve(Audio(4)), -1);
+  EXPECT_EQ(Resolve(Audio(8)), 0);
+}
+
+TEST_F(UsageRuleMatcherTest, FiltersOfDifferentKindsMustAllMatch) {
+  UsageRule* rule = AddRule();
+  VideoFilter video;
+  video.max_pixels = 1000;
+  rule->AddVideoFilter(video);
+  BitrateFilter bitrate;
+  bitrate.min_bitrate = 500;
+  rule->AddBitrateFilter(bitrate);
+  rule->AddLabelFilter("main");
+
+  TrackProperties track = Video(800, 30);
+  track.bitrate = 600;
+  EXPECT_EQ(Resolve(track), -1);
+  track.labels = {"other", "main"};
+  EXPECT_EQ(Resolve(track), 0);
+  track.bitrate = 400;
+  EXPECT_EQ(Resolve(track), -1);
+}
+
+TEST_F(UsageRuleMatcherTest, FirstMatchingRuleWins) {
+  AddRule()->AddLabelFilter("commentary");
+  AddRule();
+  AddRule();
+
+  TrackProperties track = Audio(2);
+  EXPECT_EQ(Resolve(track), 1);
+  track.labels = {"commentary"};
+  EXPECT_EQ(Resolve(track), 0);
+}
+
+TEST_F(UsageRuleMatcherTest, KeyPeriods) {
+  AddRule()->AddKeyPeriodFilter("p1");
+  AddRule()->AddKeyPeriodFilter("p2");
+
+  EXPECT_EQ(Resolve(Audio(2), "p1"), 0);
+  EXPECT_EQ(Resolve(Audio(2), "p2"), 1);
+  EXPECT_EQ(Resolve(Audio(2), "p3"), -1);
+  EXPECT_EQ(Resolve(Audio(2)), -1);
+}
+
+TEST_F(UsageRuleMatcherTest, ManyRules) {
+  // Spread rules over several words of the bitsets.
+  for (int i = 0; i < 200; i++) {
+    BitrateFilter bitrate;
+    bitrate.min_bitrate = i * 100;
+    bitrate.max_bitrate = i * 100 + 99;
+    AddRule()->AddBitrateFilter(bitrate);
+  }
+  std::shared_ptr<const UsageRuleMatcher> matcher = Compile();
+  ASSERT_EQ(matcher->size(), 200);
+  for (int i = 0; i < 200; i++) {
+    TrackProperties track;
+    track.bitrate = i * 100 + 50;
+    const std::vector<uint8_t>* kid = matcher->Resolve(track, "");
+    ASSERT_NE(kid, nullptr);
+    EXPECT_EQ((*kid)[15], i);
+  }
+  TrackProperties track;
+  track.bitrate = 20000;
+  EXPECT_EQ(matcher->Resolve(track, ""), nullptr);
+}
+
+TEST_F(UsageRuleMatcherTest, KeyPeriodsKeepDocumentOrder) {
+  AudioFilter stereo;
+  stereo.max_channels = 2;
+  AddRule()->AddAudioFilter(stereo);
+  UsageRule* both = AddRule();
+  both->AddKeyPeriodFilter("p1");
+  both->AddKeyPeriodFilter("p2");
+  AddRule();
+  AddRule()->AddKeyPeriodFilter("p3");
+
+  EXPECT_EQ(Resolve(Audio(2), "p1"), 0);
+  EXPECT_EQ(Resolve(Audio(6), "p1"), 1);
+  EXPECT_EQ(Resolve(Audio(6), "p2"), 1);
+  EXPECT_EQ(Resolve(Audio(6), "p3"), 2);
+  EXPECT_EQ(Resolve(Audio(6)), 2);
+}
+
+// KIDs and indices of matchers with more than 256 rules.
+std::vector<uint8_t> LargeKid(uint32_t index) {
+  std::vector<uint8_t> kid(16);
+  for (int i = 0; i < 4; i++) {
+    kid[12 + i] = index >> (24 - 8 * i);
+  }
+  return kid;
+}
+
+int64_t LargeIndex(const std::vector<uint8_t>* kid) {
+  if (!kid) {
+    return -1;
+  }
+  uint32_t index = 0;
+  for (int i = 0; i < 4; i++) {
+    index = (index << 8) | (*kid)[12 + i];
+  }
+  return index;
+}
+
+TEST(UsageRuleMatcherScaleTest, KeyRotation) {
+  constexpr int kPeriods = 2000;
+  constexpr int kTracks = 4;
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  std::vector<const UsageRule*> pointers;
+  for (int period = 0; period < kPeriods; period++) {
+    for (int track = 0; track < kTracks; track++) {
+      rules.push_back(absl::make_unique<UsageRule>());
+      rules.back()->set_key_id(LargeKid(rules.size() - 1));
+      rules.back()->AddKeyPeriodFilter("p" + std::to_string(period));
+      BitrateFilter bitrate;
+      bitrate.min_bitrate = track * 1000;
+      bitrate.max_bitrate = track * 1000 + 999;
+      rules.back()->AddBitrateFilter(bitrate);
+      pointers.push_back(rules.back().get());
+    }
+  }
+  std::shared_ptr<const UsageRuleMatcher> matcher =
+      UsageRuleMatcher::Create(pointers);
+  for (int period = 0; period < kPeriods; period += 7) {
+    for (int track = 0; track < kTracks; track++) {
+      TrackProperties properties;
+      properties.bitrate = track * 1000 + 500;
+      EXPECT_EQ(LargeIndex(matcher->Resolve(properties,
+                                            "p" + std::to_string(period))),
+                period * kTracks + track);
+    }
+  }
+}
+
+TEST(UsageRuleMatcherScaleTest, ManyOverlappingFilters) {
+  // Each value is accepted by 100 filters. Tables holding a full set of
+  // filters for every interval would take gigabytes.
+  constexpr int kRules = 100000;
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  std::vector<const UsageRule*> pointers;
+  for (int i = 0; i < kRules; i++) {
+    rules.push_back(absl::make_unique<UsageRule>());
+    rules.back()->set_key_id(LargeKid(i));
+    BitrateFilter bitrate;
+    bitrate.min_bitrate = i * 10;
+    bitrate.max_bitrate = i * 10 + 999;
+    rules.back()->AddBitrateFilter(bitrate);
+    pointers.push_back(rules.back().get());
+  }
+  std::shared_ptr<const UsageRuleMatcher> matcher =
+      UsageRuleMatcher::Create(pointers);
+  for (int value : {0, 999, 1000, 1009, 1010, 555555, kRules * 10 - 1}) {
+    TrackProperties track;
+    track.bitrate = value;
+    EXPECT_EQ(LargeIndex(matcher->Resolve(track, "")),
+              std::max(0, (value - 999 + 9) / 10))
+        << value;
+  }
+  TrackProperties track;
+  track.bitrate = kRules * 10 + 999;
+  EXPECT_EQ(matcher->Resolve(track, ""), nullptr);
+}
+
+// Returns true if |value| is within the inclusive range, where -1 is an open
+// end.
+bool InRange(int value, int min, int max) {
+  return (min == -1 || value >= min) && (max == -1 || value <= max);
+}
+
+// Matches |rule| against |track| the slow way, following the CPIX rules.
+bool Matches(const UsageRule& rule, const TrackProperties& track,
+             const std::string& period_id) {
+  bool video = rule.video_filters().empty();
+  for (const VideoFilter& filter : rule.video_filters()) {
+    video |= track.type == TrackProperties::Type::kVideo &&
+             InRange(track.pixels, filter.min_pixels, filter.max_pixels) &&
+             InRange(track.fps, filter.min_fps, filter.max_fps) &&
+             (track.hdr || !filter.hdr) && (track.wcg || !filter.wcg);
+  }
+  bool audio = rule.audio_filters().empty();
+  for (const AudioFilter& filter : rule.audio_filters()) {
+    audio |= track.type == TrackProperties::Type::kAudio &&
+             InRange(track.channels, filter.min_channels,
+                     filter.max_channels);
+  }
+  bool bitrate = rule.bitrate_filters().empty();
+  for (const BitrateFilter& filter : rule.bitrate_filters()) {
+    bitrate |=
+        InRange(track.bitrate, filter.min_bitrate, filter.max_bitrate);
+  }
+  bool label = rule.label_filters().empty();
+  for (const Label& filter : rule.label_filters()) {
+    for (const std::string& track_label : track.labels) {
+      label |= filter.text() == track_label;
+    }
+  }
+  bool period = rule.key_period_filter_ids().empty();
+  for (const std::string& filter : rule.key_period_filter_ids()) {
+    period |= !period_id.empty() && filter == period_id;
+  }
+  return video && audio && bitrate && label && period;
+}
+
+TEST(UsageRuleMatcherScaleTest, MatchesReference) {
+  std::mt19937 random(1);
+  // Values come from a small domain, so ranges overlap and share boundaries.
+  auto value = [&random]() { return static_cast<int>(random() % 20); };
+  // Sets |min| and |max| to a range, with each end open at times.
+  auto range = [&random, &value](int* min, int* max) {
+    *min = value();
+    *max = value();
+    if (*min > *max) {
+      std::swap(*min, *max);
+    }
+    if (random() % 4 == 0) {
+      *min = -1;
+    }
+    if (random() % 4 == 0) {
+      *max = -1;
+    }
+  };
+  std::vector<std::unique_ptr<UsageRule>> rules;
+  std::vector<const UsageRule*> pointers;
+  for (int i = 0; i < 100; i++) {
+    rules.push_back(absl::make_unique<UsageRule>());
+    UsageRule* rule = rules.back().get();
+    rule->set_key_id(LargeKid(i));
+    for (int f = random() % 3; f > 0; f--) {
+      VideoFilter filter;
+      range(&filter.min_pixels, &filter.max_pixels);
+      range(&filter.min_fps, &filter.max_fps);
+      filter.hdr = random() % 4 == 0;
+      filter.wcg = random() % 4 == 0;
+      rule->AddVideoFilter(filter);
+    }
+    for (int f = random() % 3; f > 0; f--) {
+      AudioFilter filter;
+      range(&filter.min_channels, &filter.max_channels);
+      rule->AddAudioFilter(filter);
+    }
+    // Every rule constrains something.
+    for (int f = 1 + random() % 2; f > 0; f--) {
+      BitrateFilter filter;
+      range(&filter.min_bitrate, &filter.max_bitrate);
+      rule->AddBitrateFilter(filter);
+    }
+    for (int f = random() % 2; f > 0; f--) {
+      rule->AddLabelFilter("l" + std::to_string(random() % 3));
+    }
+    for (int f = random() % 3; f > 0; f--) {
+      rule->AddKeyPeriodFilter("p" + std::to_string(random() % 4));
+    }
+    pointers.push_back(rule);
+  }
+  std::shared_ptr<const UsageRuleMatcher> matcher =
+      UsageRuleMatcher::Create(pointers);
+
+  int matched = 0;
+  for (int i = 0; i < 5000; i++) {
+    TrackProperties track;
+    track.type = static_cast<TrackProperties::Type>(random() % 3);
+    track.pixels = value();
+    track.fps = value();
+    track.hdr = random() % 2;
+    track.wcg = random() % 2;
+    track.channels = value();
+    track.bitrate = value();
+    if (random() % 2) {
+      track.labels.push_back("l" + std::to_string(random() % 3));
+    }
+    std::string period_id =
+        random() % 5 == 0 ? "" : "p" + std::to_string(random() % 5);
+
+    int64_t expected = -1;
+    for (size_t r = 0; r < rules.size(); r++) {
+      if (Matches(*rules[r], track, period_id)) {
+        expected = r;
+        break;
+      }
+    }
+    ASSERT_EQ(LargeIndex(matcher->Resolve(track, period_id)), expected) << i;
+    matched += expected != -1;
+  }
+  // The lookups exercise matches as well as misses.
+  EXPECT_GT(matched, 500);
+  EXPECT_LT(matched, 4950);
+}
+
+}  // namespace
+}  // namespace cpix
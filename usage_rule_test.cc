@@ -79,6 +79,37 @@ TEST(UsageRuleTest, SerializeUsageRuleAllFieldsAndFilterTypes) {
   EXPECT_EQ(rule.Serialize(), kGoodXML);
 }
 
+TEST(UsageRuleTest, TrackTypes) {
+  UsageRule rule;
+  EXPECT_EQ(rule.track_type(), UsageRule::TrackType::kUnspecified);
+  EXPECT_EQ(rule.intended_track_type(), "");
+  rule.SetTrackType("UHD1");
+  EXPECT_EQ(rule.track_type(), UsageRule::TrackType::kUHD1);
+  EXPECT_EQ(rule.intended_track_type(), "UHD1");
+  rule.SetTrackType("3D");
+  EXPECT_EQ(rule.track_type(), UsageRule::TrackType::kOther);
+  EXPECT_EQ(rule.intended_track_type(), "3D");
+  EXPECT_TRUE(rule.SetTrackType(UsageRule::TrackType::kAudio));
+  EXPECT_EQ(rule.intended_track_type(), "AUDIO");
+
+  // kOther has no text, so it can only be set by name.
+  EXPECT_FALSE(rule.SetTrackType(UsageRule::TrackType::kOther));
+  EXPECT_EQ(rule.track_type(), UsageRule::TrackType::kAudio);
+  EXPECT_EQ(rule.intended_track_type(), "AUDIO");
+}
+
+TEST(UsageRuleTest, LabelsAreShared) {
+  UsageRule first;
+  UsageRule second;
+  first.AddLabelFilter("HD-video");
+  second.AddLabelFilter("HD-video");
+  second.AddLabelFilter("main");
+  ASSERT_EQ(second.label_filters().size(), 2);
+  EXPECT_EQ(second.label_filters()[1].text(), "main");
+  EXPECT_EQ(&first.label_filters()[0].text(),
+            &second.label_filters()[0].text());
+}
+
 TEST(UsageRuleTest, SerializeUsageRuleVideoSparse) {
   TestableCPIXElement<UsageRule> rule;
   VideoFilter video_filter;
@@ -0,0 +1,72 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xml_arena.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "libxml/tree.h"
+#include "unique_xml_ptr.h"
+#include "xml_parser_pool.h"
+
+namespace cpix {
+namespace {
+
+constexpr size_t kBlockSize = 16 * 1024;
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+thread_local XMLArena* current_arena = nullptr;
+
+}  // namespace
+
+XMLArena::XMLArena() : previous_(current_arena) {
+  doc_ = UniqueXmlPtr<xmlDoc>(xmlNewDoc(BAD_CAST "1.0"));
+  if (doc_) {
+    doc_->dict = xmlDictCreateSub(GetCPIXNameDictionary());
+  }
+  current_arena = this;
+}
+
+XMLArena::~XMLArena() { current_arena = previous_; }
+
+XMLArena* XMLArena::Current() { return current_arena; }
+
+void* XMLArena::Allocate(size_t size) {
+  size = (size + kAlignment - 1) & ~(kAlignment - 1);
+  if (blocks_.empty() || block_used_ + size > block_size_) {
+    block_size_ = size > kBlockSize ? size : kBlockSize;
+    blocks_.emplace_back(new char[block_size_]);
+    bytes_reserved_ += block_size_;
+    block_used_ = 0;
+  }
+  void* ptr = blocks_.back().get() + block_used_;
+  block_used_ += size;
+  return ptr;
+}
+
+xmlNsPtr XMLArena::GetNamespace(const std::string& prefix) {
+  auto it = namespaces_.find(prefix);
+  if (it != namespaces_.end()) {
+    return it->second.get();
+  }
+  UniqueXmlPtr<xmlNs> ns(xmlNewNs(nullptr, nullptr, BAD_CAST prefix.c_str()));
+  xmlNsPtr result = ns.get();
+  namespaces_.emplace(prefix, std::move(ns));
+  return result;
+}
+
+}  // namespace cpix
@@ -0,0 +1,75 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPIX_CC_XML_ARENA_H_
+#define CPIX_CC_XML_ARENA_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libxml/tree.h"
+#include "unique_xml_ptr.h"
+
+namespace cpix {
+
+// XMLArena is a scoped, per-thread allocation context for building and parsing
+// XMLNode trees. While an arena is alive on a thread, XMLNode objects created
+// on that thread are carved out of a few large blocks owned by the arena, and
+// new libxml nodes are created in the arena's document so their element and
+// attribute names come from a dictionary instead of being copied per node.
+// Everything is released in one shot when the arena is destroyed.
+//
+// No XMLNode created while an arena is active may outlive the arena. Arenas may
+// be nested; the innermost one is used for new allocations.
+class XMLArena {
+ public:
+  XMLArena();
+  ~XMLArena();
+
+  XMLArena(const XMLArena&) = delete;
+  XMLArena& operator=(const XMLArena&) = delete;
+
+  // Returns the innermost arena active on the calling thread, or nullptr.
+  static XMLArena* Current();
+
+  // Returns |size| bytes aligned for any object type. The memory is reclaimed
+  // only when the arena is destroyed.
+  void* Allocate(size_t size);
+
+  // The document that new nodes built in this arena belong to.
+  xmlDocPtr doc() { return doc_.get(); }
+
+  // Returns the namespace object shared by every node built in this arena with
+  // the given |prefix|, creating it on first use.
+  xmlNsPtr GetNamespace(const std::string& prefix);
+
+  // Total bytes reserved for blocks so far.
+  size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  XMLArena* previous_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t block_size_ = 0;
+  size_t block_used_ = 0;
+  size_t bytes_reserved_ = 0;
+  std::map<std::string, UniqueXmlPtr<xmlNs>> namespaces_;
+  UniqueXmlPtr<xmlDoc> doc_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_XML_ARENA_H_
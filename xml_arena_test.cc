@@ -0,0 +1,95 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xml_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+#include "xml_node.h"
+
+namespace cpix {
+namespace {
+
+constexpr char kXMLTree[] =
+    "<ContentKey kid=\"value\"><Data><pskc:Secret/></Data></ContentKey>";
+
+std::unique_ptr<XMLNode> BuildTree() {
+  std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>("", "ContentKey");
+  root->AddAttribute("kid", "value");
+  std::unique_ptr<XMLNode> data = absl::make_unique<XMLNode>("", "Data");
+  data->AddChild(absl::make_unique<XMLNode>("pskc", "Secret"));
+  root->AddChild(std::move(data));
+  return root;
+}
+
+TEST(XMLArenaTest, CurrentTracksNesting) {
+  EXPECT_EQ(XMLArena::Current(), nullptr);
+  {
+    XMLArena outer;
+    EXPECT_EQ(XMLArena::Current(), &outer);
+    {
+      XMLArena inner;
+      EXPECT_EQ(XMLArena::Current(), &inner);
+    }
+    EXPECT_EQ(XMLArena::Current(), &outer);
+  }
+  EXPECT_EQ(XMLArena::Current(), nullptr);
+}
+
+TEST(XMLArenaTest, AllocationsAreAligned) {
+  XMLArena arena;
+  for (size_t size = 1; size < 100; size++) {
+    void* ptr = arena.Allocate(size);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignof(std::max_align_t), 0);
+  }
+}
+
+TEST(XMLArenaTest, BuildsSameTreeAsHeap) {
+  std::string heap_xml = BuildTree()->AsString();
+  std::string arena_xml;
+  {
+    XMLArena arena;
+    arena_xml = BuildTree()->AsString();
+    EXPECT_GT(arena.bytes_reserved(), 0);
+  }
+  EXPECT_EQ(heap_xml, kXMLTree);
+  EXPECT_EQ(arena_xml, kXMLTree);
+}
+
+TEST(XMLArenaTest, ParsesInsideArena) {
+  XMLArena arena;
+  XMLNode root(kXMLTree);
+  std::unique_ptr<XMLNode> data = root.GetFirstChildByName("Data");
+  ASSERT_TRUE(data);
+  EXPECT_EQ(data->GetName(), "Data");
+}
+
+TEST(XMLArenaTest, GraftsNodeBuiltOutsideArena) {
+  std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>("", "ContentKey");
+  {
+    XMLArena arena;
+    std::unique_ptr<XMLNode> child = absl::make_unique<XMLNode>("", "Data");
+    EXPECT_TRUE(root->AddChild(std::move(child)));
+  }
+  EXPECT_EQ(root->AsString(), "<ContentKey><Data/></ContentKey>");
+}
+
+}  // namespace
+}  // namespace cpix
@@ -16,6 +16,7 @@
 
 #include <stddef.h>
 
+#include <cstddef>
 #include <cstdio>
 #include <memory>
 #include <utility>
@@ -26,31 +27,112 @@
 #include "libxml/tree.h"
 #include "libxml/xmlschemastypes.h"
 #include "unique_xml_ptr.h"
+#include "xml_arena.h"
+#include "xml_parser_pool.h"
 
 namespace cpix {
+namespace {
+
+// Every XMLNode allocation is prefixed with the arena it came from, or nullptr
+// if it came from the heap. The prefix keeps the object maximally aligned.
+constexpr size_t kAllocationHeader = alignof(std::max_align_t);
+
+// Compares an element name against |name|. |interned| is the shared dictionary
+// copy of |name|, if there is one; parsed names that are interned are equal
+// only if they are the same pointer.
+bool NameMatches(const xmlChar* node_name, const xmlChar* interned,
+                 const std::string& name) {
+  if (interned && node_name == interned) {
+    return true;
+  }
+  if (interned && IsInternedCPIXName(node_name)) {
+    return false;
+  }
+  return xmlStrEqual(node_name, BAD_CAST name.c_str());
+}
+
+}  // namespace
 
 XMLNode::XMLNode(const std::string& xml) {
-  UniqueXmlPtr<xmlDoc> doc(xmlParseMemory(xml.c_str(), xml.size()));
-  node_ =
-      UniqueXmlPtr<xmlNode>(xmlCopyNode(xmlDocGetRootElement(doc.get()), 1));
+  UniqueXmlPtr<xmlDoc> doc = XMLParserPool::ForCurrentThread().Parse(xml);
+  xmlNodePtr root = xmlDocGetRootElement(doc.get());
+  if (!root) {
+    return;
+  }
+  xmlUnlinkNode(root);
+  doc_ = std::shared_ptr<xmlDoc>(doc.release(), XmlDeleter());
+  node_ = UniqueXmlPtr<xmlNode>(root);
 }
 
 XMLNode::XMLNode(const std::string& ns, const std::string& name) {
-  node_ = UniqueXmlPtr<xmlNode>(xmlNewNode(NULL, BAD_CAST name.c_str()));
-  if (!ns.empty()) {
+  XMLArena* arena = XMLArena::Current();
+  if (arena && arena->doc()) {
+    node_ = UniqueXmlPtr<xmlNode>(
+        xmlNewDocNode(arena->doc(), NULL, BAD_CAST name.c_str(), NULL));
+  } else {
+    node_ = UniqueXmlPtr<xmlNode>(xmlNewNode(NULL, BAD_CAST name.c_str()));
+  }
+  if (ns.empty()) {
+    return;
+  }
+  if (arena) {
+    xmlSetNs(node_.get(), arena->GetNamespace(ns));
+  } else {
     xmlSetNs(node_.get(), xmlNewNs(node_.get(), NULL, BAD_CAST ns.c_str()));
   }
 }
 
 XMLNode::XMLNode(UniqueXmlPtr<xmlNode> node) { node_ = std::move(node); }
 
+XMLNode::XMLNode(UniqueXmlPtr<xmlNode> node, std::shared_ptr<xmlDoc> doc)
+    : doc_(std::move(doc)), node_(std::move(node)) {}
+
 XMLNode::~XMLNode() = default;
 
+void* XMLNode::operator new(size_t size) {
+  XMLArena* arena = XMLArena::Current();
+  void* block = arena ? arena->Allocate(kAllocationHeader + size)
+                      : ::operator new(kAllocationHeader + size);
+  *static_cast<XMLArena**>(block) = arena;
+  return static_cast<char*>(block) + kAllocationHeader;
+}
+
+void XMLNode::operator delete(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  void* block = static_cast<char*>(ptr) - kAllocationHeader;
+  // Arena allocations are released together when the arena goes away.
+  if (!*static_cast<XMLArena**>(block)) {
+    ::operator delete(block);
+  }
+}
+
+XMLNode& XMLNode::operator=(XMLNode&& other) {
+  // Release the old node before the document that owns its names.
+  node_ = std::move(other.node_);
+  doc_ = std::move(other.doc_);
+  return *this;
+}
+
+std::unique_ptr<XMLNode> XMLNode::ReleaseChild(xmlNodePtr child) {
+  UniqueXmlPtr<xmlNode> node(child);
+  xmlUnlinkNode(node.get());
+  return absl::WrapUnique(new XMLNode(std::move(node), doc_));
+}
+
 bool XMLNode::AddChild(std::unique_ptr<XMLNode> child) {
-  if (!child) {
+  if (!node_ || !child || !child->node_) {
     return false;
   }
 
+  // Names of a parsed or arena-built node belong to its document's dictionary,
+  // so a node from another document is grafted as a standalone copy.
+  if (child->node_->doc && child->node_->doc != node_->doc) {
+    child->node_.reset(xmlCopyNode(child->node_.get(), 1));
+    child->doc_.reset();
+  }
+
   // |child| is now owned by this method, so we release here to avoid
   // destruction.
   if (!xmlAddChild(node_.get(), child->node_.get())) {
@@ -64,6 +146,45 @@ void XMLNode::AddAttribute(const std::string& name, const std::string& value) {
   xmlNewProp(node_.get(), BAD_CAST name.c_str(), BAD_CAST value.c_str());
 }
 
+bool XMLNode::DeclareNamespace(const std::string& prefix,
+                               const std::string& href, bool only_if_used) {
+  const xmlChar* ns_prefix = prefix.empty() ? NULL : BAD_CAST prefix.c_str();
+  xmlNsPtr declared = nullptr;
+  if (!only_if_used || !ns_prefix) {
+    declared = xmlNewNs(node_.get(), BAD_CAST href.c_str(), ns_prefix);
+    if (!declared) {
+      return false;
+    }
+  }
+  if (!ns_prefix) {
+    return true;
+  }
+
+  // Walk the subtree in document order without recursion.
+  xmlNodePtr curr = node_->children;
+  while (curr) {
+    if (curr->type == XML_ELEMENT_NODE && curr->ns &&
+        xmlStrEqual(curr->ns->prefix, ns_prefix)) {
+      if (!declared) {
+        declared = xmlNewNs(node_.get(), BAD_CAST href.c_str(), ns_prefix);
+        if (!declared) {
+          return false;
+        }
+      }
+      curr->ns = declared;
+    }
+    if (curr->type == XML_ELEMENT_NODE && curr->children) {
+      curr = curr->children;
+      continue;
+    }
+    while (curr && !curr->next && curr->parent != node_.get()) {
+      curr = curr->parent;
+    }
+    curr = curr ? curr->next : nullptr;
+  }
+  return declared != nullptr;
+}
+
 void XMLNode::SetContent(const std::string& content) {
   xmlNodeSetContent(node_.get(), BAD_CAST content.c_str());
 }
@@ -90,20 +211,18 @@ std::string XMLNode::GetContent() {
 }
 
 std::unique_ptr<XMLNode> XMLNode::GetFirstChild() {
-  UniqueXmlPtr<xmlNode> curr(node_.get()->xmlChildrenNode);
+  xmlNodePtr curr = node_.get()->xmlChildrenNode;
   if (!curr) return nullptr;
 
-  xmlUnlinkNode(curr.get());
-  return absl::make_unique<XMLNode>(std::move(curr));
+  return ReleaseChild(curr);
 }
 
 std::unique_ptr<XMLNode> XMLNode::GetFirstChildByName(const std::string& name) {
+  const xmlChar* interned = GetInternedCPIXName(name);
   xmlNodePtr curr = node_.get()->xmlChildrenNode;
   while (curr) {
-    if ((!xmlStrcmp(curr->name, BAD_CAST name.c_str()))) {
-      UniqueXmlPtr<xmlNode> node(curr);
-      xmlUnlinkNode(node.get());
-      return absl::make_unique<XMLNode>(std::move(node));
+    if (NameMatches(curr->name, interned, name)) {
+      return ReleaseChild(curr);
     }
     curr = curr->next;
   }
@@ -112,15 +231,14 @@ std::unique_ptr<XMLNode> XMLNode::GetFirstChildByName(const std::string& name) {
 
 std::vector<std::unique_ptr<XMLNode>> XMLNode::GetChildrenByName(
     const std::string& element_name) {
+  const xmlChar* interned = GetInternedCPIXName(element_name);
   xmlNodePtr curr = node_.get()->xmlChildrenNode;
   std::vector<std::unique_ptr<XMLNode>> nodes;
   while (curr) {
-    if ((!xmlStrcmp(curr->name, BAD_CAST element_name.c_str()))) {
+    if (NameMatches(curr->name, interned, element_name)) {
       xmlNodePtr temp = curr;
       curr = curr->next;
-      UniqueXmlPtr<xmlNode> node(temp);
-      xmlUnlinkNode(node.get());
-      nodes.push_back(absl::make_unique<XMLNode>(std::move(node)));
+      nodes.push_back(ReleaseChild(temp));
     } else {
       curr = curr->next;
     }
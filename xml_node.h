@@ -18,6 +18,8 @@
 #ifndef CPIX_CC_XML_NODE_H_
 #define CPIX_CC_XML_NODE_H_
 
+#include <stddef.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -34,7 +36,8 @@ class XMLNode {
   explicit XMLNode(const std::string& xml);
 
   // Constructor with two string arguments creates a new XMLNode with root
-  // element of corresponding namespace "ns" and element name "name".
+  // element of corresponding namespace "ns" and element name "name". Nodes
+  // built inside an XMLArena share one namespace object per prefix.
   XMLNode(const std::string& ns, const std::string& name);
 
   // Create a new XMLNode with the supplied node.
@@ -43,11 +46,16 @@ class XMLNode {
   ~XMLNode();
 
   XMLNode(XMLNode&&) = default;
-  XMLNode& operator=(XMLNode&&) = default;
+  XMLNode& operator=(XMLNode&& other);
 
   XMLNode(const XMLNode&) = delete;
   XMLNode& operator=(const XMLNode&) = delete;
 
+  // XMLNodes created while an XMLArena is active on the current thread are
+  // allocated from that arena and reclaimed with it.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   // Add an existing node as a child of this one.
   bool AddChild(std::unique_ptr<XMLNode> child);
 
@@ -57,6 +65,14 @@ class XMLNode {
   // Add an Attribute to this node.
   void AddAttribute(const std::string& name, const std::string& value);
 
+  // Declares namespace |href| under |prefix| on this node, or the default
+  // namespace if |prefix| is empty, and points every descendant element using
+  // |prefix| at this single declaration. If |only_if_used| is set, nothing is
+  // declared unless some descendant uses |prefix|. Returns true if the
+  // namespace was declared.
+  bool DeclareNamespace(const std::string& prefix, const std::string& href,
+                        bool only_if_used = false);
+
   // This node acts as the root of an XML chunk which is written out to a
   // string.
   std::string AsString();
@@ -79,7 +95,8 @@ class XMLNode {
 
   // Return the direct child of node_ with element name "name", or nullptr. If
   // multiple children with the same name exist, return the first one. Removes
-  // returned node from existing tree context.
+  // returned node from existing tree context. Known CPIX names are matched by
+  // pointer against the shared name dictionary.
   std::unique_ptr<XMLNode> GetFirstChildByName(const std::string& name);
 
   // Returns a vector of all direct children of a specified name of node_.
@@ -94,6 +111,14 @@ class XMLNode {
       std::vector<std::string> descendant_tree);
 
  private:
+  XMLNode(UniqueXmlPtr<xmlNode> node, std::shared_ptr<xmlDoc> doc);
+
+  std::unique_ptr<XMLNode> ReleaseChild(xmlNodePtr child);
+
+  // Parsed nodes keep their source document alive, since their names are
+  // interned in the document's dictionary. Declared before |node_| so that the
+  // node is always freed first.
+  std::shared_ptr<xmlDoc> doc_;
   UniqueXmlPtr<xmlNode> node_;
 };
 }  // namespace cpix
@@ -51,6 +51,12 @@ TEST(XMLNodeTest, AddChildSuccess) {
   EXPECT_TRUE(root->AddChild(std::move(child)));
 }
 
+TEST(XMLNodeTest, AddChildToUnparsedNode) {
+  XMLNode root("<unclosed>");
+  EXPECT_FALSE(root.AddChild(absl::make_unique<XMLNode>("", "child")));
+  EXPECT_FALSE(root.AddChild(absl::make_unique<XMLNode>("<child/>")));
+}
+
 TEST(XMLNodeTest, AsString) {
   std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>("", "parent");
   std::unique_ptr<XMLNode> child1 = absl::make_unique<XMLNode>("ns", "child1");
@@ -65,6 +71,18 @@ TEST(XMLNodeTest, AsString) {
   EXPECT_EQ(root->AsString(), kXMLString2Children);
 }
 
+TEST(XMLNodeTest, DeclareNamespace) {
+  std::unique_ptr<XMLNode> root = absl::make_unique<XMLNode>("", "parent");
+  std::unique_ptr<XMLNode> child = absl::make_unique<XMLNode>("ns", "child1");
+  child->AddChild(absl::make_unique<XMLNode>("ns", "child2"));
+  root->AddChild(std::move(child));
+  EXPECT_TRUE(root->DeclareNamespace("ns", "http://foo.com"));
+  EXPECT_FALSE(root->DeclareNamespace("unused", "http://bar.com", true));
+  EXPECT_EQ(root->AsString(),
+            "<parent xmlns:ns=\"http://foo.com\"><ns:child1><ns:child2/>"
+            "</ns:child1></parent>");
+}
+
 TEST(XMLNodeTest, FromString) { XMLNode root(kXMLString2Children); }
 
 TEST(XMLNodeTest, GetAttribute) {
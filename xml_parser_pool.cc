@@ -0,0 +1,149 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xml_parser_pool.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "libxml/parser.h"
+#include "unique_xml_ptr.h"
+
+namespace cpix {
+namespace {
+
+// Upper bound on idle contexts kept per thread.
+constexpr size_t kMaxPooledContexts = 4;
+
+constexpr const char* kCPIXNames[] = {
+    // CPIX elements.
+    "CPIX", "DeliveryDataList", "DeliveryData", "DeliveryKey", "DocumentKey",
+    "MACMethod", "Key", "ContentKeyList", "ContentKey", "Data", "DRMSystemList",
+    "DRMSystem", "PSSH", "ContentProtectionData", "URIExtXKey",
+    "HLSSignalingData", "SmoothStreamingProtectionHeaderData",
+    "HDSSignalingData", "ContentKeyPeriodList", "ContentKeyPeriod",
+    "ContentKeyUsageRuleList", "ContentKeyUsageRule", "KeyPeriodFilter",
+    "LabelFilter", "VideoFilter", "AudioFilter", "BitrateFilter",
+    "UpdateHistoryItemList", "UpdateHistoryItem", "Description",
+    "ReceivingEntity", "SendingEntity",
+    // CPIX attributes.
+    "id", "contentId", "name", "kid", "explicitIV", "dependsOnKey", "systemId",
+    "playlist", "index", "start", "end", "periodId", "label",
+    "intendedTrackType", "minPixels", "maxPixels", "hdr", "wcg", "minFps",
+    "maxFps", "minChannels", "maxChannels", "minBitrate", "maxBitrate",
+    "updateVersion", "source", "date",
+    // PSKC.
+    "KeyContainer", "KeyPackage", "DeviceInfo", "CryptoModuleInfo", "Secret",
+    "PlainValue", "EncryptedValue", "ValueMAC", "EncryptionKey", "MACKey",
+    "MACKeyReference", "Version", "Id", "Algorithm", "Issuer",
+    "AlgorithmParameters", "KeyProfileId", "KeyReference", "FriendlyName",
+    "Policy", "Counter", "Time", "TimeInterval", "TimeDrift", "Extensions",
+    "UserId", "StartDate", "ExpiryDate", "KeyUsage", "PINPolicy",
+    "Manufacturer", "SerialNo", "Model", "IssueNo", "DeviceBinding",
+    "definition",
+    // XMLENC.
+    "EncryptedData", "EncryptedKey", "EncryptionMethod", "CipherData",
+    "CipherValue", "CipherReference", "KeySize", "OAEPparams",
+    "EncryptionProperties", "EncryptionProperty", "ReferenceList",
+    "DataReference", "CarriedKeyName", "AgreementMethod", "OriginatorKeyInfo",
+    "RecipientKeyInfo", "Recipient", "Type", "MimeType", "Encoding", "URI",
+    // XMLDSIG.
+    "Signature", "SignedInfo", "SignatureValue", "CanonicalizationMethod",
+    "SignatureMethod", "Reference", "Transforms", "Transform", "DigestMethod",
+    "DigestValue", "KeyInfo", "KeyName", "KeyValue", "RetrievalMethod",
+    "X509Data", "X509Certificate", "X509IssuerSerial", "X509IssuerName",
+    "X509SerialNumber", "X509SKI", "X509SubjectName", "X509CRL", "PGPData",
+    "SPKIData", "MgmtData", "Object", "Manifest", "SignatureProperties",
+    "SignatureProperty", "RSAKeyValue", "Modulus", "Exponent", "DSAKeyValue",
+    "HMACOutputLength", "XPath", "Target",
+    // Namespace handling.
+    "xml", "xmlns", "xsi", "xsd", "ds", "enc", "pskc",
+};
+
+xmlDictPtr CreateCPIXNameDictionary() {
+  xmlInitParser();
+  xmlDictPtr dict = xmlDictCreate();
+  for (const char* name : kCPIXNames) {
+    xmlDictLookup(dict, BAD_CAST name, strlen(name));
+  }
+  return dict;
+}
+
+}  // namespace
+
+xmlDictPtr GetCPIXNameDictionary() {
+  static xmlDictPtr const dict = CreateCPIXNameDictionary();
+  return dict;
+}
+
+const xmlChar* GetInternedCPIXName(const std::string& name) {
+  return xmlDictExists(GetCPIXNameDictionary(), BAD_CAST name.c_str(),
+                       name.size());
+}
+
+bool IsInternedCPIXName(const xmlChar* name) {
+  return xmlDictOwns(GetCPIXNameDictionary(), name) == 1;
+}
+
+XMLParserPool::XMLParserPool() = default;
+
+XMLParserPool::~XMLParserPool() = default;
+
+XMLParserPool& XMLParserPool::ForCurrentThread() {
+  static thread_local XMLParserPool pool;
+  return pool;
+}
+
+UniqueXmlPtr<xmlDoc> XMLParserPool::Parse(const std::string& xml) {
+  UniqueXmlPtr<xmlParserCtxt> context = AcquireContext();
+  if (!context) {
+    return nullptr;
+  }
+
+  // Give every document its own child dictionary. Known names resolve to the
+  // shared parent; anything new is interned in the child, which the document
+  // keeps alive after the context moves on.
+  xmlCtxtReset(context.get());
+  xmlDictPtr dict = xmlDictCreateSub(GetCPIXNameDictionary());
+  if (!dict) {
+    return nullptr;
+  }
+  xmlDictFree(context->dict);
+  context->dict = dict;
+
+  UniqueXmlPtr<xmlDoc> doc(
+      xmlCtxtReadMemory(context.get(), xml.c_str(), xml.size(), nullptr,
+                        nullptr, 0));
+  ReleaseContext(std::move(context));
+  return doc;
+}
+
+UniqueXmlPtr<xmlParserCtxt> XMLParserPool::AcquireContext() {
+  if (contexts_.empty()) {
+    GetCPIXNameDictionary();
+    return UniqueXmlPtr<xmlParserCtxt>(xmlNewParserCtxt());
+  }
+  UniqueXmlPtr<xmlParserCtxt> context = std::move(contexts_.back());
+  contexts_.pop_back();
+  return context;
+}
+
+void XMLParserPool::ReleaseContext(UniqueXmlPtr<xmlParserCtxt> context) {
+  if (contexts_.size() < kMaxPooledContexts) {
+    contexts_.push_back(std::move(context));
+  }
+}
+
+}  // namespace cpix
@@ -0,0 +1,70 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Reusable libxml parser contexts and a shared dictionary of CPIX names.
+
+#ifndef CPIX_CC_XML_PARSER_POOL_H_
+#define CPIX_CC_XML_PARSER_POOL_H_
+
+#include <string>
+#include <vector>
+
+#include "libxml/parser.h"
+#include "libxml/tree.h"
+#include "unique_xml_ptr.h"
+
+namespace cpix {
+
+// Returns the process-wide dictionary pre-seeded with every CPIX, PSKC, XMLENC
+// and XMLDSIG element and attribute name. The dictionary is never modified
+// after construction, so it may be read from any thread.
+xmlDictPtr GetCPIXNameDictionary();
+
+// Returns the interned copy of |name| in the shared dictionary, or nullptr if
+// |name| is not a known CPIX name. Names of parsed elements that match a known
+// name point at the same interned string, so they can be compared by pointer.
+const xmlChar* GetInternedCPIXName(const std::string& name);
+
+// Returns true if |name| is an interned string owned by the shared dictionary.
+bool IsInternedCPIXName(const xmlChar* name);
+
+// A pool of libxml parser contexts owned by a single thread. Contexts are reset
+// and reused between documents instead of being created and torn down for
+// every parse. Each parsed document gets a fresh child dictionary of the shared
+// CPIX dictionary, so documents never share mutable state and may be handed to
+// other threads.
+class XMLParserPool {
+ public:
+  XMLParserPool();
+  ~XMLParserPool();
+
+  XMLParserPool(const XMLParserPool&) = delete;
+  XMLParserPool& operator=(const XMLParserPool&) = delete;
+
+  // Returns the pool owned by the calling thread.
+  static XMLParserPool& ForCurrentThread();
+
+  // Parses |xml| into a new document. Returns nullptr if |xml| is not well
+  // formed.
+  UniqueXmlPtr<xmlDoc> Parse(const std::string& xml);
+
+ private:
+  UniqueXmlPtr<xmlParserCtxt> AcquireContext();
+  void ReleaseContext(UniqueXmlPtr<xmlParserCtxt> context);
+
+  std::vector<UniqueXmlPtr<xmlParserCtxt>> contexts_;
+};
+
+}  // namespace cpix
+#endif  // CPIX_CC_XML_PARSER_POOL_H_
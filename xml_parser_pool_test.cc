@@ -0,0 +1,89 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xml_parser_pool.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "unique_xml_ptr.h"
+
+namespace cpix {
+namespace {
+
+constexpr char kContentKeyXML[] =
+    "<ContentKey kid=\"bd5adf51-cf04-410f-aac3-ec63a69e929e\"><Data/>"
+    "<NotACPIXName/></ContentKey>";
+
+constexpr char kMalformedXML[] = "<ContentKey><Data></ContentKey>";
+
+TEST(XMLParserPoolTest, KnownNamesAreInterned) {
+  EXPECT_NE(GetInternedCPIXName("ContentKey"), nullptr);
+  EXPECT_EQ(GetInternedCPIXName("ContentKey"),
+            GetInternedCPIXName("ContentKey"));
+  EXPECT_EQ(GetInternedCPIXName("NotACPIXName"), nullptr);
+}
+
+TEST(XMLParserPoolTest, ParsedNamesShareInternedPointers) {
+  UniqueXmlPtr<xmlDoc> doc = XMLParserPool::ForCurrentThread().Parse(
+      kContentKeyXML);
+  ASSERT_TRUE(doc);
+  xmlNodePtr root = xmlDocGetRootElement(doc.get());
+  ASSERT_NE(root, nullptr);
+  EXPECT_EQ(root->name, GetInternedCPIXName("ContentKey"));
+  EXPECT_EQ(root->children->name, GetInternedCPIXName("Data"));
+  EXPECT_FALSE(IsInternedCPIXName(root->children->next->name));
+}
+
+TEST(XMLParserPoolTest, ReusesContextAcrossDocuments) {
+  XMLParserPool pool;
+  for (int i = 0; i < 16; i++) {
+    UniqueXmlPtr<xmlDoc> doc = pool.Parse(kContentKeyXML);
+    ASSERT_TRUE(doc);
+  }
+}
+
+TEST(XMLParserPoolTest, RejectsMalformedDocument) {
+  XMLParserPool pool;
+  EXPECT_FALSE(pool.Parse(kMalformedXML));
+  EXPECT_TRUE(pool.Parse(kContentKeyXML));
+}
+
+TEST(XMLParserPoolTest, ParsesOnManyThreads) {
+  std::vector<std::thread> threads;
+  std::vector<int> parsed(4, 0);
+  for (size_t t = 0; t < parsed.size(); t++) {
+    threads.emplace_back([t, &parsed]() {
+      for (int i = 0; i < 64; i++) {
+        UniqueXmlPtr<xmlDoc> doc =
+            XMLParserPool::ForCurrentThread().Parse(kContentKeyXML);
+        if (doc && xmlDocGetRootElement(doc.get())->name ==
+                       GetInternedCPIXName("ContentKey")) {
+          parsed[t]++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int count : parsed) {
+    EXPECT_EQ(count, 64);
+  }
+}
+
+}  // namespace
+}  // namespace cpix
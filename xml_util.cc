@@ -14,20 +14,66 @@
 
 #include "xml_util.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 
+#include "libxml/parser.h"
 #include "libxml/xmlschemastypes.h"
 #include "unique_xml_ptr.h"
+#include "xml_parser_pool.h"
 
 namespace cpix {
+namespace {
 
-bool ValidateXML(const std::string& xml, const std::string& schema_uri) {
+// Returns the schema at |schema_uri|, compiling it on first use. A compiled
+// schema is never modified, and libxml2 lets one schema back validation
+// contexts on any number of threads. Schemas that fail to compile are not
+// cached.
+std::shared_ptr<xmlSchema> GetCompiledSchema(const std::string& schema_uri) {
+  static std::mutex* mutex = new std::mutex;
+  // Schemas may be compiled on several threads at once, which needs the
+  // parser set up first.
+  static auto* schemas = [] {
+    xmlInitParser();
+    return new std::map<std::string, std::shared_ptr<xmlSchema>>;
+  }();
+  {
+    std::lock_guard<std::mutex> lock(*mutex);
+    auto found = schemas->find(schema_uri);
+    if (found != schemas->end()) {
+      return found->second;
+    }
+  }
+
+  // Compiled outside the lock, so validating against one schema does not wait
+  // for another to compile. Threads racing on the same schema compile it
+  // twice, and all use the copy stored first.
   UniqueXmlPtr<xmlSchemaParserCtxt> parser_context(
       xmlSchemaNewParserCtxt(schema_uri.c_str()));
+  if (!parser_context) {
+    return nullptr;
+  }
+  std::shared_ptr<xmlSchema> schema(xmlSchemaParse(parser_context.get()),
+                                    XmlDeleter());
+  if (!schema) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(*mutex);
+  return schemas->emplace(schema_uri, std::move(schema)).first->second;
+}
+
+}  // namespace
 
-  UniqueXmlPtr<xmlSchema> schema(xmlSchemaParse(parser_context.get()));
+bool ValidateXML(const std::string& xml, const std::string& schema_uri) {
+  std::shared_ptr<xmlSchema> schema = GetCompiledSchema(schema_uri);
+  if (!schema) {
+    return false;
+  }
 
-  UniqueXmlPtr<xmlDoc> doc(xmlParseMemory(xml.c_str(), xml.size()));
+  UniqueXmlPtr<xmlDoc> doc = XMLParserPool::ForCurrentThread().Parse(xml);
   if (!doc) {
     return false;
   }
@@ -20,7 +20,8 @@
 namespace cpix {
 
 // Checks to see if the provided XML adheres to the schema in file pointed to
-// by schema_url. Returns true if valid, false otherwise.
+// by schema_url. Returns true if valid, false otherwise. Each schema is
+// compiled once per process and shared by later calls from any thread.
 bool ValidateXML(const std::string& xml, const std::string& schema_uri);
 
 // Temporary function that gets path of CPIX schema file while code lives in
@@ -14,6 +14,9 @@
 
 #include "xml_util.h"
 
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace cpix {
@@ -51,6 +54,20 @@ constexpr char kNotCPIX[] =
     "xmlns:pskc=\"urn:ietf:params:xml:ns:keyprov:pskc\"><NotCPIXElement "
     "/></CPIX>";
 
+// Runs first, so the threads race to compile the schema.
+TEST(XMLNodeTest, ValidatesConcurrently) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([]() {
+      EXPECT_TRUE(ValidateXML(kGoodCPIX, GetCpixSchema()));
+      EXPECT_FALSE(ValidateXML(kNotCPIX, GetCpixSchema()));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST(XMLNodeTest, AcceptGoodCPIX) {
   EXPECT_TRUE(ValidateXML(kGoodCPIX, GetCpixSchema()));
 }